@@ -26,6 +26,34 @@ static inline int fputc_careful(int c, FILE *fp, const char fail)
 	return (ret < 0) ? EOF : 0;
 }
 
+/*
+ * The escaping functions below write the result by @wr callback, so the same
+ * rules are usable for stdio streams (see fputs_quoted() etc.) as well as for
+ * private output buffers (e.g. libsmartcols). The unescaped parts of the
+ * string are written by one callback call.
+ */
+typedef void (*careful_write_t)(void *out, const char *buf, size_t sz);
+
+/* writes @prefix and two hex digits, e.g. \x1b */
+static inline void careful_puthex(careful_write_t wr, void *out,
+				  const char *prefix, unsigned char c)
+{
+	static const char hex[] = "0123456789abcdef";
+	char buf[8];
+	size_t sz = strlen(prefix);
+
+	memcpy(buf, prefix, sz);
+	buf[sz++] = hex[c >> 4];
+	buf[sz++] = hex[c & 0xf];
+	wr(out, buf, sz);
+}
+
+static inline int careful_case(int c, int dir)
+{
+	return dir ==  1 ? toupper(c) :
+	       dir == -1 ? tolower(c) : c;
+}
+
 /*
  * Requirements enumerated via testing (V8, Firefox, IE11):
  *
@@ -38,14 +66,23 @@ static inline int fputc_careful(int c, FILE *fp, const char fail)
  *	}
  * }
  */
-static inline void fputs_quoted_case_json(const char *data, FILE *out, int dir)
+static inline void careful_puts_quoted_json(careful_write_t wr, void *out,
+					    const char *data, int dir)
 {
-	const char *p;
+	const char *p, *run;
 
-	fputc('"', out);
-	for (p = data; p && *p; p++) {
+	wr(out, "\"", 1);
+	for (run = p = data; p && *p; p++) {
 
 		const unsigned char c = (unsigned char) *p;
+		char x;
+
+		/* All non-control characters OK; do the case swap as required. */
+		if (c >= 0x20 && c != '"' && c != '\\' && careful_case(c, dir) == c)
+			continue;
+
+		wr(out, run, p - run);
+		run = p + 1;
 
 		/* From http://www.json.org
 		 *
@@ -56,15 +93,15 @@ static inline void fputs_quoted_case_json(const char *data, FILE *out, int dir)
 		 * in the JSON spec, don't break double-quoted strings.
 		 */
 		if (c == '"' || c == '\\') {
-			fputc('\\', out);
-			fputc(c, out);
+			x = c;
+			wr(out, "\\", 1);
+			wr(out, &x, 1);
 			continue;
 		}
 
-		/* All non-control characters OK; do the case swap as required. */
 		if (c >= 0x20) {
-			fputc(dir ==  1 ? toupper(c) :
-			      dir == -1 ? tolower(c) : *p, out);
+			x = careful_case(c, dir);
+			wr(out, &x, 1);
 			continue;
 		}
 
@@ -78,50 +115,100 @@ static inline void fputs_quoted_case_json(const char *data, FILE *out, int dir)
 			 * should probably be using it.
 			 */
 			case '\b':
-				fputs("\\b", out);
+				wr(out, "\\b", 2);
 				break;
 			case '\t':
-				fputs("\\t", out);
+				wr(out, "\\t", 2);
 				break;
 			case '\n':
-				fputs("\\n", out);
+				wr(out, "\\n", 2);
 				break;
 			case '\f':
-				fputs("\\f", out);
+				wr(out, "\\f", 2);
 				break;
 			case '\r':
-				fputs("\\r", out);
+				wr(out, "\\r", 2);
 				break;
 			default:
 				/* Other assorted control characters */
-				fprintf(out, "\\u00%02x", c);
+				careful_puthex(wr, out, "\\u00", c);
 				break;
 		}
 	}
-	fputc('"', out);
+	if (p)
+		wr(out, run, p - run);
+	wr(out, "\"", 1);
 }
 
+static inline void careful_puts_quoted(careful_write_t wr, void *out,
+				       const char *data, int dir)
+{
+	const char *p, *run;
 
-static inline void fputs_quoted_case(const char *data, FILE *out, int dir)
+	wr(out, "\"", 1);
+	for (run = p = data; p && *p; p++) {
+		const unsigned char c = (unsigned char) *p;
+		char x;
+
+		if (c == 0x22 ||		/* " */
+		    c == 0x5c ||		/* \ */
+		    c == 0x60 ||		/* ` */
+		    c == 0x24 ||		/* $ */
+		    !isprint(c) ||
+		    iscntrl(c)) {
+
+			wr(out, run, p - run);
+			careful_puthex(wr, out, "\\x", c);
+			run = p + 1;
+
+		} else if (careful_case(c, dir) != c) {
+			wr(out, run, p - run);
+			x = careful_case(c, dir);
+			wr(out, &x, 1);
+			run = p + 1;
+		}
+	}
+	if (p)
+		wr(out, run, p - run);
+	wr(out, "\"", 1);
+}
+
+static inline void careful_puts_nonblank(careful_write_t wr, void *out,
+					 const char *data)
 {
-	const char *p;
-
-	fputc('"', out);
-	for (p = data; p && *p; p++) {
-		if ((unsigned char) *p == 0x22 ||		/* " */
-		    (unsigned char) *p == 0x5c ||		/* \ */
-		    (unsigned char) *p == 0x60 ||		/* ` */
-		    (unsigned char) *p == 0x24 ||		/* $ */
-		    !isprint((unsigned char) *p) ||
-		    iscntrl((unsigned char) *p)) {
-
-			fprintf(out, "\\x%02x", (unsigned char) *p);
-		} else
-			fputc(dir ==  1 ? toupper(*p) :
-			      dir == -1 ? tolower(*p) :
-			      *p, out);
+	const char *p, *run;
+
+	for (run = p = data; p && *p; p++) {
+		const unsigned char c = (unsigned char) *p;
+
+		if (isblank(c) ||
+		    c == 0x5c ||		/* \ */
+		    !isprint(c) ||
+		    iscntrl(c)) {
+
+			wr(out, run, p - run);
+			careful_puthex(wr, out, "\\x", c);
+			run = p + 1;
+		}
 	}
-	fputc('"', out);
+	if (p)
+		wr(out, run, p - run);
+}
+
+static inline void careful_fwrite(void *out, const char *buf, size_t sz)
+{
+	if (sz)
+		fwrite(buf, 1, sz, (FILE *) out);
+}
+
+static inline void fputs_quoted_case_json(const char *data, FILE *out, int dir)
+{
+	careful_puts_quoted_json(careful_fwrite, out, data, dir);
+}
+
+static inline void fputs_quoted_case(const char *data, FILE *out, int dir)
+{
+	careful_puts_quoted(careful_fwrite, out, data, dir);
 }
 
 #define fputs_quoted(_d, _o)		fputs_quoted_case(_d, _o, 0)
@@ -134,19 +221,7 @@ static inline void fputs_quoted_case(const char *data, FILE *out, int dir)
 
 static inline void fputs_nonblank(const char *data, FILE *out)
 {
-	const char *p;
-
-	for (p = data; p && *p; p++) {
-		if (isblank((unsigned char) *p) ||
-		    (unsigned char) *p == 0x5c ||		/* \ */
-		    !isprint((unsigned char) *p) ||
-		    iscntrl((unsigned char) *p)) {
-
-			fprintf(out, "\\x%02x", (unsigned char) *p);
-
-		} else
-			fputc(*p, out);
-	}
+	careful_puts_nonblank(careful_fwrite, out, data);
 }
 
 
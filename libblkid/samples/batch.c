@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2016 Karel Zak <kzak@redhat.com>
+ *
+ * This file may be redistributed under the terms of the
+ * GNU Lesser General Public License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include <blkid.h>
+
+#include "c.h"
+
+static int print_result(blkid_probe pr, size_t idx __attribute__((__unused__)),
+			const char *name, int rc,
+			void *data __attribute__((__unused__)))
+{
+	const char *type = NULL, *uuid = NULL;
+
+	if (!pr) {
+		warn("%s: cannot open", name);
+		return 0;
+	}
+	if (rc == 1) {
+		printf("%s: nothing detected\n", name);
+		return 0;
+	}
+	if (rc < 0) {
+		warnx("%s: probing failed", name);
+		return 0;
+	}
+
+	if (blkid_probe_lookup_value(pr, "TYPE", &type, NULL) == 0)
+		printf("%s: %s", name, type);
+	else if (blkid_probe_lookup_value(pr, "PTTYPE", &type, NULL) == 0)
+		printf("%s: %s partition table", name, type);
+	if (blkid_probe_lookup_value(pr, "UUID", &uuid, NULL) == 0)
+		printf(" UUID=%s", uuid);
+	printf("\n");
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	blkid_batch batch;
+	blkid_probe pr;
+	int i, rc, nthreads = 1;
+
+	if (argc < 2) {
+		fprintf(stderr, "usage: %s [-t <threads>] <device> [...]  "
+				"-- prints type of the devices\n",
+				program_invocation_short_name);
+		return EXIT_FAILURE;
+	}
+
+	batch = blkid_new_batch();
+	if (!batch)
+		err(EXIT_FAILURE, "failed to create a new libblkid batch");
+
+	i = 1;
+	if (strcmp(argv[i], "-t") == 0 && argc > 2) {
+		nthreads = atoi(argv[i + 1]);
+		i += 2;
+	}
+	if (blkid_batch_set_threads(batch, nthreads) != 0)
+		warnx("failed to set number of threads");
+
+	/* the setting is used for all devices */
+	pr = blkid_batch_get_probe(batch);
+	blkid_probe_enable_superblocks(pr, 1);
+	blkid_probe_set_superblocks_flags(pr, BLKID_SUBLKS_TYPE | BLKID_SUBLKS_UUID);
+	blkid_probe_enable_partitions(pr, 1);
+
+	for (; i < argc; i++) {
+		if (blkid_batch_add_device(batch, argv[i]) != 0)
+			err(EXIT_FAILURE, "%s: failed to add device", argv[i]);
+	}
+
+	rc = blkid_do_batch(batch, print_result, NULL);
+	if (rc < 0)
+		warnx("batch probing failed");
+
+	blkid_free_batch(batch);
+	return rc < 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,472 @@
+/*
+ * batch.c - probe many devices by one call
+ *
+ * Copyright (C) 2016 Karel Zak <kzak@redhat.com>
+ *
+ * This file may be redistributed under the terms of the
+ * GNU Lesser General Public License.
+ */
+
+/**
+ * SECTION: batch
+ * @title: Batch probing
+ * @short_description: probe many devices by one call
+ *
+ * The batch probing is designed for applications which probe many devices
+ * with the same setting. The chains, flags and filters are defined by the
+ * probe returned by blkid_batch_get_probe(), the devices are added by
+ * blkid_batch_add_device() or blkid_batch_add_fd() and probed by
+ * blkid_do_batch(). The probing result is returned by callback function.
+ *
+ * The probes (and buffers) are reused for all devices in the batch. If more
+ * threads are enabled by blkid_batch_set_threads() then the devices are probed
+ * in parallel, but the callback is always called from the blkid_do_batch()
+ * caller thread and in the same order as the devices have been added.
+ *
+ * <informalexample>
+ *  <programlisting>
+ *	static int print_type(blkid_probe pr, size_t idx, const char *name,
+ *			      int rc, void *data)
+ *	{
+ *		const char *type;
+ *
+ *		if (rc == 0 && !blkid_probe_lookup_value(pr, "TYPE", &type, NULL))
+ *			printf("%s: %s\n", name, type);
+ *		return 0;
+ *	}
+ *
+ *	batch = blkid_new_batch();
+ *	blkid_batch_set_threads(batch, 4);
+ *	blkid_probe_enable_partitions(blkid_batch_get_probe(batch), 1);
+ *
+ *	for (i = 1; i < argc; i++)
+ *		blkid_batch_add_device(batch, argv[i]);
+ *
+ *	blkid_do_batch(batch, print_type, NULL);
+ *	blkid_free_batch(batch);
+ *  </programlisting>
+ * </informalexample>
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#ifdef HAVE_LIBPTHREAD
+# include <pthread.h>
+#endif
+
+#include "blkidP.h"
+
+enum {
+	BATCH_QUEUED = 0,
+	BATCH_DONE,		/* probed, waiting for callback */
+	BATCH_RELEASED		/* callback finished, probe is free */
+};
+
+struct blkid_batch_dev {
+	char		*name;		/* device path or NULL */
+	int		fd;		/* device file descriptor or -1 */
+	int		rc;		/* probing result */
+	int		err;		/* errno if the device cannot be used */
+	int		state;		/* BATCH_* */
+	blkid_probe	pr;		/* probe with the result */
+};
+
+struct blkid_struct_batch {
+	blkid_probe	setup;		/* chains setting for all probes */
+	blkid_probe	*probes;	/* probes reused for the devices */
+	size_t		nprobes;
+
+	struct blkid_batch_dev *devs;
+	size_t		ndevs;
+	size_t		devs_sz;
+
+	unsigned int	nthreads;
+#ifdef HAVE_LIBPTHREAD
+	pthread_mutex_t	lock;
+	pthread_cond_t	cond;
+	size_t		next;		/* next device for a worker */
+	int		stop;		/* callback wants to stop */
+#endif
+};
+
+/**
+ * blkid_new_batch:
+ *
+ * Returns: new batch or NULL in case of error.
+ */
+blkid_batch blkid_new_batch(void)
+{
+	blkid_batch batch;
+
+	batch = calloc(1, sizeof(*batch));
+	if (!batch)
+		return NULL;
+
+	batch->setup = blkid_new_probe();
+	if (!batch->setup) {
+		free(batch);
+		return NULL;
+	}
+	batch->nthreads = 1;
+#ifdef HAVE_LIBPTHREAD
+	pthread_mutex_init(&batch->lock, NULL);
+	pthread_cond_init(&batch->cond, NULL);
+#endif
+	DBG(LOWPROBE, ul_debugobj(batch, "alloc batch"));
+	return batch;
+}
+
+static void reset_devs(blkid_batch batch)
+{
+	size_t i;
+
+	for (i = 0; i < batch->ndevs; i++) {
+		struct blkid_batch_dev *dev = &batch->devs[i];
+
+		/* close only devices opened by the library */
+		if (dev->name && dev->fd >= 0)
+			close(dev->fd);
+		free(dev->name);
+	}
+	batch->ndevs = 0;
+}
+
+/**
+ * blkid_free_batch:
+ * @batch: batch
+ *
+ * Deallocates the batch and all the probes.
+ */
+void blkid_free_batch(blkid_batch batch)
+{
+	size_t i;
+
+	if (!batch)
+		return;
+
+	DBG(LOWPROBE, ul_debugobj(batch, "free batch"));
+
+	reset_devs(batch);
+	free(batch->devs);
+
+	for (i = 0; i < batch->nprobes; i++)
+		blkid_free_probe(batch->probes[i]);
+	free(batch->probes);
+	blkid_free_probe(batch->setup);
+
+#ifdef HAVE_LIBPTHREAD
+	pthread_mutex_destroy(&batch->lock);
+	pthread_cond_destroy(&batch->cond);
+#endif
+	free(batch);
+}
+
+/**
+ * blkid_batch_get_probe:
+ * @batch: batch
+ *
+ * The returned probe is not used to probe the devices, but the chains setting
+ * (enabled chains, flags and filters) is copied to all probes used by
+ * blkid_do_batch(). Don't set any device to the probe.
+ *
+ * Returns: probe with setting for all devices.
+ */
+blkid_probe blkid_batch_get_probe(blkid_batch batch)
+{
+	return batch ? batch->setup : NULL;
+}
+
+/**
+ * blkid_batch_set_threads:
+ * @batch: batch
+ * @nthreads: number of threads
+ *
+ * Sets number of threads used to probe the devices in parallel. The default
+ * is 1, the devices are probed by the caller thread. The callback is always
+ * called by the blkid_do_batch() caller thread.
+ *
+ * Returns: 0 on success, or number less than zero in case of error (e.g.
+ * the library is compiled without threads support).
+ */
+int blkid_batch_set_threads(blkid_batch batch, unsigned int nthreads)
+{
+	if (!batch)
+		return -EINVAL;
+#ifndef HAVE_LIBPTHREAD
+	if (nthreads > 1)
+		return -ENOSYS;
+#endif
+	batch->nthreads = nthreads ? nthreads : 1;
+	return 0;
+}
+
+static int add_dev(blkid_batch batch, const char *name, int fd)
+{
+	struct blkid_batch_dev *dev;
+
+	if (batch->ndevs == batch->devs_sz) {
+		size_t sz = batch->devs_sz ? batch->devs_sz * 2 : 16;
+		void *tmp = realloc(batch->devs, sz * sizeof(*dev));
+
+		if (!tmp)
+			return -ENOMEM;
+		batch->devs = tmp;
+		batch->devs_sz = sz;
+	}
+
+	dev = &batch->devs[batch->ndevs];
+	memset(dev, 0, sizeof(*dev));
+	dev->fd = fd;
+	if (name) {
+		dev->name = strdup(name);
+		if (!dev->name)
+			return -ENOMEM;
+	}
+	batch->ndevs++;
+	return 0;
+}
+
+/**
+ * blkid_batch_add_device:
+ * @batch: batch
+ * @filename: device or regular file
+ *
+ * Adds device to the batch. The device is opened by blkid_do_batch() and it's
+ * closed after the callback.
+ *
+ * Returns: 0 on success, or number less than zero in case of error.
+ */
+int blkid_batch_add_device(blkid_batch batch, const char *filename)
+{
+	if (!batch || !filename)
+		return -EINVAL;
+	return add_dev(batch, filename, -1);
+}
+
+/**
+ * blkid_batch_add_fd:
+ * @batch: batch
+ * @fd: device file descriptor
+ *
+ * Adds already opened device to the batch. The file descriptor is not closed
+ * by the library.
+ *
+ * Returns: 0 on success, or number less than zero in case of error.
+ */
+int blkid_batch_add_fd(blkid_batch batch, int fd)
+{
+	if (!batch || fd < 0)
+		return -EINVAL;
+	return add_dev(batch, NULL, fd);
+}
+
+static void probe_dev(struct blkid_batch_dev *dev, blkid_probe pr)
+{
+	if (dev->name) {
+		dev->fd = open(dev->name, O_RDONLY|O_CLOEXEC);
+		if (dev->fd < 0)
+			goto err;
+	}
+	if (blkid_probe_set_device(pr, dev->fd, 0, 0) != 0)
+		goto err;
+
+	dev->rc = blkid_do_safeprobe(pr);
+	dev->pr = pr;
+	return;
+err:
+	dev->err = errno ? errno : EINVAL;
+	dev->rc = -1;
+	dev->pr = NULL;
+}
+
+static int call_cb(struct blkid_batch_dev *dev, size_t idx,
+		   blkid_batch_cb cb, void *data)
+{
+	int rc;
+
+	DBG(LOWPROBE, ul_debug("batch: %zu %s done [rc=%d]", idx,
+				dev->name ? dev->name : "<fd>", dev->rc));
+	errno = dev->err;
+	rc = cb(dev->pr, idx, dev->name, dev->rc, data);
+
+	if (dev->name && dev->fd >= 0) {
+		close(dev->fd);
+		dev->fd = -1;
+	}
+	return rc;
+}
+
+/* returns probes ready for the batch */
+static int init_probes(blkid_batch batch, size_t n)
+{
+	size_t i;
+
+	if (n > batch->nprobes) {
+		blkid_probe *tmp = realloc(batch->probes, n * sizeof(blkid_probe));
+
+		if (!tmp)
+			return -ENOMEM;
+		batch->probes = tmp;
+		for (i = batch->nprobes; i < n; i++) {
+			batch->probes[i] = blkid_new_probe();
+			if (!batch->probes[i])
+				return -ENOMEM;
+			batch->nprobes++;
+		}
+	}
+
+	for (i = 0; i < n; i++) {
+		if (blkid_probe_copy_setup(batch->probes[i], batch->setup) != 0)
+			return -ENOMEM;
+	}
+	return 0;
+}
+
+static int do_serial(blkid_batch batch, blkid_batch_cb cb, void *data)
+{
+	size_t i;
+	int rc = 0;
+
+	for (i = 0; rc == 0 && i < batch->ndevs; i++) {
+		probe_dev(&batch->devs[i], batch->probes[0]);
+		rc = call_cb(&batch->devs[i], i, cb, data);
+	}
+	return rc;
+}
+
+#ifdef HAVE_LIBPTHREAD
+struct batch_worker {
+	blkid_batch	batch;
+	blkid_probe	pr;
+	pthread_t	thread;
+};
+
+static void *batch_worker(void *data)
+{
+	struct batch_worker *w = data;
+	blkid_batch batch = w->batch;
+
+	pthread_mutex_lock(&batch->lock);
+	while (!batch->stop && batch->next < batch->ndevs) {
+		struct blkid_batch_dev *dev = &batch->devs[batch->next++];
+
+		pthread_mutex_unlock(&batch->lock);
+		probe_dev(dev, w->pr);
+		pthread_mutex_lock(&batch->lock);
+
+		dev->state = BATCH_DONE;
+		pthread_cond_broadcast(&batch->cond);
+
+		/* the probe is used by the callback */
+		while (dev->state != BATCH_RELEASED && !batch->stop)
+			pthread_cond_wait(&batch->cond, &batch->lock);
+	}
+	pthread_mutex_unlock(&batch->lock);
+	return NULL;
+}
+
+static int do_parallel(blkid_batch batch, size_t nthreads,
+		       blkid_batch_cb cb, void *data)
+{
+	struct batch_worker *workers;
+	size_t i, n = 0;
+	int rc = 0;
+
+	workers = calloc(nthreads, sizeof(*workers));
+	if (!workers)
+		return -ENOMEM;
+
+	batch->next = 0;
+	batch->stop = 0;
+
+	for (i = 0; i < nthreads; i++) {
+		workers[n].batch = batch;
+		workers[n].pr = batch->probes[i];
+		if (pthread_create(&workers[n].thread, NULL, batch_worker, &workers[n]) == 0)
+			n++;
+	}
+	DBG(LOWPROBE, ul_debugobj(batch, "batch: %zu devices, %zu threads", batch->ndevs, n));
+
+	if (!n) {
+		free(workers);
+		return do_serial(batch, cb, data);
+	}
+
+	for (i = 0; rc == 0 && i < batch->ndevs; i++) {
+		struct blkid_batch_dev *dev = &batch->devs[i];
+
+		pthread_mutex_lock(&batch->lock);
+		while (dev->state != BATCH_DONE)
+			pthread_cond_wait(&batch->cond, &batch->lock);
+		pthread_mutex_unlock(&batch->lock);
+
+		rc = call_cb(dev, i, cb, data);
+
+		pthread_mutex_lock(&batch->lock);
+		dev->state = BATCH_RELEASED;
+		if (rc)
+			batch->stop = 1;
+		pthread_cond_broadcast(&batch->cond);
+		pthread_mutex_unlock(&batch->lock);
+	}
+
+	for (i = 0; i < n; i++)
+		pthread_join(workers[i].thread, NULL);
+	free(workers);
+	return rc;
+}
+#endif /* HAVE_LIBPTHREAD */
+
+/**
+ * blkid_do_batch:
+ * @batch: batch
+ * @cb: callback
+ * @data: callback data
+ *
+ * Probes all devices in the batch by blkid_do_safeprobe() and calls @cb for
+ * each device in the order the devices have been added. The callback
+ * arguments are:
+ *
+ * - probe with the result (NULL if the device cannot be opened, errno is set
+ *   in this case), the probe is valid only within the callback
+ * - index of the device in the batch
+ * - device name or NULL for devices added by blkid_batch_add_fd()
+ * - blkid_do_safeprobe() return code
+ * - @data
+ *
+ * If the callback returns non-zero, then the batch is stopped. The list of
+ * devices in the batch is reset after the call.
+ *
+ * Returns: 0 on success, callback return code if the batch has been stopped,
+ * or number less than zero in case of error.
+ */
+int blkid_do_batch(blkid_batch batch, blkid_batch_cb cb, void *data)
+{
+	size_t nthreads;
+	int rc;
+
+	if (!batch || !cb)
+		return -EINVAL;
+	if (!batch->ndevs)
+		return 0;
+
+	nthreads = batch->nthreads;
+	if (nthreads > batch->ndevs)
+		nthreads = batch->ndevs;
+
+	rc = init_probes(batch, nthreads);
+	if (rc)
+		goto done;
+#ifdef HAVE_LIBPTHREAD
+	if (nthreads > 1)
+		rc = do_parallel(batch, nthreads, cb, data);
+	else
+#endif
+		rc = do_serial(batch, cb, data);
+done:
+	reset_devs(batch);
+	return rc;
+}
@@ -57,6 +57,8 @@ struct blkid_struct_dev
 #define BLKID_BID_FL_VERIFIED	0x0001	/* Device data validated from disk */
 #define BLKID_BID_FL_INVALID	0x0004	/* Device is invalid */
 #define BLKID_BID_FL_REMOVABLE	0x0008	/* Device added by blkid_probe_all_removable() */
+#define BLKID_BID_FL_NOACCESS	0x0010	/* Temporary, used by blkid_find_dev_with_tag() */
+#define BLKID_BID_FL_STALE	0x0020	/* Device changed according to uevents */
 
 /*
  * Each tag defines a NAME=value pair for a particular device.  The tags
@@ -72,6 +74,10 @@ struct blkid_struct_tag
 	char			*bit_name;	/* NAME of tag (shared) */
 	char			*bit_val;	/* value of tag */
 	blkid_dev		bit_dev;	/* pointer to device */
+	struct blkid_struct_tag	*bit_hnext;	/* next tag in cache hash bucket */
+	unsigned int		bit_hash;	/* hash of NAME and value */
+	unsigned int		bit_seq;	/* position in bit_names list */
+	unsigned int		bit_hashed : 1;	/* linked in cache hash */
 };
 typedef struct blkid_struct_tag *blkid_tag;
 
@@ -86,6 +92,17 @@ enum {
 	BLKID_NCHAINS		/* number of chains */
 };
 
+/*
+ * Probing statistic (see blkid_probe_enable_stats()), used also as a snapshot
+ * of the probe counters when the measured code starts
+ */
+struct blkid_probestat {
+	uint64_t		nsec;	/* wall time */
+	uint64_t		reads;	/* number of read() calls */
+	uint64_t		bytes;	/* number of bytes read */
+	uint64_t		hits;	/* requests served from buffers */
+};
+
 struct blkid_chain {
 	const struct blkid_chaindrv *driver;	/* chain driver */
 
@@ -95,6 +112,9 @@ struct blkid_chain {
 	int		idx;		/* index of the current prober (or -1) */
 	unsigned long	*fltr;		/* filter or NULL */
 	void		*data;		/* private chain data or NULL */
+
+	struct blkid_probestat	stat;		/* whole chain statistic */
+	struct blkid_probestat	*idstats;	/* per-prober statistic or NULL */
 };
 
 /*
@@ -166,11 +186,52 @@ struct blkid_idinfo
  */
 #define BLKID_IDINFO_TOLERANT	(1 << 1)
 
+/*
+ * Buffer with data from the device. The buffers are stored in the sorted
+ * array (pr->buffers), the buffers never overlap and adjacent buffers are
+ * always merged. The data are allocated from the probe arena.
+ */
 struct blkid_bufinfo {
 	unsigned char		*data;
 	uint64_t		off;
 	uint64_t		len;
-	struct list_head	bufs;	/* list of buffers */
+};
+
+/*
+ * Memory for the buffers data. The arena is a list of chunks, the memory is
+ * never released before blkid_probe_reset_buffer(), so all pointers returned
+ * by blkid_probe_get_buffer() are valid until the reset (also when the buffer
+ * has been merged with another buffer). One chunk is kept after the reset to
+ * avoid malloc() when the probe is used for another device.
+ */
+struct blkid_bufarena {
+	struct blkid_bufarena	*next;
+	size_t			size;	/* size of data[] */
+	size_t			used;	/* already allocated bytes */
+	unsigned char		data[];
+};
+
+#define BLKID_BUFARENA_SIZE	(256 * 1024)
+
+/*
+ * Read-ahead window. The probing functions usually ask for small pieces of
+ * the device (superblocks, sectors, ...); rather than to call read() for
+ * every such request we read aligned BLKID_READWIN_SIZE extents and serve
+ * all overlapping requests from them. The end of the device is read by one
+ * BLKID_READWIN_TAIL extent, there are many RAID and partition table
+ * signatures at the end of the device.
+ */
+#define BLKID_READWIN_SIZE	(64 * 1024)
+#define BLKID_READWIN_TAIL	(1024 * 1024)
+
+/*
+ * Buffers statistic
+ */
+struct blkid_bufstat {
+	uint64_t		hits;	/* requests served from buffers */
+	uint64_t		misses;	/* requests read from the device */
+	uint64_t		reads;	/* number of read() calls */
+	uint64_t		bytes;	/* number of bytes read */
 };
 
 /*
@@ -194,7 +255,12 @@ struct blkid_struct_probe
 	uint64_t		wipe_size;	/* size of the wiped area */
 	struct blkid_chain	*wipe_chain;	/* superblock, partition, ... */
 
-	struct list_head	buffers;	/* list of buffers */
+	struct blkid_bufinfo	*buffers;	/* sorted array of buffers */
+	size_t			nbuffers;	/* number of used buffers */
+	size_t			buffers_sz;	/* number of allocated buffers */
+	struct blkid_bufarena	*arena;		/* memory for buffers data */
+	struct blkid_bufarena	*arena_cached;	/* unused chunk for the next device */
+	struct blkid_bufstat	bufstat;	/* buffers statistic */
 
 	struct blkid_chain	chains[BLKID_NCHAINS];	/* array of chains */
 	struct blkid_chain	*cur_chain;		/* current chain */
@@ -210,6 +276,8 @@ struct blkid_struct_probe
 #define BLKID_FL_TINY_DEV	(1 << 2)	/* <= 1.47MiB (floppy or so) */
 #define BLKID_FL_CDROM_DEV	(1 << 3)	/* is a CD/DVD drive */
 #define BLKID_FL_NOSCAN_DEV	(1 << 4)	/* do not scan this device */
+#define BLKID_FL_NOREADWIN	(1 << 5)	/* read only requested areas */
+#define BLKID_FL_STATS		(1 << 6)	/* collect probing statistic */
 
 /* private per-probing flags */
 #define BLKID_PROBE_FL_IGNORE_PT (1 << 1)	/* ignore partition table */
@@ -235,6 +303,7 @@ struct blkid_config {
 	int nevals;			/* number of elems in eval array */
 	int uevent;			/* SEND_UEVENT=<yes|not> option */
 	char *cachefile;		/* CACHE_FILE=<path> option */
+	int cacheformat;		/* CACHE_FORMAT=<text|binary> option */
 };
 
 extern struct blkid_config *blkid_read_config(const char *filename)
@@ -260,20 +329,114 @@ extern void blkid_free_config(struct blkid_config *conf);
  * We can traverse all of the tag types by bic_tags, which hold empty tags
  * for each tag type.  Those tags can be used as list_heads for iterating
  * through all devices with a specific tag type (e.g. LABEL).
+ * The bic_hash is index of all device tags by NAME and value (see tag.c).
  */
 struct blkid_struct_cache
 {
 	struct list_head	bic_devs;	/* List head of all devices */
 	struct list_head	bic_tags;	/* List head of all tag types */
+	struct blkid_struct_tag	**bic_hash;	/* NAME=value hash of all tags */
+	size_t			bic_hashsz;	/* number of hash buckets */
+	size_t			bic_nhashed;	/* number of tags in the hash */
+	unsigned int		bic_tagseq;	/* last used tag bit_seq */
 	time_t			bic_time;	/* Last probe time */
 	time_t			bic_ftime;	/* Mod time of the cachefile */
 	unsigned int		bic_flags;	/* Status flags of the cache */
 	char			*bic_filename;	/* filename of cache */
 	blkid_probe		probe;		/* low-level probing stuff */
+
+	void			*bic_map;	/* mmap()ed binary cache file */
+	size_t			bic_mapsz;	/* size of the mapping */
+	void			*bic_objs;	/* devices and tags for the mapping */
+	size_t			bic_objsz;	/* size of bic_objs */
+
+	int			bic_uevent_fd;	/* kernel uevents socket or -1 */
+
+	unsigned int		bic_nthreads;	/* parallel probing threads or 0 */
+	unsigned int		bic_timeout;	/* parallel probing timeout (ms) */
+	struct blkid_struct_prefetch *prefetch;	/* parallel probing results */
 };
 
 #define BLKID_BIC_FL_PROBED	0x0002	/* We probed /proc/partition devices */
 #define BLKID_BIC_FL_CHANGED	0x0004	/* Cache has changed from disk */
+#define BLKID_BIC_FL_BINARY	0x0008	/* Write cache in the binary format */
+#define BLKID_BIC_FL_RESCAN	0x0010	/* New devices reported by uevents */
+
+/*
+ * Returns 1 if the device has been verified and uevents do not report any
+ * change since that time.
+ */
+static inline int blkid_dev_is_unchanged(blkid_dev dev)
+{
+	return dev->bid_cache && dev->bid_cache->bic_uevent_fd >= 0
+	       && (dev->bid_flags & BLKID_BID_FL_VERIFIED)
+	       && !(dev->bid_flags & BLKID_BID_FL_STALE);
+}
+
+/*
+ * Returns 1 if the string or the device/tag struct is part of the mmap()ed
+ * binary cache file; such data have to be not deallocated by free().
+ */
+static inline int blkid_cache_is_mapped(blkid_cache cache, const void *p)
+{
+	const char *x = p;
+
+	if (!cache || !x)
+		return 0;
+	if (cache->bic_map && x >= (char *) cache->bic_map
+	    && x < (char *) cache->bic_map + cache->bic_mapsz)
+		return 1;
+	if (cache->bic_objs && x >= (char *) cache->bic_objs
+	    && x < (char *) cache->bic_objs + cache->bic_objsz)
+		return 1;
+	return 0;
+}
+
+static inline void blkid_cache_free(blkid_cache cache, void *p)
+{
+	if (!blkid_cache_is_mapped(cache, p))
+		free(p);
+}
+
+/*
+ * Binary cache file format (see read.c and save.c)
+ *
+ *	header
+ *	device records [ndevs]
+ *	tag records [ntags]
+ *	string table [strsz], all strings are zero terminated
+ *
+ * All numbers are in the native byte order, the file is not portable.
+ */
+#define BLKID_BINCACHE_MAGIC		"\0BLKIDBC"
+#define BLKID_BINCACHE_MAGIC_LEN	8
+#define BLKID_BINCACHE_VERSION		1
+#define BLKID_BINCACHE_BYTEORDER	0x01020304
+
+struct blkid_bincache_header {
+	char		magic[BLKID_BINCACHE_MAGIC_LEN];
+	uint32_t	version;
+	uint32_t	byteorder;	/* BLKID_BINCACHE_BYTEORDER */
+	uint32_t	ndevs;		/* number of device records */
+	uint32_t	ntags;		/* number of tag records */
+	uint32_t	strsz;		/* size of the string table */
+	uint32_t	reserved;
+};
+
+struct blkid_bincache_dev {
+	uint64_t	devno;
+	int64_t		time;
+	int64_t		utime;
+	int32_t		pri;
+	uint32_t	name;		/* device name, offset in string table */
+	uint32_t	tags;		/* index of the first tag record */
+	uint32_t	ntags;		/* number of tags */
+};
+
+struct blkid_bincache_tag {
+	uint32_t	name;		/* offset in string table */
+	uint32_t	value;		/* offset in string table */
+};
 
 /* config file */
 #define BLKID_CONFIG_FILE	"/etc/blkid.conf"
@@ -342,6 +505,39 @@ extern int blkid_driver_has_major(const char *drvname, int major)
 /* lseek.c */
 extern blkid_loff_t blkid_llseek(int fd, blkid_loff_t offset, int whence);
 
+/* verify.c */
+extern void blkid_verify_setup_probe(blkid_probe pr)
+			__attribute__((nonnull));
+extern void blkid_verify_set_tag(blkid_dev dev, const char *name,
+			const char *data, size_t len)
+			__attribute__((nonnull));
+
+/* prefetch.c */
+typedef struct blkid_struct_prefetch *blkid_prefetch;
+
+enum {
+	BLKID_PREFETCH_UNKNOWN = -1,	/* device not prefetched */
+	BLKID_PREFETCH_OK = 0,		/* probing result available */
+	BLKID_PREFETCH_NONE,		/* nothing detected */
+	BLKID_PREFETCH_ERROR,		/* failed to probe the device */
+	BLKID_PREFETCH_OPENERR,		/* failed to open the device */
+	BLKID_PREFETCH_TIMEOUT		/* probing did not finish in time */
+};
+
+#ifdef HAVE_LIBPTHREAD
+extern blkid_prefetch blkid_new_prefetch(unsigned int nworkers, unsigned int timeout)
+			__attribute__((warn_unused_result));
+extern void blkid_free_prefetch(blkid_prefetch pf);
+extern int blkid_prefetch_add(blkid_prefetch pf, const char *ptname, dev_t devno)
+			__attribute__((nonnull));
+extern int blkid_prefetch_start(blkid_prefetch pf)
+			__attribute__((nonnull));
+extern int blkid_prefetch_wait(blkid_prefetch pf, dev_t devno, int *err)
+			__attribute__((nonnull(1)));
+extern void blkid_prefetch_to_tags(blkid_prefetch pf, dev_t devno, blkid_dev dev)
+			__attribute__((nonnull));
+#endif
+
 /* read.c */
 extern void blkid_read_cache(blkid_cache cache)
 			__attribute__((nonnull));
@@ -350,6 +546,9 @@ extern void blkid_read_cache(blkid_cache cache)
 extern int blkid_flush_cache(blkid_cache cache)
 			__attribute__((nonnull));
 
+/* uevent.c */
+extern int blkid_read_uevents(blkid_cache cache);
+
 /* cache */
 extern char *blkid_safe_getenv(const char *arg)
 			__attribute__((nonnull))
@@ -361,6 +560,8 @@ extern char *blkid_get_cache_filename(struct blkid_config *conf)
  * Functions to create and find a specific tag type: tag.c
  */
 extern void blkid_free_tag(blkid_tag tag);
+extern int blkid_link_tag(blkid_dev dev, blkid_tag tag)
+			__attribute__((nonnull));
 extern blkid_tag blkid_find_tag_dev(blkid_dev dev, const char *type)
 			__attribute__((nonnull))
 			__attribute__((warn_unused_result));
@@ -377,6 +578,13 @@ extern blkid_dev blkid_new_dev(void)
 extern void blkid_free_dev(blkid_dev dev);
 
 /* probe.c */
+extern int blkid_probe_copy_setup(blkid_probe dst, blkid_probe src)
+			__attribute__((nonnull));
+extern void blkid_probe_stat_begin(blkid_probe pr, struct blkid_probestat *st)
+			__attribute__((nonnull));
+extern void blkid_probe_stat_end(blkid_probe pr, struct blkid_probestat *st,
+			struct blkid_chain *chn, ssize_t idx)
+			__attribute__((nonnull));
 extern int blkid_probe_is_tiny(blkid_probe pr)
 			__attribute__((nonnull))
 			__attribute__((warn_unused_result));
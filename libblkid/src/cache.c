@@ -21,6 +21,7 @@
 #ifdef HAVE_SYS_STAT_H
 #include <sys/stat.h>
 #endif
+#include <sys/mman.h>
 #include "blkidP.h"
 #include "env.h"
 
@@ -105,13 +106,20 @@ int blkid_get_cache(blkid_cache *ret_cache, const char *filename)
 	DBG(CACHE, ul_debugobj(cache, "alloc (from %s)", filename ? filename : "default cache"));
 	INIT_LIST_HEAD(&cache->bic_devs);
 	INIT_LIST_HEAD(&cache->bic_tags);
+	cache->bic_uevent_fd = -1;
 
 	if (filename && !*filename)
 		filename = NULL;
 	if (filename)
 		cache->bic_filename = strdup(filename);
-	else
-		cache->bic_filename = blkid_get_cache_filename(NULL);
+	else {
+		struct blkid_config *conf = blkid_read_config(NULL);
+
+		cache->bic_filename = blkid_get_cache_filename(conf);
+		if (conf && conf->cacheformat == BLKID_CACHE_BINARY)
+			cache->bic_flags |= BLKID_BIC_FL_BINARY;
+		blkid_free_config(conf);
+	}
 
 	blkid_read_cache(cache);
 	*ret_cache = cache;
@@ -161,11 +169,88 @@ void blkid_put_cache(blkid_cache cache)
 	}
 
 	blkid_free_probe(cache->probe);
+	blkid_cache_enable_uevents(cache, 0);
 
+	if (cache->bic_map)
+		munmap(cache->bic_map, cache->bic_mapsz);
+	free(cache->bic_objs);
+	free(cache->bic_hash);
 	free(cache->bic_filename);
 	free(cache);
 }
 
+/**
+ * blkid_cache_set_probe_threads:
+ * @cache: cache handler
+ * @nthreads: number of threads or 0 to disable parallel probing
+ * @timeout: timeout in milliseconds for one device or 0 for no timeout
+ *
+ * Enables parallel probing of devices by blkid_probe_all() and
+ * blkid_probe_all_new(). The devices are probed by @nthreads worker threads
+ * and the results are stored to the cache in the same order as for the serial
+ * probing, so the cache content does not depend on the number of threads.
+ *
+ * If probing of a device does not finish within @timeout, then the device is
+ * not verified (the old cache data are used) and another worker thread is
+ * started to continue with the rest of the devices.
+ *
+ * The parallel probing is disabled by default.
+ *
+ * Returns: 0 on success, or number less than zero in case of error (e.g.
+ * the library is compiled without threads support).
+ */
+int blkid_cache_set_probe_threads(blkid_cache cache, unsigned int nthreads,
+				  unsigned int timeout)
+{
+	if (!cache)
+		return -BLKID_ERR_PARAM;
+#ifdef HAVE_LIBPTHREAD
+	cache->bic_nthreads = nthreads;
+	cache->bic_timeout = timeout;
+	return 0;
+#else
+	if (!nthreads)
+		return 0;
+	return -ENOSYS;
+#endif
+}
+
+/**
+ * blkid_cache_set_format:
+ * @cache: cache handler
+ * @format: BLKID_CACHE_TEXT or BLKID_CACHE_BINARY
+ *
+ * Sets format of the cache file. The binary format is mmap()ed by
+ * blkid_get_cache() and it's faster to read than the text format.
+ *
+ * The cache file is read in the both formats, the format is used for the next
+ * write of the cache file (the cache is marked as changed, so it is written
+ * by blkid_put_cache() also if there are no other changes). The default is
+ * the format of the current cache file, or CACHE_FORMAT= from blkid.conf for
+ * the default cache file.
+ *
+ * Returns: 0 on success, or number less than zero in case of error.
+ */
+int blkid_cache_set_format(blkid_cache cache, int format)
+{
+	if (!cache)
+		return -BLKID_ERR_PARAM;
+
+	switch (format) {
+	case BLKID_CACHE_TEXT:
+		cache->bic_flags &= ~BLKID_BIC_FL_BINARY;
+		break;
+	case BLKID_CACHE_BINARY:
+		cache->bic_flags |= BLKID_BIC_FL_BINARY;
+		break;
+	default:
+		return -BLKID_ERR_PARAM;
+	}
+
+	cache->bic_flags |= BLKID_BIC_FL_CHANGED;
+	return 0;
+}
+
 /**
  * blkid_gc_cache:
  * @cache: cache handler
@@ -58,9 +58,9 @@ void blkid_free_dev(blkid_dev dev)
 					   bit_tags);
 		blkid_free_tag(tag);
 	}
-	free(dev->bid_xname);
-	free(dev->bid_name);
-	free(dev);
+	blkid_cache_free(dev->bid_cache, dev->bid_xname);
+	blkid_cache_free(dev->bid_cache, dev->bid_name);
+	blkid_cache_free(dev->bid_cache, dev);
 }
 
 /*
@@ -442,6 +442,98 @@ ubi_probe_all(blkid_cache cache, int only_if_new)
 	}
 }
 
+#ifdef HAVE_LIBPTHREAD
+/*
+ * Returns TRUE if the device is already in the cache and probe_one() does
+ * not need to probe it.
+ */
+static int is_known_dev(blkid_cache cache, dev_t devno, int only_if_new)
+{
+	struct list_head *p;
+
+	list_for_each(p, &cache->bic_devs) {
+		blkid_dev tmp = list_entry(p, struct blkid_struct_dev, bid_devs);
+
+		if (tmp->bid_devno != devno)
+			continue;
+		if (blkid_dev_is_unchanged(tmp))
+			return 1;
+		if (only_if_new && !access(tmp->bid_name, F_OK))
+			return 1;
+	}
+	return 0;
+}
+
+/*
+ * Starts parallel probing of devices from /proc/partitions. The devices are
+ * selected by the same heuristic as in probe_all(): partitions and whole-disks
+ * without partitions. The results are used later by blkid_verify() called
+ * from probe_one().
+ */
+static void prefetch_all(blkid_cache cache, int only_if_new)
+{
+	FILE *proc;
+	char line[1024];
+	char ptname[128 + 1], last[128 + 1];
+	dev_t devno, last_devno = 0;
+	int ma, mi;
+	unsigned long long sz;
+	blkid_prefetch pf;
+
+	pf = blkid_new_prefetch(cache->bic_nthreads, cache->bic_timeout);
+	if (!pf)
+		return;
+
+	proc = fopen(PROC_PARTITIONS, "r" UL_CLOEXECSTR);
+	if (!proc)
+		goto err;
+
+	*last = '\0';
+	while (fgets(line, sizeof(line), proc)) {
+		size_t len;
+
+		if (sscanf(line, " %d %d %llu %128[^\n ]",
+			   &ma, &mi, &sz, ptname) != 4)
+			continue;
+		devno = makedev(ma, mi);
+		len = strlen(ptname);
+
+		/* previous whole-disk without partitions */
+		if (*last && strncmp(last, ptname, strlen(last)) != 0 &&
+		    !is_known_dev(cache, last_devno, only_if_new))
+			blkid_prefetch_add(pf, last, last_devno);
+		*last = '\0';
+
+		if (isdigit(ptname[len - 1])) {
+			if (sz > 1 && !is_known_dev(cache, devno, only_if_new))
+				blkid_prefetch_add(pf, ptname, devno);
+		} else {
+			memcpy(last, ptname, len + 1);
+			last_devno = devno;
+		}
+	}
+	if (*last && !is_known_dev(cache, last_devno, only_if_new))
+		blkid_prefetch_add(pf, last, last_devno);
+
+	fclose(proc);
+
+	if (blkid_prefetch_start(pf) == 0) {
+		cache->prefetch = pf;
+		return;
+	}
+err:
+	blkid_free_prefetch(pf);
+}
+#endif
+
+static void end_prefetch(blkid_cache cache)
+{
+#ifdef HAVE_LIBPTHREAD
+	blkid_free_prefetch(cache->prefetch);
+	cache->prefetch = NULL;
+#endif
+}
+
 /*
  * Read the device data for all available block devices in the system.
  */
@@ -464,11 +556,23 @@ static int probe_all(blkid_cache cache, int only_if_new)
 	if (!cache)
 		return -BLKID_ERR_PARAM;
 
-	if (cache->bic_flags & BLKID_BIC_FL_PROBED &&
+	if (cache->bic_uevent_fd >= 0) {
+		/* scan only if uevents report new devices */
+		blkid_read_uevents(cache);
+		if (cache->bic_flags & BLKID_BIC_FL_PROBED &&
+		    !(cache->bic_flags & BLKID_BIC_FL_RESCAN))
+			return 0;
+		cache->bic_flags &= ~BLKID_BIC_FL_RESCAN;
+
+	} else if (cache->bic_flags & BLKID_BIC_FL_PROBED &&
 	    time(0) - cache->bic_time < BLKID_PROBE_INTERVAL)
 		return 0;
 
 	blkid_read_cache(cache);
+#ifdef HAVE_LIBPTHREAD
+	if (cache->bic_nthreads)
+		prefetch_all(cache, only_if_new);
+#endif
 	evms_probe_all(cache, only_if_new);
 #ifdef VG_DIR
 	lvm_probe_all(cache, only_if_new);
@@ -476,8 +580,10 @@ static int probe_all(blkid_cache cache, int only_if_new)
 	ubi_probe_all(cache, only_if_new);
 
 	proc = fopen(PROC_PARTITIONS, "r" UL_CLOEXECSTR);
-	if (!proc)
+	if (!proc) {
+		end_prefetch(cache);
 		return -BLKID_ERR_PROC;
+	}
 
 	while (fgets(line, sizeof(line), proc)) {
 		last = which;
@@ -557,6 +663,7 @@ static int probe_all(blkid_cache cache, int only_if_new)
 		probe_one(cache, ptname, devs[which], 0, only_if_new, 0);
 
 	fclose(proc);
+	end_prefetch(cache);
 	blkid_flush_cache(cache);
 	return 0;
 }
@@ -612,7 +719,8 @@ static int probe_all_removable(blkid_cache cache)
  * blkid_probe_all:
  * @cache: cache handler
  *
- * Probes all block devices.
+ * Probes all block devices. The devices are probed in parallel if enabled by
+ * blkid_cache_set_probe_threads().
  *
  * Returns: 0 on success, or number less than zero in case of error.
  */
@@ -634,7 +742,8 @@ int blkid_probe_all(blkid_cache cache)
  * blkid_probe_all_new:
  * @cache: cache handler
  *
- * Probes all new block devices.
+ * Probes all new block devices. The devices are probed in parallel if enabled
+ * by blkid_cache_set_probe_threads().
  *
  * Returns: 0 on success, or number less than zero in case of error.
  */
@@ -597,6 +597,7 @@ static int partitions_probe(blkid_probe pr, struct blkid_chain *chn)
 
 	for ( ; i < ARRAY_SIZE(idinfos); i++) {
 		const char *name;
+		struct blkid_probestat st;
 
 		chn->idx = i;
 
@@ -605,7 +606,9 @@ static int partitions_probe(blkid_probe pr, struct blkid_chain *chn)
 			continue;
 
 		/* apply checks from idinfo */
+		blkid_probe_stat_begin(pr, &st);
 		rc = idinfo_probe(pr, idinfos[i], chn);
+		blkid_probe_stat_end(pr, &st, chn, i);
 		if (rc < 0)
 			break;
 		if (rc != BLKID_PROBE_OK)
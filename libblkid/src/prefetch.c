@@ -0,0 +1,513 @@
+/*
+ * prefetch.c - parallel probing of devices for blkid_probe_all()
+ *
+ * Copyright (C) 2016 Karel Zak <kzak@redhat.com>
+ *
+ * This file may be redistributed under the terms of the
+ * GNU Lesser General Public License.
+ *
+ * The devices are probed by a pool of worker threads, every worker uses
+ * its own blkid_probe and the results are kept in the prefetch struct. The
+ * cache itself is never touched by the workers. blkid_verify() (called from
+ * the usual serial code in devname.c) uses the prefetched results rather
+ * than to read the device, so the cache content is always the same as for
+ * the serial probing.
+ *
+ * The worker which does not finish probing within the timeout is abandoned
+ * (it's impossible to interrupt read() on a dead path) and a new worker is
+ * started to continue with the rest of the devices. The abandoned worker may
+ * outlive the cache and even exit(), so it must not use any library global
+ * data which is deallocated (e.g. by a destructor).
+ */
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <pthread.h>
+
+#include "blkidP.h"
+
+enum {
+	PF_PENDING = 0,	/* not probed yet */
+	PF_RUNNING,	/* a worker is probing the device */
+	PF_DONE		/* result is ready */
+};
+
+struct pf_value {
+	char		*name;
+	char		*data;
+	size_t		len;
+};
+
+struct pf_job {
+	char		*ptname;	/* name from /proc/partitions */
+	dev_t		devno;
+	int		state;		/* PF_* */
+	int		rc;		/* BLKID_PREFETCH_* */
+	int		err;		/* errno from open() */
+	int		abandoned;	/* timeout, the worker has been replaced */
+	struct timespec	started;	/* when state changed to PF_RUNNING */
+
+	struct pf_value	*vals;		/* probing result */
+	size_t		nvals;
+};
+
+struct blkid_struct_prefetch {
+	pthread_mutex_t	lock;
+	pthread_cond_t	cond;
+	int		refcount;	/* the caller + all workers */
+
+	struct pf_job	*jobs;		/* in order of the scanning */
+	struct pf_job	**sorted;	/* sorted by devno */
+	size_t		njobs;
+	size_t		jobs_sz;
+	size_t		next;		/* the next job for workers */
+
+	unsigned int	nworkers;	/* the pool size */
+	unsigned int	nlive;		/* workers not abandoned by timeout */
+	unsigned int	nthreads;	/* all started threads */
+	unsigned int	timeout;	/* in milliseconds */
+	int		cancelled;
+};
+
+/* max number of threads, including abandoned */
+#define PF_MAX_THREADS(_pf)	((_pf)->nworkers * 4)
+
+static void free_job(struct pf_job *job)
+{
+	size_t i;
+
+	for (i = 0; i < job->nvals; i++) {
+		free(job->vals[i].name);
+		free(job->vals[i].data);
+	}
+	free(job->vals);
+	free(job->ptname);
+}
+
+static void unref_prefetch(blkid_prefetch pf)
+{
+	size_t i;
+	int rc;
+
+	pthread_mutex_lock(&pf->lock);
+	rc = --pf->refcount;
+	pthread_mutex_unlock(&pf->lock);
+
+	if (rc > 0)
+		return;
+
+	DBG(PROBE, ul_debugobj(pf, "freeing prefetch"));
+	for (i = 0; i < pf->njobs; i++)
+		free_job(&pf->jobs[i]);
+	free(pf->jobs);
+	free(pf->sorted);
+	pthread_cond_destroy(&pf->cond);
+	pthread_mutex_destroy(&pf->lock);
+	free(pf);
+}
+
+static int open_device(const char *ptname, dev_t devno)
+{
+	char device[256];
+	struct stat st;
+	char *name;
+	int fd;
+
+	snprintf(device, sizeof(device), "/dev/%s", ptname);
+	if (stat(device, &st) == 0 && st.st_rdev == devno)
+		return open(device, O_RDONLY|O_CLOEXEC);
+
+	name = blkid_devno_to_devname(devno);
+	if (!name) {
+		errno = ENOENT;
+		return -1;
+	}
+	fd = open(name, O_RDONLY|O_CLOEXEC);
+	free(name);
+	return fd;
+}
+
+/*
+ * Probes the device, the result is stored to @job (the job is not shared
+ * with the other threads at this point).
+ */
+static void probe_job(blkid_probe pr, struct pf_job *job)
+{
+	int fd, n, i;
+
+	fd = open_device(job->ptname, job->devno);
+	if (fd < 0) {
+		job->rc = BLKID_PREFETCH_OPENERR;
+		job->err = errno;
+		return;
+	}
+
+	if (blkid_probe_set_device(pr, fd, 0, 0)) {
+		job->rc = BLKID_PREFETCH_ERROR;
+		goto done;
+	}
+
+	blkid_verify_setup_probe(pr);
+
+	if (blkid_do_safeprobe(pr)) {
+		job->rc = BLKID_PREFETCH_NONE;
+		goto done;
+	}
+
+	n = blkid_probe_numof_values(pr);
+	job->vals = n > 0 ? calloc(n, sizeof(struct pf_value)) : NULL;
+	job->rc = BLKID_PREFETCH_OK;
+
+	for (i = 0; job->vals && i < n; i++) {
+		const char *name, *data;
+		size_t len;
+		struct pf_value *v = &job->vals[job->nvals];
+
+		if (blkid_probe_get_value(pr, i, &name, &data, &len) != 0)
+			continue;
+		v->name = strdup(name);
+		v->data = malloc(len);
+		if (!v->name || !v->data) {
+			free(v->name);
+			free(v->data);
+			job->rc = BLKID_PREFETCH_ERROR;
+			break;
+		}
+		memcpy(v->data, data, len);
+		v->len = len;
+		job->nvals++;
+	}
+done:
+	blkid_reset_probe(pr);
+	blkid_probe_reset_superblocks_filter(pr);
+	close(fd);
+}
+
+static void *worker_thread(void *data)
+{
+	blkid_prefetch pf = (blkid_prefetch) data;
+	blkid_probe pr = blkid_new_probe();
+	int abandoned = 0;
+
+	pthread_mutex_lock(&pf->lock);
+
+	while (pr && !pf->cancelled && pf->next < pf->njobs) {
+		struct pf_job *job = &pf->jobs[pf->next++];
+		struct pf_job res = { .ptname = job->ptname, .devno = job->devno };
+
+		job->state = PF_RUNNING;
+		clock_gettime(CLOCK_MONOTONIC, &job->started);
+		pthread_mutex_unlock(&pf->lock);
+
+		DBG(PROBE, ul_debugobj(pf, "worker: probing %s", res.ptname));
+		probe_job(pr, &res);
+
+		pthread_mutex_lock(&pf->lock);
+		job->rc = res.rc;
+		job->err = res.err;
+		job->vals = res.vals;
+		job->nvals = res.nvals;
+		job->state = PF_DONE;
+		pthread_cond_broadcast(&pf->cond);
+
+		/* the worker has been already replaced by another one */
+		if (job->abandoned) {
+			abandoned = 1;
+			break;
+		}
+	}
+
+	if (!abandoned)
+		pf->nlive--;
+	pf->nthreads--;
+	pthread_mutex_unlock(&pf->lock);
+
+	blkid_free_probe(pr);
+	unref_prefetch(pf);
+	return NULL;
+}
+
+/* call with locked pf->lock */
+static int start_worker(blkid_prefetch pf)
+{
+	pthread_t thread;
+	pthread_attr_t attr;
+	int rc;
+
+	if (pf->nthreads >= PF_MAX_THREADS(pf))
+		return -EAGAIN;
+
+	pthread_attr_init(&attr);
+	pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+
+	pf->refcount++;
+	rc = pthread_create(&thread, &attr, worker_thread, pf);
+	pthread_attr_destroy(&attr);
+
+	if (rc) {
+		pf->refcount--;
+		return -rc;
+	}
+	pf->nthreads++;
+	pf->nlive++;
+	return 0;
+}
+
+/*
+ * Allocates a new prefetch struct for @nworkers threads and @timeout (in
+ * milliseconds, 0 means no timeout).
+ */
+blkid_prefetch blkid_new_prefetch(unsigned int nworkers, unsigned int timeout)
+{
+	blkid_prefetch pf;
+	pthread_condattr_t attr;
+
+	pf = calloc(1, sizeof(*pf));
+	if (!pf)
+		return NULL;
+
+	pthread_mutex_init(&pf->lock, NULL);
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	pthread_cond_init(&pf->cond, &attr);
+	pthread_condattr_destroy(&attr);
+
+	pf->refcount = 1;
+	pf->nworkers = nworkers ? nworkers : 1;
+	pf->timeout = timeout;
+
+	DBG(PROBE, ul_debugobj(pf, "alloc prefetch [workers=%u, timeout=%u]",
+				nworkers, timeout));
+	return pf;
+}
+
+/*
+ * Adds a device to the prefetch. It's possible to add devices before
+ * blkid_prefetch_start() only.
+ */
+int blkid_prefetch_add(blkid_prefetch pf, const char *ptname, dev_t devno)
+{
+	struct pf_job *job;
+
+	if (pf->nthreads)
+		return -EINVAL;
+
+	if (pf->njobs == pf->jobs_sz) {
+		size_t sz = pf->jobs_sz ? pf->jobs_sz * 2 : 64;
+
+		job = realloc(pf->jobs, sz * sizeof(struct pf_job));
+		if (!job)
+			return -ENOMEM;
+		pf->jobs = job;
+		pf->jobs_sz = sz;
+	}
+
+	job = &pf->jobs[pf->njobs];
+	memset(job, 0, sizeof(*job));
+	job->ptname = strdup(ptname);
+	if (!job->ptname)
+		return -ENOMEM;
+	job->devno = devno;
+	pf->njobs++;
+	return 0;
+}
+
+static int cmp_jobs(const void *a, const void *b)
+{
+	const struct pf_job *ja = *((const struct pf_job **) a),
+			    *jb = *((const struct pf_job **) b);
+
+	if (ja->devno != jb->devno)
+		return ja->devno < jb->devno ? -1 : 1;
+	/* the same devno, use the first one */
+	return ja < jb ? -1 : ja > jb;
+}
+
+int blkid_prefetch_start(blkid_prefetch pf)
+{
+	unsigned int i;
+	size_t n;
+	int rc = 0;
+
+	if (!pf->njobs)
+		return 0;
+
+	pf->sorted = malloc(pf->njobs * sizeof(struct pf_job *));
+	if (!pf->sorted)
+		return -ENOMEM;
+	for (n = 0; n < pf->njobs; n++)
+		pf->sorted[n] = &pf->jobs[n];
+	qsort(pf->sorted, pf->njobs, sizeof(struct pf_job *), cmp_jobs);
+
+	if (pf->nworkers > pf->njobs)
+		pf->nworkers = pf->njobs;
+
+	pthread_mutex_lock(&pf->lock);
+	for (i = 0; i < pf->nworkers; i++) {
+		rc = start_worker(pf);
+		if (rc)
+			break;
+	}
+	pthread_mutex_unlock(&pf->lock);
+
+	DBG(PROBE, ul_debugobj(pf, "started %u workers for %zu devices",
+				pf->nthreads, pf->njobs));
+
+	/* at least one worker is enough */
+	return pf->nthreads ? 0 : rc;
+}
+
+static struct pf_job *lookup_job(blkid_prefetch pf, dev_t devno)
+{
+	size_t lo = 0, hi = pf->njobs;
+
+	if (!pf->sorted)
+		return NULL;
+
+	/* the first job with the devno */
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+
+		if (pf->sorted[mid]->devno < devno)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if (lo < pf->njobs && pf->sorted[lo]->devno == devno)
+		return pf->sorted[lo];
+	return NULL;
+}
+
+static inline int timespec_before(const struct timespec *a,
+				  const struct timespec *b)
+{
+	return a->tv_sec < b->tv_sec ||
+	       (a->tv_sec == b->tv_sec && a->tv_nsec < b->tv_nsec);
+}
+
+/*
+ * Abandons all workers which exceeded the timeout and starts new workers
+ * instead. Returns 1 and the nearest deadline in @next if any worker is still
+ * within the timeout. Call with locked pf->lock.
+ */
+static int check_timeouts(blkid_prefetch pf, struct timespec *next)
+{
+	struct timespec now;
+	size_t i;
+	int found = 0;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	for (i = 0; i < pf->next; i++) {
+		struct pf_job *job = &pf->jobs[i];
+		struct timespec dl;
+
+		if (job->state != PF_RUNNING || job->abandoned)
+			continue;
+
+		dl = job->started;
+		dl.tv_sec += pf->timeout / 1000;
+		dl.tv_nsec += (pf->timeout % 1000) * 1000000;
+		if (dl.tv_nsec >= 1000000000) {
+			dl.tv_sec++;
+			dl.tv_nsec -= 1000000000;
+		}
+
+		if (!timespec_before(&now, &dl)) {
+			DBG(PROBE, ul_debugobj(pf, "%s: timeout, worker abandoned",
+						job->ptname));
+			job->abandoned = 1;
+			pf->nlive--;
+			if (pf->next < pf->njobs)
+				start_worker(pf);
+
+		} else if (!found || timespec_before(&dl, next)) {
+			*next = dl;
+			found = 1;
+		}
+	}
+	return found;
+}
+
+/*
+ * Waits for the result for @devno. Returns BLKID_PREFETCH_* code or
+ * BLKID_PREFETCH_UNKNOWN if the device is not prefetched.
+ */
+int blkid_prefetch_wait(blkid_prefetch pf, dev_t devno, int *err)
+{
+	struct pf_job *job;
+	int rc = BLKID_PREFETCH_UNKNOWN;
+
+	job = lookup_job(pf, devno);
+	if (!job)
+		return BLKID_PREFETCH_UNKNOWN;
+
+	pthread_mutex_lock(&pf->lock);
+
+	while (job->state != PF_DONE) {
+		struct timespec next;
+		int deadline = 0;
+
+		if (pf->timeout)
+			deadline = check_timeouts(pf, &next);
+		if (job->abandoned) {
+			rc = BLKID_PREFETCH_TIMEOUT;
+			goto done;
+		}
+		if (job->state == PF_PENDING && pf->nlive == 0
+		    && start_worker(pf) != 0)
+			/* all workers abandoned, no way to start another */
+			goto done;
+
+		if (deadline)
+			pthread_cond_timedwait(&pf->cond, &pf->lock, &next);
+		else
+			pthread_cond_wait(&pf->cond, &pf->lock);
+	}
+
+	rc = job->rc;
+	if (err)
+		*err = job->err;
+done:
+	pthread_mutex_unlock(&pf->lock);
+	return rc;
+}
+
+/*
+ * Sets tags from the prefetched result for @devno, the result has to be
+ * already available (see blkid_prefetch_wait()).
+ */
+void blkid_prefetch_to_tags(blkid_prefetch pf, dev_t devno, blkid_dev dev)
+{
+	struct pf_job *job = lookup_job(pf, devno);
+	size_t i;
+
+	if (!job || job->state != PF_DONE)
+		return;
+
+	for (i = 0; i < job->nvals; i++)
+		blkid_verify_set_tag(dev, job->vals[i].name,
+				job->vals[i].data, job->vals[i].len);
+}
+
+/*
+ * Cancels not yet started jobs and deallocates the prefetch. The running
+ * (or abandoned) workers deallocate the struct when finished.
+ */
+void blkid_free_prefetch(blkid_prefetch pf)
+{
+	if (!pf)
+		return;
+
+	pthread_mutex_lock(&pf->lock);
+	pf->cancelled = 1;
+	pthread_mutex_unlock(&pf->lock);
+
+	unref_prefetch(pf);
+}
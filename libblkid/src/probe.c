@@ -104,6 +104,8 @@
 #include <stdint.h>
 #include <stdarg.h>
 #include <limits.h>
+#include <time.h>
+#include <sys/time.h>
 
 #ifdef HAVE_LIBUUID
 # include <uuid.h>
@@ -156,7 +158,6 @@ blkid_probe blkid_new_probe(void)
 		pr->chains[i].flags = chains_drvs[i]->dflt_flags;
 		pr->chains[i].enabled = chains_drvs[i]->dflt_enabled;
 	}
-	INIT_LIST_HEAD(&pr->buffers);
 	INIT_LIST_HEAD(&pr->values);
 	return pr;
 }
@@ -254,11 +255,14 @@ void blkid_free_probe(blkid_probe pr)
 		if (ch->driver->free_data)
 			ch->driver->free_data(pr, ch->data);
 		free(ch->fltr);
+		free(ch->idstats);
 	}
 
 	if ((pr->flags & BLKID_FL_PRIVATE_FD) && pr->fd >= 0)
 		close(pr->fd);
 	blkid_probe_reset_buffer(pr);
+	free(pr->arena_cached);
+	free(pr->buffers);
 	blkid_probe_reset_values(pr);
 	blkid_free_probe(pr->disk_probe);
 
@@ -305,6 +309,119 @@ static void blkid_probe_chain_reset_position(struct blkid_chain *chn)
 	chn->idx = -1;
 }
 
+/*
+ * Copies chains setup (enabled chains, flags and filters) and statistic
+ * setting from @src to @dst, the device and probing results are not copied.
+ */
+int blkid_probe_copy_setup(blkid_probe dst, blkid_probe src)
+{
+	int i;
+
+	dst->flags &= ~BLKID_FL_STATS;
+	dst->flags |= src->flags & BLKID_FL_STATS;
+
+	for (i = 0; i < BLKID_NCHAINS; i++) {
+		struct blkid_chain *d = &dst->chains[i];
+		struct blkid_chain *s = &src->chains[i];
+
+		d->enabled = s->enabled;
+		d->flags = s->flags;
+		blkid_probe_chain_reset_position(d);
+
+		if (!s->fltr) {
+			free(d->fltr);
+			d->fltr = NULL;
+			continue;
+		}
+		if (!d->fltr) {
+			d->fltr = malloc(blkid_bmp_nbytes(d->driver->nidinfos));
+			if (!d->fltr)
+				return -ENOMEM;
+		}
+		memcpy(d->fltr, s->fltr, blkid_bmp_nbytes(d->driver->nidinfos));
+	}
+	dst->cur_chain = NULL;
+	return 0;
+}
+
+/* clock_gettime() is not used if it requires -lrt */
+static uint64_t stat_get_nsec(void)
+{
+#if defined(HAVE_CLOCK_GETTIME) && defined(CLOCK_MONOTONIC)
+	struct timespec ts;
+
+	if (clock_gettime(CLOCK_MONOTONIC, &ts) == 0)
+		return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+#endif
+	{
+		struct timeval tv;
+
+		gettimeofday(&tv, NULL);
+		return (uint64_t) tv.tv_sec * 1000000000ULL + tv.tv_usec * 1000ULL;
+	}
+}
+
+/*
+ * Saves the current probe counters to @st, the statistic is collected by
+ * blkid_probe_stat_end(). Does nothing if the statistic is not enabled.
+ */
+void blkid_probe_stat_begin(blkid_probe pr, struct blkid_probestat *st)
+{
+	if (!(pr->flags & BLKID_FL_STATS))
+		return;
+
+	st->reads = pr->bufstat.reads;
+	st->bytes = pr->bufstat.bytes;
+	st->hits = pr->bufstat.hits;
+	st->nsec = stat_get_nsec();
+}
+
+/*
+ * Adds the difference between @st and the current probe counters to the
+ * chain statistic (@idx < 0) or to the statistic of the @idx prober.
+ */
+void blkid_probe_stat_end(blkid_probe pr, struct blkid_probestat *st,
+			  struct blkid_chain *chn, ssize_t idx)
+{
+	struct blkid_probestat *res;
+
+	if (!(pr->flags & BLKID_FL_STATS))
+		return;
+
+	if (idx < 0)
+		res = &chn->stat;
+	else {
+		if ((size_t) idx >= chn->driver->nidinfos)
+			return;
+		if (!chn->idstats) {
+			chn->idstats = calloc(chn->driver->nidinfos,
+					      sizeof(struct blkid_probestat));
+			if (!chn->idstats)
+				return;
+		}
+		res = &chn->idstats[idx];
+	}
+
+	res->nsec += stat_get_nsec() - st->nsec;
+	res->reads += pr->bufstat.reads - st->reads;
+	res->bytes += pr->bufstat.bytes - st->bytes;
+	res->hits += pr->bufstat.hits - st->hits;
+}
+
+static void blkid_probe_reset_stats(blkid_probe pr)
+{
+	int i;
+
+	for (i = 0; i < BLKID_NCHAINS; i++) {
+		struct blkid_chain *chn = &pr->chains[i];
+
+		memset(&chn->stat, 0, sizeof(chn->stat));
+		if (chn->idstats)
+			memset(chn->idstats, 0, chn->driver->nidinfos
+					* sizeof(struct blkid_probestat));
+	}
+}
+
 /*
 static struct blkid_prval *blkid_probe_copy_value(struct blkid_prval *src)
 {
@@ -395,6 +512,7 @@ void *blkid_probe_get_binary_data(blkid_probe pr, struct blkid_chain *chn)
 {
 	int rc, org_prob_flags;
 	struct blkid_chain *org_chn;
+	struct blkid_probestat st;
 
 	/* save the current setting -- the binary API has to be completely
 	 * independent on the current probing status
@@ -407,7 +525,9 @@ void *blkid_probe_get_binary_data(blkid_probe pr, struct blkid_chain *chn)
 	chn->binary = TRUE;
 	blkid_probe_chain_reset_position(chn);
 
+	blkid_probe_stat_begin(pr, &st);
 	rc = chn->driver->probe(pr, chn);
+	blkid_probe_stat_end(pr, &st, chn, -1);
 
 	chn->binary = FALSE;
 	blkid_probe_chain_reset_position(chn);
@@ -565,61 +685,288 @@ int __blkid_probe_filter_types(blkid_probe pr, int chain, int flag, char *names[
 	return 0;
 }
 
-static struct blkid_bufinfo *read_buffer(blkid_probe pr, uint64_t real_off, uint64_t len)
+/* returns end of the allocation, the next allocation is aligned */
+static inline size_t arena_align(struct blkid_bufarena *ar, size_t end)
 {
-	ssize_t ret;
-	struct blkid_bufinfo *bf = NULL;
+	end = (end + 15) & ~((size_t) 15);
+	return end > ar->size ? ar->size : end;
+}
 
-	if (blkid_llseek(pr->fd, real_off, SEEK_SET) < 0) {
-		errno = 0;
-		return NULL;
-	}
+/*
+ * Allocates @len bytes from the probe arena. The memory is released by
+ * blkid_probe_reset_buffer() only. If a new oversized chunk is necessary then
+ * the chunk has space for another @reserve bytes, see arena_grow().
+ */
+static unsigned char *arena_alloc(blkid_probe pr, uint64_t len, uint64_t reserve)
+{
+	struct blkid_bufarena *ar = pr->arena;
+	unsigned char *res;
 
 	/* someone trying to overflow some buffers? */
-	if (len > ULONG_MAX - sizeof(struct blkid_bufinfo)) {
+	if (len > SIZE_MAX - sizeof(struct blkid_bufarena) - 16) {
 		errno = ENOMEM;
 		return NULL;
 	}
+	if (reserve > SIZE_MAX - sizeof(struct blkid_bufarena) - 16 - len)
+		reserve = 0;
+
+	if (!ar || ar->size - ar->used < len) {
+		size_t sz = len + reserve > BLKID_BUFARENA_SIZE ?
+					len + reserve : BLKID_BUFARENA_SIZE;
+
+		if (sz == BLKID_BUFARENA_SIZE && pr->arena_cached) {
+			/* reuse chunk from the previous device */
+			ar = pr->arena_cached;
+			pr->arena_cached = NULL;
+		} else {
+			ar = malloc(sizeof(struct blkid_bufarena) + sz);
+			if (!ar) {
+				errno = ENOMEM;
+				return NULL;
+			}
+			ar->size = sz;
+		}
+		ar->used = 0;
+
+		if (pr->arena && sz > BLKID_BUFARENA_SIZE) {
+			/* oversized chunk, keep using free space in the current one */
+			ar->next = pr->arena->next;
+			pr->arena->next = ar;
+		} else {
+			ar->next = pr->arena;
+			pr->arena = ar;
+		}
+		DBG(BUFFER, ul_debug("\tnew arena chunk %p [size=%zu]", ar, sz));
+	}
 
-	/* allocate info and space for data by one malloc call */
-	bf = calloc(1, sizeof(struct blkid_bufinfo) + len);
-	if (!bf) {
-		errno = ENOMEM;
-		return NULL;
+	res = ar->data + ar->used;
+	ar->used = arena_align(ar, ar->used + len);
+	return res;
+}
+
+/*
+ * Enlarges the last allocation from the arena chunk in place, the already
+ * used @data are not moved. Returns 0 on success, or 1 if @data are not the
+ * last allocation in the chunk or there is not enough space in the chunk.
+ */
+static int arena_grow(blkid_probe pr, unsigned char *data,
+		      uint64_t oldlen, uint64_t len)
+{
+	struct blkid_bufarena *ar;
+
+	for (ar = pr->arena; ar; ar = ar->next) {
+		size_t off;
+
+		if (data < ar->data || data >= ar->data + ar->size)
+			continue;
+
+		off = data - ar->data;
+		if (arena_align(ar, off + oldlen) != ar->used
+		    || len > ar->size - off)
+			return 1;
+
+		DBG(BUFFER, ul_debug("\tgrow %p: len=%"PRIu64" -> %"PRIu64"",
+					data, oldlen, len));
+		ar->used = arena_align(ar, off + len);
+		return 0;
 	}
+	return 1;
+}
 
-	bf->data = ((unsigned char *) bf) + sizeof(struct blkid_bufinfo);
-	bf->len = len;
-	bf->off = real_off;
-	INIT_LIST_HEAD(&bf->bufs);
+static int read_data(blkid_probe pr, unsigned char *data,
+		     uint64_t real_off, uint64_t len)
+{
+	ssize_t ret;
 
 	DBG(LOWPROBE, ul_debug("\tread %p: off=%"PRIu64" len=%"PRIu64"",
-	                       bf->data, real_off, len));
+	                       data, real_off, len));
 
-	ret = read(pr->fd, bf->data, len);
+	pr->bufstat.reads++;
+	ret = pread(pr->fd, data, len, real_off);
 	if (ret != (ssize_t) len) {
 		DBG(LOWPROBE, ul_debug("\tread failed: %m"));
-		free(bf);
 
 		/* I/O errors on CDROMs are non-fatal to work with hybrid
 		 * audio+data disks */
 		if (ret >= 0 || blkid_probe_is_cdrom(pr))
 			errno = 0;
-		return NULL;
+		return -1;
+	}
+
+	pr->bufstat.bytes += len;
+	return 0;
+}
+
+/*
+ * Returns index of the last buffer which starts at or before @real_off, or -1.
+ */
+static ssize_t lookup_buffer(blkid_probe pr, uint64_t real_off)
+{
+	size_t lo = 0, hi = pr->nbuffers;
+
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+
+		if (pr->buffers[mid].off <= real_off)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return (ssize_t) lo - 1;
+}
+
+/*
+ * Reads area @real_off and @len to the buffers. The new area is merged with
+ * all overlapping and adjacent buffers, only gaps between the already read
+ * buffers are read from the device.
+ */
+static struct blkid_bufinfo *read_buffer(blkid_probe pr, uint64_t real_off, uint64_t len)
+{
+	uint64_t beg = real_off, end = real_off + len, pos;
+	size_t first, last, i;
+	ssize_t idx;
+	unsigned char *data;
+	struct blkid_bufinfo *bf;
+
+	/* buffers to merge; the buffers[first..last-1] */
+	idx = lookup_buffer(pr, beg);
+	if (idx >= 0 && pr->buffers[idx].off + pr->buffers[idx].len >= beg)
+		first = idx;
+	else
+		first = idx + 1;
+	for (last = first; last < pr->nbuffers && pr->buffers[last].off <= end; last++);
+
+	if (last > first) {
+		bf = &pr->buffers[last - 1];
+		beg = min(beg, pr->buffers[first].off);
+		end = max(end, bf->off + bf->len);
+	}
+
+	if (last == first && pr->nbuffers == pr->buffers_sz) {
+		size_t sz = pr->buffers_sz ? pr->buffers_sz * 2 : 8;
+
+		bf = realloc(pr->buffers, sz * sizeof(struct blkid_bufinfo));
+		if (!bf) {
+			errno = ENOMEM;
+			return NULL;
+		}
+		pr->buffers = bf;
+		pr->buffers_sz = sz;
+	}
+
+	/*
+	 * The merged buffers cannot be deallocated (see struct blkid_bufarena),
+	 * so extend the first buffer in place if possible; it's the usual case
+	 * for sequential reads. Otherwise copy to a new buffer with some space
+	 * for the next merges to avoid copying the same data again and again.
+	 */
+	bf = last > first ? &pr->buffers[first] : NULL;
+	if (bf && bf->off == beg && arena_grow(pr, bf->data, bf->len, end - beg) == 0)
+		data = bf->data;
+	else {
+		data = arena_alloc(pr, end - beg, bf ? end - beg : 0);
+		if (!data)
+			return NULL;
+	}
+
+	/* copy already read data and read the gaps */
+	for (pos = beg, i = first; i < last; i++) {
+		bf = &pr->buffers[i];
+		if (pos < bf->off && read_data(pr, data + (pos - beg), pos, bf->off - pos))
+			return NULL;
+		if (bf->data != data + (bf->off - beg)) {
+			DBG(BUFFER, ul_debug("\tmerge %p: off=%"PRIu64" len=%"PRIu64"",
+					bf->data, bf->off, bf->len));
+			memcpy(data + (bf->off - beg), bf->data, bf->len);
+		}
+		pos = bf->off + bf->len;
 	}
+	if (pos < end && read_data(pr, data + (pos - beg), pos, end - pos))
+		return NULL;
 
+	/* replace the merged buffers by the new buffer */
+	if (last == first)
+		memmove(&pr->buffers[first + 1], &pr->buffers[first],
+			(pr->nbuffers - first) * sizeof(struct blkid_bufinfo));
+	else if (last > first + 1)
+		memmove(&pr->buffers[first + 1], &pr->buffers[last],
+			(pr->nbuffers - last) * sizeof(struct blkid_bufinfo));
+	pr->nbuffers = pr->nbuffers + 1 - (last - first);
+
+	bf = &pr->buffers[first];
+	bf->data = data;
+	bf->off = beg;
+	bf->len = end - beg;
 	return bf;
 }
 
+/*
+ * Returns the read-ahead window for the request, the window is always within
+ * the probing area.
+ */
+static void get_readwin(blkid_probe pr, uint64_t real_off, uint64_t len,
+			uint64_t *win_off, uint64_t *win_len)
+{
+	uint64_t beg = pr->off, end = pr->off + pr->size;
+	uint64_t wbeg, wend;
+
+	if (pr->size > BLKID_READWIN_TAIL && real_off >= end - BLKID_READWIN_TAIL) {
+		/* area at the end of the device */
+		wbeg = end - BLKID_READWIN_TAIL;
+		wend = end;
+	} else {
+		wbeg = real_off & ~((uint64_t) BLKID_READWIN_SIZE - 1);
+		wend = (real_off + len + BLKID_READWIN_SIZE - 1)
+				& ~((uint64_t) BLKID_READWIN_SIZE - 1);
+		if (wbeg < beg)
+			wbeg = beg;
+		if (wend > end)
+			wend = end;
+	}
+
+	*win_off = wbeg;
+	*win_len = wend - wbeg;
+}
+
+/*
+ * Reads data for the request. The whole read-ahead window is read if
+ * possible, if the window is not readable (e.g. I/O errors at the end of
+ * CDROMs) then only the requested area is read.
+ */
+static struct blkid_bufinfo *read_buffer_window(blkid_probe pr,
+				uint64_t real_off, uint64_t len)
+{
+	struct blkid_bufinfo *bf;
+	uint64_t win_off, win_len;
+
+	if (pr->flags & BLKID_FL_NOREADWIN)
+		return read_buffer(pr, real_off, len);
+
+	get_readwin(pr, real_off, len, &win_off, &win_len);
+	if (win_off == real_off && win_len == len)
+		return read_buffer(pr, real_off, len);
+
+	bf = read_buffer(pr, win_off, win_len);
+	if (bf)
+		return bf;
+	if (errno == ENOMEM)
+		return NULL;
+
+	DBG(BUFFER, ul_debug("\t  read-ahead window failed, disable it"));
+	pr->flags |= BLKID_FL_NOREADWIN;
+
+	return read_buffer(pr, real_off, len);
+}
+
 /*
  * Note that @off is offset within probing area, the probing area is defined by
  * pr->off and pr->size.
  */
 unsigned char *blkid_probe_get_buffer(blkid_probe pr, uint64_t off, uint64_t len)
 {
-	struct list_head *p;
 	struct blkid_bufinfo *bf = NULL;
 	uint64_t real_off = pr->off + off;
+	ssize_t idx;
 
 	/*
 	DBG(BUFFER, ul_debug("\t>>>> off=%ju, real-off=%ju (probe <%ju..%ju>, len=%ju",
@@ -653,26 +1000,25 @@ unsigned char *blkid_probe_get_buffer(blkid_probe pr, uint64_t off, uint64_t len
 	}
 
 	/* try buffers we already have in memory */
-	list_for_each(p, &pr->buffers) {
-		struct blkid_bufinfo *x =
-				list_entry(p, struct blkid_bufinfo, bufs);
+	idx = lookup_buffer(pr, real_off);
+	if (idx >= 0) {
+		struct blkid_bufinfo *x = &pr->buffers[idx];
 
-		if (real_off >= x->off && real_off + len <= x->off + x->len) {
+		if (real_off + len <= x->off + x->len) {
 			DBG(BUFFER, ul_debug("\treuse %p: off=%"PRIu64" len=%"PRIu64" (for off=%"PRIu64" len=%"PRIu64")",
 						x->data, x->off, x->len, real_off, len));
 			bf = x;
-			break;
 		}
 	}
 
 	/* not found; read from disk */
 	if (!bf) {
-		bf = read_buffer(pr, real_off, len);
+		pr->bufstat.misses++;
+		bf = read_buffer_window(pr, real_off, len);
 		if (!bf)
 			return NULL;
-
-		list_add_tail(&bf->bufs, &pr->buffers);
-	}
+	} else
+		pr->bufstat.hits++;
 
 	assert(bf->off <= real_off);
 	assert(bf->off + bf->len >= real_off + len);
@@ -685,27 +1031,34 @@ static void blkid_probe_reset_buffer(blkid_probe pr)
 {
 	uint64_t ct = 0, len = 0;
 
-	if (list_empty(&pr->buffers))
+	if (!pr->arena)
 		return;
 
 	DBG(BUFFER, ul_debug("Resetting probing buffers pr=%p", pr));
 
-	while (!list_empty(&pr->buffers)) {
-		struct blkid_bufinfo *bf = list_entry(pr->buffers.next,
-						struct blkid_bufinfo, bufs);
+	while (pr->arena) {
+		struct blkid_bufarena *ar = pr->arena;
+
+		pr->arena = ar->next;
 		ct++;
-		len += bf->len;
-		list_del(&bf->bufs);
+		len += ar->used;
+
+		DBG(BUFFER, ul_debug(" remove arena chunk: %p [used=%zu, size=%zu]",
+		                     ar, ar->used, ar->size));
 
-		DBG(BUFFER, ul_debug(" remove buffer: %p [off=%"PRIu64", len=%"PRIu64"]",
-		                     bf->data, bf->off, bf->len));
-		free(bf);
+		/* keep one chunk, the probe is often reused for another device */
+		if (!pr->arena_cached && ar->size == BLKID_BUFARENA_SIZE)
+			pr->arena_cached = ar;
+		else
+			free(ar);
 	}
 
-	DBG(LOWPROBE, ul_debug(" buffers summary: %"PRIu64" bytes by %"PRIu64" read() calls",
-			len, ct));
+	DBG(LOWPROBE, ul_debug(" buffers summary: %"PRIu64" bytes in %"PRIu64" chunks, "
+			"%zu buffers (hits=%"PRIu64", misses=%"PRIu64", reads=%"PRIu64")",
+			len, ct, pr->nbuffers, pr->bufstat.hits, pr->bufstat.misses,
+			pr->bufstat.reads));
 
-	INIT_LIST_HEAD(&pr->buffers);
+	pr->nbuffers = 0;
 }
 
 static void blkid_probe_reset_values(blkid_probe pr)
@@ -812,6 +1165,7 @@ int blkid_probe_set_device(blkid_probe pr, int fd,
 	pr->flags &= ~BLKID_FL_PRIVATE_FD;
 	pr->flags &= ~BLKID_FL_TINY_DEV;
 	pr->flags &= ~BLKID_FL_CDROM_DEV;
+	pr->flags &= ~BLKID_FL_NOREADWIN;
 	pr->prob_flags = 0;
 	pr->fd = fd;
 	pr->off = (uint64_t) off;
@@ -823,6 +1177,8 @@ int blkid_probe_set_device(blkid_probe pr, int fd,
 	pr->wipe_off = 0;
 	pr->wipe_size = 0;
 	pr->wipe_chain = NULL;
+	memset(&pr->bufstat, 0, sizeof(pr->bufstat));
+	blkid_probe_reset_stats(pr);
 
 #if defined(POSIX_FADV_RANDOM) && defined(HAVE_POSIX_FADVISE)
 	/* Disable read-ahead */
@@ -1025,6 +1381,7 @@ static inline void blkid_probe_end(blkid_probe pr)
 int blkid_do_probe(blkid_probe pr)
 {
 	int rc = 1;
+	struct blkid_probestat st;
 
 	if (pr->flags & BLKID_FL_NOSCAN_DEV)
 		return 1;
@@ -1067,7 +1424,9 @@ int blkid_do_probe(blkid_probe pr)
 			continue;
 
 		/* rc: -1 = error, 0 = success, 1 = no result */
+		blkid_probe_stat_begin(pr, &st);
 		rc = chn->driver->probe(pr, chn);
+		blkid_probe_stat_end(pr, &st, chn, -1);
 
 	} while (rc == 1);
 
@@ -1271,6 +1630,7 @@ int blkid_probe_step_back(blkid_probe pr)
 int blkid_do_safeprobe(blkid_probe pr)
 {
 	int i, count = 0, rc = 0;
+	struct blkid_probestat st;
 
 	if (pr->flags & BLKID_FL_NOSCAN_DEV)
 		return 1;
@@ -1292,7 +1652,9 @@ int blkid_do_safeprobe(blkid_probe pr)
 
 		blkid_probe_chain_reset_position(chn);
 
+		blkid_probe_stat_begin(pr, &st);
 		rc = chn->driver->safeprobe(pr, chn);
+		blkid_probe_stat_end(pr, &st, chn, -1);
 
 		blkid_probe_chain_reset_position(chn);
 
@@ -1325,6 +1687,7 @@ done:
 int blkid_do_fullprobe(blkid_probe pr)
 {
 	int i, count = 0, rc = 0;
+	struct blkid_probestat st;
 
 	if (pr->flags & BLKID_FL_NOSCAN_DEV)
 		return 1;
@@ -1346,7 +1709,9 @@ int blkid_do_fullprobe(blkid_probe pr)
 
 		blkid_probe_chain_reset_position(chn);
 
+		blkid_probe_stat_begin(pr, &st);
 		rc = chn->driver->probe(pr, chn);
+		blkid_probe_stat_end(pr, &st, chn, -1);
 
 		blkid_probe_chain_reset_position(chn);
 
@@ -1648,6 +2013,164 @@ int blkid_probe_get_fd(blkid_probe pr)
 	return pr->fd;
 }
 
+/**
+ * blkid_probe_get_buffers_stat:
+ * @pr: probe
+ * @hits: returns number of requests served from already read data or NULL
+ * @misses: returns number of requests read from the device or NULL
+ * @bytes: returns number of bytes read from the device or NULL
+ *
+ * The library reads the device by read-ahead windows and all probing
+ * functions share the data. This function returns statistic about the
+ * buffers since the last blkid_probe_set_device() call.
+ *
+ * Returns: 0 on success, or -1 in case of error.
+ */
+int blkid_probe_get_buffers_stat(blkid_probe pr, uint64_t *hits,
+				 uint64_t *misses, uint64_t *bytes)
+{
+	if (!pr)
+		return -1;
+	if (hits)
+		*hits = pr->bufstat.hits;
+	if (misses)
+		*misses = pr->bufstat.misses;
+	if (bytes)
+		*bytes = pr->bufstat.bytes;
+	return 0;
+}
+
+/**
+ * blkid_probe_enable_stats:
+ * @pr: probe
+ * @enable: TRUE/FALSE
+ *
+ * Enables wall time and I/O statistic for the probing chains and for the
+ * individual probing functions (see blkid_probe_get_chain_stats() and
+ * blkid_probe_get_prober_stats()). The statistic is reset by
+ * blkid_probe_set_device(), so it describes the current device only.
+ *
+ * Returns: 0 on success, or -1 in case of error.
+ */
+int blkid_probe_enable_stats(blkid_probe pr, int enable)
+{
+	if (!pr)
+		return -1;
+	if (enable)
+		pr->flags |= BLKID_FL_STATS;
+	else
+		pr->flags &= ~BLKID_FL_STATS;
+	return 0;
+}
+
+static struct blkid_chain *get_chain_by_name(blkid_probe pr, const char *name)
+{
+	int i;
+
+	for (i = 0; i < BLKID_NCHAINS; i++) {
+		if (strcmp(pr->chains[i].driver->name, name) == 0)
+			return &pr->chains[i];
+	}
+	return NULL;
+}
+
+static void fill_stats(const struct blkid_probestat *st, uint64_t *usec,
+			uint64_t *reads, uint64_t *bytes, uint64_t *hits)
+{
+	if (usec)
+		*usec = st ? st->nsec / 1000 : 0;
+	if (reads)
+		*reads = st ? st->reads : 0;
+	if (bytes)
+		*bytes = st ? st->bytes : 0;
+	if (hits)
+		*hits = st ? st->hits : 0;
+}
+
+/**
+ * blkid_probe_get_chain_stats:
+ * @pr: probe
+ * @chain: "superblocks", "partitions" or "topology"
+ * @usec: returns wall time in microseconds or NULL
+ * @reads: returns number of read() calls or NULL
+ * @bytes: returns number of bytes read from the device or NULL
+ * @hits: returns number of requests served from already read data or NULL
+ *
+ * Returns statistic for the whole probing chain since the last
+ * blkid_probe_set_device() call. The statistic has to be enabled by
+ * blkid_probe_enable_stats().
+ *
+ * Returns: 0 on success, or -1 in case of error.
+ */
+int blkid_probe_get_chain_stats(blkid_probe pr, const char *chain,
+				uint64_t *usec, uint64_t *reads,
+				uint64_t *bytes, uint64_t *hits)
+{
+	struct blkid_chain *chn;
+
+	if (!pr || !chain)
+		return -1;
+	chn = get_chain_by_name(pr, chain);
+	if (!chn)
+		return -1;
+
+	fill_stats(&chn->stat, usec, reads, bytes, hits);
+	return 0;
+}
+
+/**
+ * blkid_probe_get_prober_stats:
+ * @pr: probe
+ * @chain: "superblocks", "partitions" or "topology"
+ * @idx: number >= 0
+ * @name: returns name of the probing function (e.g. "ext4") or NULL
+ * @usec: returns wall time in microseconds or NULL
+ * @reads: returns number of read() calls or NULL
+ * @bytes: returns number of bytes read from the device or NULL
+ * @hits: returns number of requests served from already read data or NULL
+ *
+ * Returns statistic for the @idx probing function of the chain since the last
+ * blkid_probe_set_device() call. The time includes magic strings lookup. The
+ * functions called from another probing function (e.g. BSD partition table
+ * nested in DOS partition) are accounted to the caller.
+ *
+ * <informalexample>
+ *  <programlisting>
+ *	size_t i;
+ *	const char *name;
+ *	uint64_t usec;
+ *
+ *	for (i = 0; blkid_probe_get_prober_stats(pr, "superblocks", i,
+ *				&name, &usec, NULL, NULL, NULL) == 0; i++) {
+ *		if (usec)
+ *			printf("%s: %ju usec\n", name, (uintmax_t) usec);
+ *	}
+ *  </programlisting>
+ * </informalexample>
+ *
+ * Returns: 0 on success, 1 if @idx is out of range, or -1 in case of error.
+ */
+int blkid_probe_get_prober_stats(blkid_probe pr, const char *chain, size_t idx,
+				 const char **name, uint64_t *usec,
+				 uint64_t *reads, uint64_t *bytes, uint64_t *hits)
+{
+	struct blkid_chain *chn;
+
+	if (!pr || !chain)
+		return -1;
+	chn = get_chain_by_name(pr, chain);
+	if (!chn)
+		return -1;
+	if (idx >= chn->driver->nidinfos)
+		return 1;
+
+	if (name)
+		*name = chn->driver->idinfos[idx]->name;
+	fill_stats(chn->idstats ? &chn->idstats[idx] : NULL,
+			usec, reads, bytes, hits);
+	return 0;
+}
+
 /**
  * blkid_probe_get_sectorsize:
  * @pr: probe or NULL (for NULL returns 512)
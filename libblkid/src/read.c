@@ -19,6 +19,7 @@
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <unistd.h>
+#include <sys/mman.h>
 #ifdef HAVE_ERRNO_H
 #include <errno.h>
 #endif
@@ -383,6 +384,206 @@ done:
 	return ret;
 }
 
+/*
+ * Returns pointer to the mmap()ed binary cache or NULL if the file content is
+ * not valid.
+ */
+static struct blkid_bincache_header *map_binary(int fd, size_t sz)
+{
+	struct blkid_bincache_header *hdr;
+	struct blkid_bincache_dev *devs;
+	struct blkid_bincache_tag *tags;
+	const char *strs;
+	uint64_t expected;
+	size_t i, ntags;
+
+	if (sz < sizeof(*hdr))
+		return NULL;
+
+	hdr = mmap(NULL, sz, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (hdr == MAP_FAILED)
+		return NULL;
+
+	if (hdr->version != BLKID_BINCACHE_VERSION ||
+	    hdr->byteorder != BLKID_BINCACHE_BYTEORDER) {
+		DBG(READ, ul_debug("binary cache: unsupported version or byte order"));
+		goto err;
+	}
+
+	expected = sizeof(*hdr)
+		 + (uint64_t) hdr->ndevs * sizeof(struct blkid_bincache_dev)
+		 + (uint64_t) hdr->ntags * sizeof(struct blkid_bincache_tag)
+		 + hdr->strsz;
+	if (expected != sz || !hdr->strsz) {
+		DBG(READ, ul_debug("binary cache: unexpected size"));
+		goto err;
+	}
+
+	devs = (struct blkid_bincache_dev *) (hdr + 1);
+	tags = (struct blkid_bincache_tag *) (devs + hdr->ndevs);
+	strs = (const char *) (tags + hdr->ntags);
+
+	if (strs[hdr->strsz - 1] != '\0')
+		goto corrupted;
+	/* tags of the devices follow each other */
+	for (i = 0, ntags = 0; i < hdr->ndevs; i++) {
+		if (devs[i].name >= hdr->strsz ||
+		    devs[i].tags != ntags ||
+		    devs[i].ntags > hdr->ntags - ntags)
+			goto corrupted;
+		ntags += devs[i].ntags;
+	}
+	if (ntags != hdr->ntags)
+		goto corrupted;
+	for (i = 0; i < hdr->ntags; i++) {
+		if (tags[i].name >= hdr->strsz || tags[i].value >= hdr->strsz)
+			goto corrupted;
+	}
+	return hdr;
+corrupted:
+	DBG(READ, ul_debug("binary cache: corrupted records"));
+err:
+	munmap(hdr, sz);
+	return NULL;
+}
+
+/*
+ * Use devices and tags from the binary cache directly, all strings point to
+ * the mapping and all structs are allocated by one calloc(). This is possible
+ * only if the cache is empty (the names are unique in the file).
+ */
+static int use_binary(blkid_cache cache, struct blkid_bincache_header *hdr, size_t sz)
+{
+	struct blkid_bincache_dev *devs = (struct blkid_bincache_dev *) (hdr + 1);
+	struct blkid_bincache_tag *tags = (struct blkid_bincache_tag *) (devs + hdr->ndevs);
+	char *strs = (char *) (tags + hdr->ntags);
+	struct blkid_struct_dev *dev;
+	struct blkid_struct_tag *tag;
+	size_t i, j;
+
+	cache->bic_objsz = hdr->ndevs * sizeof(struct blkid_struct_dev)
+			 + hdr->ntags * sizeof(struct blkid_struct_tag);
+	cache->bic_objs = cache->bic_objsz ? calloc(1, cache->bic_objsz) : NULL;
+	if (!cache->bic_objs) {
+		cache->bic_objsz = 0;
+		return -BLKID_ERR_MEM;
+	}
+	cache->bic_map = hdr;
+	cache->bic_mapsz = sz;
+
+	dev = cache->bic_objs;
+	tag = (struct blkid_struct_tag *) (dev + hdr->ndevs);
+
+	for (i = 0; i < hdr->ndevs; i++, dev++) {
+		struct blkid_bincache_dev *d = &devs[i];
+
+		INIT_LIST_HEAD(&dev->bid_devs);
+		INIT_LIST_HEAD(&dev->bid_tags);
+		dev->bid_name = strs + d->name;
+
+		if (*dev->bid_name != '/' || access(dev->bid_name, F_OK) < 0) {
+			DBG(READ, ul_debug("ignore %s", dev->bid_name));
+			continue;
+		}
+
+		dev->bid_cache = cache;
+		dev->bid_devno = d->devno;
+		dev->bid_pri = d->pri;
+		dev->bid_time = d->time;
+		dev->bid_utime = d->utime;
+
+		for (j = 0; j < d->ntags; j++, tag++) {
+			struct blkid_bincache_tag *t = &tags[d->tags + j];
+
+			INIT_LIST_HEAD(&tag->bit_tags);
+			INIT_LIST_HEAD(&tag->bit_names);
+			tag->bit_name = strs + t->name;
+			tag->bit_val = strs + t->value;
+
+			if (blkid_link_tag(dev, tag) != 0)
+				return -BLKID_ERR_MEM;
+
+			if (!strcmp(tag->bit_name, "TYPE"))
+				dev->bid_type = tag->bit_val;
+			else if (!strcmp(tag->bit_name, "LABEL"))
+				dev->bid_label = tag->bit_val;
+			else if (!strcmp(tag->bit_name, "UUID"))
+				dev->bid_uuid = tag->bit_val;
+		}
+
+		list_add_tail(&dev->bid_devs, &cache->bic_devs);
+
+		if (dev->bid_type == NULL) {
+			DBG(READ, ul_debug("blkid: device %s has no TYPE", dev->bid_name));
+			blkid_free_dev(dev);
+		}
+	}
+	return 0;
+}
+
+/*
+ * Merge devices and tags from the binary cache to the (not empty) cache. The
+ * strings are copied, so the mapping is not used after that.
+ */
+static int merge_binary(blkid_cache cache, struct blkid_bincache_header *hdr)
+{
+	struct blkid_bincache_dev *devs = (struct blkid_bincache_dev *) (hdr + 1);
+	struct blkid_bincache_tag *tags = (struct blkid_bincache_tag *) (devs + hdr->ndevs);
+	const char *strs = (const char *) (tags + hdr->ntags);
+	size_t i, j;
+
+	for (i = 0; i < hdr->ndevs; i++) {
+		struct blkid_bincache_dev *d = &devs[i];
+		blkid_dev dev;
+
+		dev = blkid_get_dev(cache, strs + d->name, BLKID_DEV_CREATE);
+		if (!dev)
+			continue;
+
+		dev->bid_devno = d->devno;
+		dev->bid_pri = d->pri;
+		dev->bid_time = d->time;
+		dev->bid_utime = d->utime;
+
+		for (j = 0; j < d->ntags; j++) {
+			struct blkid_bincache_tag *t = &tags[d->tags + j];
+			const char *val = strs + t->value;
+
+			if (blkid_set_tag(dev, strs + t->name, val, strlen(val)) < 0)
+				return -BLKID_ERR_MEM;
+		}
+		if (dev->bid_type == NULL) {
+			DBG(READ, ul_debug("blkid: device %s has no TYPE", dev->bid_name));
+			blkid_free_dev(dev);
+		}
+	}
+	return 0;
+}
+
+static int read_binary(blkid_cache cache, int fd, struct stat *st)
+{
+	struct blkid_bincache_header *hdr;
+	size_t sz = st->st_size;
+	int rc;
+
+	hdr = map_binary(fd, sz);
+	if (!hdr)
+		return -BLKID_ERR_CACHE;
+
+	DBG(CACHE, ul_debug("using binary cache (%u devices, %u tags)",
+				hdr->ndevs, hdr->ntags));
+
+	if (list_empty(&cache->bic_devs) && !cache->bic_map && hdr->ndevs) {
+		rc = use_binary(cache, hdr, sz);
+		if (cache->bic_map == hdr)
+			return rc;
+	} else
+		rc = merge_binary(cache, hdr);
+
+	munmap(hdr, sz);
+	return rc;
+}
+
 /*
  * Parse the specified filename, and return the data in the supplied or
  * a newly allocated cache struct.  If the file doesn't exist, return a
@@ -392,6 +593,7 @@ void blkid_read_cache(blkid_cache cache)
 {
 	FILE *file;
 	char buf[4096];
+	char magic[BLKID_BINCACHE_MAGIC_LEN];
 	int fd, lineno = 0;
 	struct stat st;
 
@@ -413,6 +615,16 @@ void blkid_read_cache(blkid_cache cache)
 	DBG(CACHE, ul_debug("reading cache file %s",
 				cache->bic_filename));
 
+	if (read(fd, magic, sizeof(magic)) == sizeof(magic) &&
+	    memcmp(magic, BLKID_BINCACHE_MAGIC, sizeof(magic)) == 0) {
+		cache->bic_flags |= BLKID_BIC_FL_BINARY;
+		read_binary(cache, fd, &st);
+		close(fd);
+		goto done;
+	}
+	if (lseek(fd, 0, SEEK_SET) != 0)
+		goto errout;
+
 	file = fdopen(fd, "r" UL_CLOEXECSTR);
 	if (!file)
 		goto errout;
@@ -438,7 +650,7 @@ void blkid_read_cache(blkid_cache cache)
 		}
 	}
 	fclose(file);
-
+done:
 	/*
 	 * Initially we do not need to write out the cache file.
 	 */
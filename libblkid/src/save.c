@@ -73,6 +73,154 @@ static int save_dev(blkid_dev dev, FILE *file)
 	return 0;
 }
 
+struct bincache_buf {
+	char	*data;
+	size_t	len;
+	size_t	sz;
+};
+
+static int buf_append(struct bincache_buf *buf, const void *data, size_t len)
+{
+	if (buf->len + len > buf->sz) {
+		size_t sz = buf->sz ? buf->sz : 4096;
+		char *x;
+
+		while (sz < buf->len + len)
+			sz <<= 1;
+		x = realloc(buf->data, sz);
+		if (!x)
+			return -BLKID_ERR_MEM;
+		buf->data = x;
+		buf->sz = sz;
+	}
+	memcpy(buf->data + buf->len, data, len);
+	buf->len += len;
+	return 0;
+}
+
+/* returns offset of the string in the string table or -1 */
+static int64_t buf_append_str(struct bincache_buf *buf, const char *str)
+{
+	size_t off = buf->len;
+
+	if (off > UINT32_MAX || buf_append(buf, str, strlen(str) + 1) != 0)
+		return -1;
+	return off;
+}
+
+/* tag names are shared, the number of names is small */
+static int64_t buf_append_name(struct bincache_buf *buf, const char *name,
+			       uint32_t *names, size_t *nnames, size_t maxnames)
+{
+	int64_t off;
+	size_t i;
+
+	for (i = 0; i < *nnames; i++) {
+		if (strcmp(buf->data + names[i], name) == 0)
+			return names[i];
+	}
+	off = buf_append_str(buf, name);
+	if (off >= 0 && *nnames < maxnames)
+		names[(*nnames)++] = off;
+	return off;
+}
+
+static int is_saved_dev(blkid_dev dev)
+{
+	return dev->bid_type && !(dev->bid_flags & BLKID_BID_FL_REMOVABLE)
+	       && dev->bid_name[0] == '/';
+}
+
+/*
+ * Write all the cache to the file by one fwrite().
+ */
+static int save_binary(blkid_cache cache, FILE *file)
+{
+	struct blkid_bincache_header hdr;
+	struct bincache_buf recs = { 0 }, strs = { 0 };
+	struct list_head *p, *t;
+	uint32_t names[32];
+	size_t nnames = 0;
+	int ret = -BLKID_ERR_MEM;
+
+	memset(&hdr, 0, sizeof(hdr));
+	memcpy(hdr.magic, BLKID_BINCACHE_MAGIC, sizeof(hdr.magic));
+	hdr.version = BLKID_BINCACHE_VERSION;
+	hdr.byteorder = BLKID_BINCACHE_BYTEORDER;
+
+	/* devices */
+	list_for_each(p, &cache->bic_devs) {
+		blkid_dev dev = list_entry(p, struct blkid_struct_dev, bid_devs);
+		struct blkid_bincache_dev d;
+		int64_t off;
+
+		if (!is_saved_dev(dev))
+			continue;
+
+		memset(&d, 0, sizeof(d));
+		off = buf_append_str(&strs, dev->bid_name);
+		if (off < 0)
+			goto done;
+		d.name = off;
+		d.devno = dev->bid_devno;
+		d.time = dev->bid_time;
+		d.utime = dev->bid_utime;
+		d.pri = dev->bid_pri;
+		d.tags = hdr.ntags;
+		list_for_each(t, &dev->bid_tags)
+			d.ntags++;
+		hdr.ntags += d.ntags;
+		hdr.ndevs++;
+
+		if (buf_append(&recs, &d, sizeof(d)) != 0)
+			goto done;
+	}
+
+	/* tags */
+	list_for_each(p, &cache->bic_devs) {
+		blkid_dev dev = list_entry(p, struct blkid_struct_dev, bid_devs);
+
+		if (!is_saved_dev(dev))
+			continue;
+
+		list_for_each(t, &dev->bid_tags) {
+			blkid_tag tag = list_entry(t, struct blkid_struct_tag, bit_tags);
+			struct blkid_bincache_tag x;
+			int64_t name, val;
+
+			name = buf_append_name(&strs, tag->bit_name,
+					names, &nnames, ARRAY_SIZE(names));
+			val = buf_append_str(&strs, tag->bit_val);
+			if (name < 0 || val < 0)
+				goto done;
+			x.name = name;
+			x.value = val;
+			if (buf_append(&recs, &x, sizeof(x)) != 0)
+				goto done;
+		}
+	}
+
+	if (!strs.len && buf_append(&strs, "", 1) != 0)
+		goto done;
+	if (strs.len > UINT32_MAX)
+		goto done;
+	hdr.strsz = strs.len;
+
+	DBG(SAVE, ul_debug("binary cache: %u devices, %u tags, %u bytes of strings",
+				hdr.ndevs, hdr.ntags, hdr.strsz));
+
+	if (fwrite(&hdr, sizeof(hdr), 1, file) != 1 ||
+	    (recs.len && fwrite(recs.data, recs.len, 1, file) != 1) ||
+	    fwrite(strs.data, strs.len, 1, file) != 1)
+		ret = -BLKID_ERR_IO;
+	else
+		ret = 0;
+done:
+	free(recs.data);
+	free(strs.data);
+	return ret;
+}
+
 /*
  * Write out the cache struct to the cache file on disk.
  */
@@ -144,6 +292,16 @@ int blkid_flush_cache(blkid_cache cache)
 	}
 
 	if (!file) {
+		/*
+		 * The binary cache file is mmap()ed by readers, never
+		 * truncate it in place.
+		 */
+		if ((cache->bic_flags & BLKID_BIC_FL_BINARY)
+		    && ret == 0 && S_ISREG(st.st_mode)) {
+			DBG(SAVE, ul_debug("can't replace binary cache %s", filename));
+			ret = 0;
+			goto errout;
+		}
 		file = fopen(filename, "w" UL_CLOEXECSTR);
 		opened = filename;
 	}
@@ -156,12 +314,16 @@ int blkid_flush_cache(blkid_cache cache)
 		goto errout;
 	}
 
-	list_for_each(p, &cache->bic_devs) {
-		blkid_dev dev = list_entry(p, struct blkid_struct_dev, bid_devs);
-		if (!dev->bid_type || (dev->bid_flags & BLKID_BID_FL_REMOVABLE))
-			continue;
-		if ((ret = save_dev(dev, file)) < 0)
-			break;
+	if (cache->bic_flags & BLKID_BIC_FL_BINARY)
+		ret = save_binary(cache, file);
+	else {
+		list_for_each(p, &cache->bic_devs) {
+			blkid_dev dev = list_entry(p, struct blkid_struct_dev, bid_devs);
+			if (!dev->bid_type || (dev->bid_flags & BLKID_BID_FL_REMOVABLE))
+				continue;
+			if ((ret = save_dev(dev, file)) < 0)
+				break;
+		}
 	}
 
 	if (ret >= 0) {
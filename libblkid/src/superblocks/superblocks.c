@@ -18,6 +18,9 @@
 #include <errno.h>
 #include <stdint.h>
 #include <stdarg.h>
+#ifdef HAVE_LIBPTHREAD
+# include <pthread.h>
+#endif
 
 #include "superblocks.h"
 
@@ -78,6 +81,7 @@
 
 static int superblocks_probe(blkid_probe pr, struct blkid_chain *chn);
 static int superblocks_safeprobe(blkid_probe pr, struct blkid_chain *chn);
+static void superblocks_free_data(blkid_probe pr, void *data);
 
 static int blkid_probe_set_usage(blkid_probe pr, int usage);
 
@@ -172,8 +176,93 @@ const struct blkid_chaindrv superblocks_drv = {
 	.has_fltr     = TRUE,
 	.probe        = superblocks_probe,
 	.safeprobe    = superblocks_safeprobe,
+	.free_data    = superblocks_free_data
 };
 
+/*
+ * Index of all magic strings from idinfos[], sorted by the 1KiB block where
+ * the magic string lives on the device. The index is used to scan the device
+ * for all magic strings at once (one buffer lookup per block) before the
+ * probing functions are called. The index is built on the first use.
+ */
+struct sb_magic {
+	uint64_t			blk;	/* offset of the 1KiB block */
+	unsigned int			pos;	/* magic offset within the block */
+	size_t				idx;	/* idinfos[] index */
+	const struct blkid_idmag	*mag;
+};
+
+static struct sb_magic *sb_magics;
+static size_t sb_nmagics;
+
+static int cmp_sb_magics(const void *a, const void *b)
+{
+	const struct sb_magic *ma = (const struct sb_magic *) a,
+			      *mb = (const struct sb_magic *) b;
+
+	if (ma->blk != mb->blk)
+		return ma->blk < mb->blk ? -1 : 1;
+	if (ma->idx != mb->idx)
+		return ma->idx < mb->idx ? -1 : 1;
+	return ma->mag < mb->mag ? -1 : ma->mag > mb->mag;
+}
+
+/* builds the index, called only once */
+static void init_sb_magics(void)
+{
+	struct sb_magic *res;
+	size_t i, n = 0;
+
+	for (i = 0; i < ARRAY_SIZE(idinfos); i++) {
+		const struct blkid_idmag *mag = idinfos[i]->magics;
+
+		for ( ; mag && mag->magic; mag++)
+			n++;
+	}
+
+	res = malloc(n * sizeof(struct sb_magic));
+	if (!res)
+		return;
+
+	for (n = 0, i = 0; i < ARRAY_SIZE(idinfos); i++) {
+		const struct blkid_idmag *mag = idinfos[i]->magics;
+
+		for ( ; mag && mag->magic; mag++, n++) {
+			res[n].blk = mag->kboff + (mag->sboff >> 10);
+			res[n].pos = mag->sboff & 0x3ff;
+			res[n].idx = i;
+			res[n].mag = mag;
+		}
+	}
+	qsort(res, n, sizeof(struct sb_magic), cmp_sb_magics);
+
+	sb_nmagics = n;
+	sb_magics = res;
+
+	DBG(LOWPROBE, ul_debug("superblocks magic index: %zu strings", n));
+}
+
+/*
+ * The index is shared by all probes (also in threaded applications) and it's
+ * never deallocated. A prefetch worker abandoned after timeout may still
+ * probe a device when the library is unloaded, see prefetch.c.
+ */
+#ifdef HAVE_LIBPTHREAD
+static pthread_once_t sb_magics_once = PTHREAD_ONCE_INIT;
+#endif
+
+static const struct sb_magic *get_sb_magics(size_t *nmagics)
+{
+#ifdef HAVE_LIBPTHREAD
+	pthread_once(&sb_magics_once, init_sb_magics);
+#else
+	if (!sb_magics)
+		init_sb_magics();
+#endif
+	*nmagics = sb_nmagics;
+	return sb_magics;
+}
+
 /**
  * blkid_probe_enable_superblocks:
  * @pr: probe
@@ -323,6 +412,96 @@ int blkid_superblocks_get_name(size_t idx, const char **name, int *usage)
 	return -1;
 }
 
+/*
+ * Returns TRUE if the prober @i is usable for the current device.
+ */
+static int idinfo_is_usable(blkid_probe pr, struct blkid_chain *chn, size_t i)
+{
+	const struct blkid_idinfo *id = idinfos[i];
+
+	if (chn->fltr && blkid_bmp_get_item(chn->fltr, i)) {
+		DBG(LOWPROBE, ul_debug("filter out: %s", id->name));
+		return FALSE;
+	}
+
+	if (id->minsz && (unsigned)id->minsz > pr->size)
+		return FALSE;	/* the device is too small */
+
+	/* don't probe for RAIDs, swap or journal on CD/DVDs */
+	if ((id->usage & (BLKID_USAGE_RAID | BLKID_USAGE_OTHER)) &&
+	    blkid_probe_is_cdrom(pr))
+		return FALSE;
+
+	/* don't probe for RAIDs on floppies */
+	if ((id->usage & BLKID_USAGE_RAID) && blkid_probe_is_tiny(pr))
+		return FALSE;
+
+	return TRUE;
+}
+
+/*
+ * Scans the device for magic strings of all usable probers and returns bitmap
+ * of the candidates -- probers without magic strings, probers with matching
+ * magic string and probers where it's impossible to read the magic (the error
+ * is reported later by the probing loop).
+ */
+static unsigned long *superblocks_scan_magics(blkid_probe pr,
+					struct blkid_chain *chn)
+{
+	unsigned long *cands = chn->data;
+	const struct sb_magic *magics;
+	const unsigned char *buf = NULL;
+	size_t i, nmagics = 0;
+	uint64_t blk = 0;
+	int err = 0, fetched = 0;
+
+	if (!cands) {
+		cands = malloc(blkid_bmp_nbytes(ARRAY_SIZE(idinfos)));
+		if (!cands)
+			return NULL;
+		chn->data = cands;
+	}
+	memset(cands, 0, blkid_bmp_nbytes(ARRAY_SIZE(idinfos)));
+
+	magics = get_sb_magics(&nmagics);
+	if (!magics) {
+		/* no index, probe by all probers */
+		memset(cands, 0xff, blkid_bmp_nbytes(ARRAY_SIZE(idinfos)));
+		return cands;
+	}
+
+	for (i = 0; i < ARRAY_SIZE(idinfos); i++) {
+		if (!idinfos[i]->magics[0].magic)
+			blkid_bmp_set_item(cands, i);
+	}
+
+	for (i = 0; i < nmagics; i++) {
+		const struct sb_magic *m = &magics[i];
+
+		if (blkid_bmp_get_item(cands, m->idx)
+		    || (chn->fltr && blkid_bmp_get_item(chn->fltr, m->idx))
+		    || !idinfo_is_usable(pr, chn, m->idx))
+			continue;
+
+		if (!fetched || blk != m->blk) {
+			blk = m->blk;
+			buf = blkid_probe_get_buffer(pr, blk << 10, 1024);
+			err = !buf && errno;
+			fetched = 1;
+		}
+		if (err || (buf && !memcmp(m->mag->magic, buf + m->pos, m->mag->len)))
+			blkid_bmp_set_item(cands, m->idx);
+	}
+
+	return cands;
+}
+
+static void superblocks_free_data(blkid_probe pr __attribute__((__unused__)),
+				  void *data)
+{
+	free(data);
+}
+
 /*
  * The blkid_do_probe() backend.
  */
@@ -330,6 +509,7 @@ static int superblocks_probe(blkid_probe pr, struct blkid_chain *chn)
 {
 	size_t i;
 	int rc = BLKID_PROBE_NONE;
+	unsigned long *cands;
 
 	if (chn->idx < -1)
 		return -EINVAL;
@@ -348,59 +528,53 @@ static int superblocks_probe(blkid_probe pr, struct blkid_chain *chn)
 	DBG(LOWPROBE, ul_debug("--> starting probing loop [SUBLKS idx=%d]",
 		chn->idx));
 
+	/* the candidates are evaluated at the begin of the probing only,
+	 * the next blkid_do_probe() calls continue with the same set */
+	if (chn->idx < 0 || !chn->data) {
+		cands = superblocks_scan_magics(pr, chn);
+		if (!cands)
+			return -ENOMEM;
+	} else
+		cands = chn->data;
+
 	i = chn->idx < 0 ? 0 : chn->idx + 1U;
 
 	for ( ; i < ARRAY_SIZE(idinfos); i++) {
 		const struct blkid_idinfo *id;
 		const struct blkid_idmag *mag = NULL;
+		struct blkid_probestat st;
 		uint64_t off = 0;
 
 		chn->idx = i;
 		id = idinfos[i];
 
-		if (chn->fltr && blkid_bmp_get_item(chn->fltr, i)) {
-			DBG(LOWPROBE, ul_debug("filter out: %s", id->name));
-			rc = BLKID_PROBE_NONE;
-			continue;
-		}
-
-		if (id->minsz && (unsigned)id->minsz > pr->size) {
-			rc = BLKID_PROBE_NONE;
-			continue;	/* the device is too small */
-		}
-
-		/* don't probe for RAIDs, swap or journal on CD/DVDs */
-		if ((id->usage & (BLKID_USAGE_RAID | BLKID_USAGE_OTHER)) &&
-		    blkid_probe_is_cdrom(pr)) {
+		if (!idinfo_is_usable(pr, chn, i)) {
 			rc = BLKID_PROBE_NONE;
 			continue;
 		}
-
-		/* don't probe for RAIDs on floppies */
-		if ((id->usage & BLKID_USAGE_RAID) && blkid_probe_is_tiny(pr)) {
+		if (!blkid_bmp_get_item(cands, i)) {
 			rc = BLKID_PROBE_NONE;
-			continue;
+			continue;	/* magic string not found by scan */
 		}
 
 		DBG(LOWPROBE, ul_debug("[%zd] %s:", i, id->name));
 
+		blkid_probe_stat_begin(pr, &st);
 		rc = blkid_probe_get_idmag(pr, id, &off, &mag);
-		if (rc < 0)
-			break;
-		if (rc != BLKID_PROBE_OK)
-			continue;
 
 		/* final check by probing function */
-		if (id->probefunc) {
+		if (rc == BLKID_PROBE_OK && id->probefunc) {
 			DBG(LOWPROBE, ul_debug("\tcall probefunc()"));
 			rc = id->probefunc(pr, mag);
-			if (rc != BLKID_PROBE_OK) {
+			if (rc != BLKID_PROBE_OK)
 				blkid_probe_chain_reset_values(pr, chn);
-				if (rc < 0)
-					break;
-				continue;
-			}
 		}
+		blkid_probe_stat_end(pr, &st, chn, i);
+
+		if (rc < 0)
+			break;
+		if (rc != BLKID_PROBE_OK)
+			continue;
 
 		/* all checks passed */
 		if (chn->flags & BLKID_SUBLKS_TYPE)
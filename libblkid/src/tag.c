@@ -31,20 +31,123 @@ static blkid_tag blkid_new_tag(void)
 	return tag;
 }
 
+/*
+ * The cache hash is indexed by NAME and value, the tags are linked by
+ * bit_hnext. The type-head tags (see blkid_find_head_cache()) are not
+ * in the hash.
+ */
+#define BLKID_HASH_MINSZ	64
+
+static unsigned int tag_hash(const char *name, const char *value)
+{
+	/* FNV-1a */
+	unsigned int h = 2166136261U;
+	const unsigned char *p;
+
+	for (p = (const unsigned char *) name; *p; p++)
+		h = (h ^ *p) * 16777619U;
+	h = (h ^ '=') * 16777619U;
+	for (p = (const unsigned char *) value; *p; p++)
+		h = (h ^ *p) * 16777619U;
+	return h;
+}
+
+static int hash_resize(blkid_cache cache, size_t sz)
+{
+	blkid_tag *hash;
+	size_t i;
+
+	hash = calloc(sz, sizeof(blkid_tag));
+	if (!hash)
+		return -BLKID_ERR_MEM;
+
+	for (i = 0; i < cache->bic_hashsz; i++) {
+		blkid_tag t = cache->bic_hash[i];
+
+		/* keep order of the tags within the bucket */
+		while (t) {
+			blkid_tag next = t->bit_hnext;
+			blkid_tag *x = &hash[t->bit_hash & (sz - 1)];
+
+			while (*x)
+				x = &(*x)->bit_hnext;
+			t->bit_hnext = NULL;
+			*x = t;
+			t = next;
+		}
+	}
+
+	DBG(TAG, ul_debugobj(cache, "tags hash resized %zu -> %zu", cache->bic_hashsz, sz));
+	free(cache->bic_hash);
+	cache->bic_hash = hash;
+	cache->bic_hashsz = sz;
+	return 0;
+}
+
+static int hash_add_tag(blkid_cache cache, blkid_tag tag)
+{
+	blkid_tag *x;
+
+	if (cache->bic_nhashed >= cache->bic_hashsz) {
+		size_t sz = cache->bic_hashsz ? cache->bic_hashsz << 1
+					      : BLKID_HASH_MINSZ;
+		if (hash_resize(cache, sz) != 0)
+			return -BLKID_ERR_MEM;
+	}
+
+	tag->bit_hash = tag_hash(tag->bit_name, tag->bit_val);
+	tag->bit_hnext = NULL;
+
+	/* add to the tail, the lookup prefers older tags */
+	x = &cache->bic_hash[tag->bit_hash & (cache->bic_hashsz - 1)];
+	while (*x)
+		x = &(*x)->bit_hnext;
+	*x = tag;
+
+	tag->bit_hashed = 1;
+	cache->bic_nhashed++;
+	return 0;
+}
+
+static void hash_del_tag(blkid_tag tag)
+{
+	blkid_cache cache;
+	blkid_tag *x;
+
+	if (!tag->bit_hashed)
+		return;
+
+	cache = tag->bit_dev->bid_cache;
+	x = &cache->bic_hash[tag->bit_hash & (cache->bic_hashsz - 1)];
+	while (*x && *x != tag)
+		x = &(*x)->bit_hnext;
+	if (*x) {
+		*x = tag->bit_hnext;
+		cache->bic_nhashed--;
+	}
+	tag->bit_hnext = NULL;
+	tag->bit_hashed = 0;
+}
+
 void blkid_free_tag(blkid_tag tag)
 {
+	blkid_cache cache;
+
 	if (!tag)
 		return;
 
 	DBG(TAG, ul_debugobj(tag, "freeing tag %s (%s)", tag->bit_name, tag->bit_val));
 
+	cache = tag->bit_dev ? tag->bit_dev->bid_cache : NULL;
+
+	hash_del_tag(tag);
 	list_del(&tag->bit_tags);	/* list of tags for this device */
 	list_del(&tag->bit_names);	/* list of tags with this type */
 
-	free(tag->bit_name);
-	free(tag->bit_val);
+	blkid_cache_free(cache, tag->bit_name);
+	blkid_cache_free(cache, tag->bit_val);
 
-	free(tag);
+	blkid_cache_free(cache, tag);
 }
 
 /*
@@ -101,6 +204,41 @@ static blkid_tag blkid_find_head_cache(blkid_cache cache, const char *type)
 	return head;
 }
 
+/*
+ * Add a new tag to the device, the tag is also added to the cache list of
+ * the tags with the same type and to the cache hash.
+ */
+int blkid_link_tag(blkid_dev dev, blkid_tag tag)
+{
+	blkid_cache cache = dev->bid_cache;
+	blkid_tag head;
+
+	tag->bit_dev = dev;
+	list_add_tail(&tag->bit_tags, &dev->bid_tags);
+
+	if (!cache)
+		return 0;
+
+	head = blkid_find_head_cache(cache, tag->bit_name);
+	if (!head) {
+		head = blkid_new_tag();
+		if (!head)
+			return -BLKID_ERR_MEM;
+
+		DBG(TAG, ul_debugobj(head, "creating new cache tag head %s", tag->bit_name));
+		head->bit_name = strdup(tag->bit_name);
+		if (!head->bit_name) {
+			blkid_free_tag(head);
+			return -BLKID_ERR_MEM;
+		}
+		list_add_tail(&head->bit_tags, &cache->bic_tags);
+	}
+	list_add_tail(&tag->bit_names, &head->bit_names);
+	tag->bit_seq = ++cache->bic_tagseq;
+
+	return hash_add_tag(cache, tag);
+}
+
 /*
  * Set a tag on an existing device.
  *
@@ -109,7 +247,7 @@ static blkid_tag blkid_find_head_cache(blkid_cache cache, const char *type)
 int blkid_set_tag(blkid_dev dev, const char *name,
 		  const char *value, const int vlength)
 {
-	blkid_tag	t = 0, head = 0;
+	blkid_tag	t = 0;
 	char		*val = 0;
 	char		**dev_var = 0;
 
@@ -139,36 +277,28 @@ int blkid_set_tag(blkid_dev dev, const char *name,
 			return 0;
 		}
 		DBG(TAG, ul_debugobj(t, "update (%s) '%s' -> '%s'", t->bit_name, t->bit_val, val));
-		free(t->bit_val);
+		hash_del_tag(t);
+		blkid_cache_free(dev->bid_cache, t->bit_val);
 		t->bit_val = val;
+		if (dev->bid_cache && hash_add_tag(dev->bid_cache, t) != 0) {
+			/* don't keep unsearchable tag */
+			if (dev_var)
+				*dev_var = NULL;
+			blkid_free_tag(t);
+			return -BLKID_ERR_MEM;
+		}
 	} else {
 		/* Existing tag not present, add to device */
 		if (!(t = blkid_new_tag()))
 			goto errout;
 		t->bit_name = strdup(name);
 		t->bit_val = val;
-		t->bit_dev = dev;
+		if (!t->bit_name)
+			goto errout;
 
 		DBG(TAG, ul_debugobj(t, "setting (%s) '%s'", t->bit_name, t->bit_val));
-		list_add_tail(&t->bit_tags, &dev->bid_tags);
-
-		if (dev->bid_cache) {
-			head = blkid_find_head_cache(dev->bid_cache,
-						     t->bit_name);
-			if (!head) {
-				head = blkid_new_tag();
-				if (!head)
-					goto errout;
-
-				DBG(TAG, ul_debugobj(head, "creating new cache tag head %s", name));
-				head->bit_name = strdup(name);
-				if (!head->bit_name)
-					goto errout;
-				list_add_tail(&head->bit_tags,
-					      &dev->bid_cache->bic_tags);
-			}
-			list_add_tail(&t->bit_names, &head->bit_names);
-		}
+		if (blkid_link_tag(dev, t) != 0)
+			goto errout;
 	}
 
 	/* Link common tags directly to the device struct */
@@ -184,8 +314,6 @@ errout:
 		blkid_free_tag(t);
 	else
 		free(val);
-	if (head)
-		blkid_free_tag(head);
 	return -BLKID_ERR_MEM;
 }
 
@@ -317,43 +445,67 @@ void blkid_tag_iterate_end(blkid_tag_iterate iter)
  * type/value pair.  If there is more than one device that matches the
  * search specification, it returns the one with the highest priority
  * value.  This allows us to give preference to EVMS or LVM devices.
+ * Devices with the same priority are ordered by the list of tags with
+ * the given type (the oldest tag first, the tag keeps its position when
+ * the value is updated).
  */
 blkid_dev blkid_find_dev_with_tag(blkid_cache cache,
 					 const char *type,
 					 const char *value)
 {
-	blkid_tag	head;
+	blkid_tag	tmp, first;
 	blkid_dev	dev;
-	int		pri;
-	struct list_head *p;
+	unsigned int	hash;
 	int		probe_new = 0;
 
 	if (!cache || !type || !value)
 		return NULL;
 
 	blkid_read_cache(cache);
+	blkid_read_uevents(cache);
 
 	DBG(TAG, ul_debug("looking for %s=%s in cache", type, value));
 
+	hash = tag_hash(type, value);
+
 try_again:
-	pri = -1;
-	dev = 0;
-	head = blkid_find_head_cache(cache, type);
-
-	if (head) {
-		list_for_each(p, &head->bit_names) {
-			blkid_tag tmp = list_entry(p, struct blkid_struct_tag,
-						   bit_names);
-
-			if (!strcmp(tmp->bit_val, value) &&
-			    (tmp->bit_dev->bid_pri > pri) &&
-			    !access(tmp->bit_dev->bid_name, F_OK)) {
-				dev = tmp->bit_dev;
-				pri = dev->bid_pri;
-			}
+	dev = NULL;
+	first = cache->bic_hash ? cache->bic_hash[hash & (cache->bic_hashsz - 1)] : NULL;
+
+	/*
+	 * Select the matching device with the highest priority; access() is
+	 * called only for the selected device, if the device does not exist
+	 * then it's marked and the next best device is selected.
+	 */
+	for (;;) {
+		unsigned int seq = 0;
+		int pri = -1;
+
+		dev = NULL;
+		for (tmp = first; tmp; tmp = tmp->bit_hnext) {
+			if (tmp->bit_hash != hash
+			    || (tmp->bit_dev->bid_flags & BLKID_BID_FL_NOACCESS)
+			    || tmp->bit_dev->bid_pri < pri
+			    || (tmp->bit_dev->bid_pri == pri && tmp->bit_seq > seq)
+			    || strcmp(tmp->bit_val, value) != 0
+			    || strcmp(tmp->bit_name, type) != 0)
+				continue;
+			dev = tmp->bit_dev;
+			pri = dev->bid_pri;
+			seq = tmp->bit_seq;
 		}
+		if (!dev || access(dev->bid_name, F_OK) == 0)
+			break;
+
+		DBG(TAG, ul_debugobj(dev, "%s does not exist", dev->bid_name));
+		dev->bid_flags |= BLKID_BID_FL_NOACCESS;
 	}
-	if (dev && !(dev->bid_flags & BLKID_BID_FL_VERIFIED)) {
+
+	for (tmp = first; tmp; tmp = tmp->bit_hnext)
+		tmp->bit_dev->bid_flags &= ~BLKID_BID_FL_NOACCESS;
+
+	if (dev && (!(dev->bid_flags & BLKID_BID_FL_VERIFIED) ||
+		    (dev->bid_flags & BLKID_BID_FL_STALE))) {
 		dev = blkid_verify(cache, dev);
 		if (!dev || dev->bid_flags & BLKID_BID_FL_VERIFIED)
 			goto try_again;
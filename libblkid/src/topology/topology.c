@@ -178,8 +178,14 @@ static int topology_probe(blkid_probe pr, struct blkid_chain *chn)
 		chn->idx = i;
 
 		if (id->probefunc) {
+			struct blkid_probestat st;
+			int rc;
+
 			DBG(LOWPROBE, ul_debug("%s: call probefunc()", id->name));
-			if (id->probefunc(pr, NULL) != 0)
+			blkid_probe_stat_begin(pr, &st);
+			rc = id->probefunc(pr, NULL);
+			blkid_probe_stat_end(pr, &st, chn, i);
+			if (rc != 0)
 				continue;
 		}
 
@@ -0,0 +1,355 @@
+/*
+ * uevent.c - cache revalidation driven by kernel uevents
+ *
+ * Copyright (C) 2016 Karel Zak <kzak@redhat.com>
+ *
+ * This file may be redistributed under the terms of the
+ * GNU Lesser General Public License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/socket.h>
+#ifdef HAVE_LINUX_NETLINK_H
+# include <linux/netlink.h>
+#endif
+
+#include "blkidP.h"
+
+/*
+ * Without uevents the cache freshness is time based; blkid_verify() re-probes
+ * devices after BLKID_PROBE_INTERVAL and blkid_probe_all() scans all devices
+ * after the same interval.
+ *
+ * If uevents are enabled then the cache listens on the kernel uevent netlink
+ * socket. Block device events mark the devices with the same devno as stale
+ * and "add" events (or lost events) force the next blkid_probe_all() to scan
+ * for new devices. The verified devices are not re-probed until an event
+ * arrives.
+ */
+
+#ifdef HAVE_LINUX_NETLINK_H
+
+/* kernel group, udev uses group 2 for the processed events */
+#define UEVENT_KERNEL_GROUP	1
+#define UEVENT_BUFSZ		(8 * 1024)
+#define UEVENT_RCVBUF		(256 * 1024)
+
+static int open_uevents(blkid_cache cache)
+{
+	struct sockaddr_nl addr = { .nl_family = AF_NETLINK,
+				    .nl_groups = UEVENT_KERNEL_GROUP };
+	int fd, sz = UEVENT_RCVBUF;
+
+	fd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC | SOCK_NONBLOCK,
+			NETLINK_KOBJECT_UEVENT);
+	if (fd < 0)
+		return -errno;
+
+	/* nl_pid is zero, kernel assigns unique address to the socket */
+	if (bind(fd, (struct sockaddr *) &addr, sizeof(addr)) < 0) {
+		int rc = -errno;
+		close(fd);
+		return rc;
+	}
+	if (setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &sz, sizeof(sz)) != 0)
+		DBG(CACHE, ul_debugobj(cache, "uevents: failed to set socket buffer"));
+
+	DBG(CACHE, ul_debugobj(cache, "uevents: listening [fd=%d]", fd));
+	cache->bic_uevent_fd = fd;
+
+	/* we don't know what happened before the socket has been opened */
+	cache->bic_flags |= BLKID_BIC_FL_RESCAN;
+	return 0;
+}
+
+static int mark_stale(blkid_cache cache, dev_t devno)
+{
+	struct list_head *p;
+	int n = 0;
+
+	list_for_each(p, &cache->bic_devs) {
+		blkid_dev dev = list_entry(p, struct blkid_struct_dev, bid_devs);
+
+		if (devno && dev->bid_devno != devno)
+			continue;
+		if (!(dev->bid_flags & BLKID_BID_FL_STALE)) {
+			DBG(CACHE, ul_debugobj(cache, "uevents: %s is stale", dev->bid_name));
+			dev->bid_flags |= BLKID_BID_FL_STALE;
+			n++;
+		}
+	}
+	return n;
+}
+
+/*
+ * Parses kernel uevent message, the message is "<action>@<devpath>" header and
+ * zero terminated KEY=value strings.
+ */
+static int parse_uevent(blkid_cache cache, char *buf, size_t sz)
+{
+	const char *action = NULL, *subsystem = NULL;
+	const char *major = NULL, *minor = NULL;
+	char *p, *end = buf + sz;
+	dev_t devno;
+
+	buf[sz - 1] = '\0';
+	if (!strchr(buf, '@'))
+		return 0;		/* not a kernel event */
+
+	for (p = buf + strlen(buf) + 1; p < end; p += strlen(p) + 1) {
+		if (!strncmp(p, "ACTION=", 7))
+			action = p + 7;
+		else if (!strncmp(p, "SUBSYSTEM=", 10))
+			subsystem = p + 10;
+		else if (!strncmp(p, "MAJOR=", 6))
+			major = p + 6;
+		else if (!strncmp(p, "MINOR=", 6))
+			minor = p + 6;
+	}
+
+	if (!action || !subsystem || !major || !minor ||
+	    strcmp(subsystem, "block") != 0)
+		return 0;
+
+	devno = makedev(strtoul(major, NULL, 10), strtoul(minor, NULL, 10));
+
+	DBG(CACHE, ul_debugobj(cache, "uevents: %s 0x%04llx",
+				action, (unsigned long long) devno));
+
+	if (!strcmp(action, "add"))
+		cache->bic_flags |= BLKID_BIC_FL_RESCAN;
+
+	return devno ? mark_stale(cache, devno) : 0;
+}
+
+/*
+ * Reads all pending uevents. Returns number of newly stale devices or
+ * negative number in case of error.
+ */
+int blkid_read_uevents(blkid_cache cache)
+{
+	char buf[UEVENT_BUFSZ];
+	int n = 0;
+
+	if (!cache || cache->bic_uevent_fd < 0)
+		return 0;
+
+	do {
+		struct sockaddr_nl snl;
+		struct iovec iov = { .iov_base = buf, .iov_len = sizeof(buf) };
+		struct msghdr msg = {
+			.msg_name = &snl,
+			.msg_namelen = sizeof(snl),
+			.msg_iov = &iov,
+			.msg_iovlen = 1
+		};
+		ssize_t sz;
+
+		sz = recvmsg(cache->bic_uevent_fd, &msg, MSG_DONTWAIT);
+		if (sz < 0) {
+			if (errno == EAGAIN || errno == EWOULDBLOCK)
+				break;
+			if (errno == EINTR)
+				continue;
+			if (errno == ENOBUFS) {
+				/* events lost, nothing in the cache is trustworthy */
+				DBG(CACHE, ul_debugobj(cache, "uevents: overrun"));
+				cache->bic_flags |= BLKID_BIC_FL_RESCAN;
+				n += mark_stale(cache, 0);
+				continue;
+			}
+			return -errno;
+		}
+		if (sz == 0 || snl.nl_pid != 0 || (msg.msg_flags & MSG_TRUNC))
+			continue;	/* not from kernel or too large */
+
+		n += parse_uevent(cache, buf, sz);
+	} while (1);
+
+	return n;
+}
+
+#else /* !HAVE_LINUX_NETLINK_H */
+
+static int open_uevents(blkid_cache cache __attribute__((__unused__)))
+{
+	return -ENOSYS;
+}
+
+int blkid_read_uevents(blkid_cache cache __attribute__((__unused__)))
+{
+	return 0;
+}
+
+#endif /* HAVE_LINUX_NETLINK_H */
+
+/**
+ * blkid_cache_enable_uevents:
+ * @cache: cache handler
+ * @enable: 1 or 0
+ *
+ * Enables or disables revalidation of the cache by kernel uevents. This is
+ * designed for long-running processes which keep the cache in memory.
+ *
+ * If enabled, then the verified devices are not re-probed until the kernel
+ * reports an event for the device (e.g. the device has been changed or
+ * removed), and blkid_probe_all() does not scan for devices until a new device
+ * is added. The pending events are read by blkid_verify(),
+ * blkid_probe_all(), blkid_find_dev_with_tag() and
+ * blkid_cache_process_uevents().
+ *
+ * Returns: 0 on success, or number less than zero in case of error.
+ */
+int blkid_cache_enable_uevents(blkid_cache cache, int enable)
+{
+	if (!cache)
+		return -BLKID_ERR_PARAM;
+
+	if (enable && cache->bic_uevent_fd < 0)
+		return open_uevents(cache);
+
+	if (!enable && cache->bic_uevent_fd >= 0) {
+		DBG(CACHE, ul_debugobj(cache, "uevents: closing [fd=%d]", cache->bic_uevent_fd));
+		close(cache->bic_uevent_fd);
+		cache->bic_uevent_fd = -1;
+	}
+	return 0;
+}
+
+/**
+ * blkid_cache_get_uevents_fd:
+ * @cache: cache handler
+ *
+ * The file descriptor is readable when there are pending kernel events, it's
+ * possible to use it with poll() or epoll and call
+ * blkid_cache_process_uevents() when the descriptor is ready. It's not
+ * necessary to monitor the descriptor, the pending events are also read
+ * before cache lookups.
+ *
+ * Returns: file descriptor or number less than zero if uevents are not
+ * enabled by blkid_cache_enable_uevents().
+ */
+int blkid_cache_get_uevents_fd(blkid_cache cache)
+{
+	if (!cache)
+		return -BLKID_ERR_PARAM;
+	return cache->bic_uevent_fd >= 0 ? cache->bic_uevent_fd : -EINVAL;
+}
+
+/**
+ * blkid_cache_process_uevents:
+ * @cache: cache handler
+ *
+ * Reads pending kernel events and marks the affected devices in the cache as
+ * stale, the stale devices are probed again on the next lookup.
+ *
+ * Returns: number of newly stale devices or number less than zero in case of
+ * error.
+ */
+int blkid_cache_process_uevents(blkid_cache cache)
+{
+	if (!cache)
+		return -BLKID_ERR_PARAM;
+	return blkid_read_uevents(cache);
+}
+
+#ifdef TEST_PROGRAM
+# ifdef HAVE_LINUX_NETLINK_H
+static void print_dev(const char *msg, blkid_dev dev)
+{
+	if (!dev) {
+		printf("%-9s: no device\n", msg);
+		return;
+	}
+	printf("%-9s: TYPE=%s LABEL=%s%s\n", msg,
+		dev->bid_type ? dev->bid_type : "(null)",
+		dev->bid_label ? dev->bid_label : "(null)",
+		dev->bid_flags & BLKID_BID_FL_STALE ? " [stale]" : "");
+}
+
+/* simulates kernel uevent, returns number of newly stale devices */
+static int send_uevent(blkid_cache cache, const char *action, dev_t devno)
+{
+	char buf[256];
+	int sz;
+
+	sz = snprintf(buf, sizeof(buf),
+		"%s@/devices/virtual/block/loop%u%c"
+		"ACTION=%s%cSUBSYSTEM=block%cMAJOR=%u%cMINOR=%u%c",
+		action, minor(devno), '\0',
+		action, '\0', '\0', major(devno), '\0', minor(devno), '\0');
+
+	return parse_uevent(cache, buf, sz);
+}
+
+int main(int argc, char *argv[])
+{
+	blkid_cache cache;
+	blkid_dev dev;
+	struct timespec ts[2];
+	int fds[2];
+
+	if (argc != 3) {
+		fprintf(stderr, "Usage: %s <image> <new-image>\n"
+			"Replace the image and check revalidation by uevents\n",
+			argv[0]);
+		return EXIT_FAILURE;
+	}
+	if (blkid_get_cache(&cache, "/dev/null") != 0)
+		errx(EXIT_FAILURE, "failed to create cache");
+
+	dev = blkid_get_dev(cache, argv[1], BLKID_DEV_NORMAL);
+	print_dev("probed", dev);
+	if (!dev)
+		return EXIT_FAILURE;
+
+	/* the events are not read from kernel, the socket is always empty */
+	if (socketpair(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, fds) != 0)
+		err(EXIT_FAILURE, "socketpair failed");
+	cache->bic_uevent_fd = fds[0];
+
+	/* the image is a regular file, pretend it's a loop device */
+	dev->bid_devno = makedev(7, 0);
+
+	/* modified device, time based revalidation would probe it again */
+	if (rename(argv[2], argv[1]) != 0)
+		err(EXIT_FAILURE, "cannot rename %s", argv[2]);
+	ts[0].tv_sec = ts[1].tv_sec = time(NULL) + 60;
+	ts[0].tv_nsec = ts[1].tv_nsec = 0;
+	if (utimensat(AT_FDCWD, argv[1], ts, 0) != 0)
+		err(EXIT_FAILURE, "cannot set %s mtime", argv[1]);
+
+	dev = blkid_verify(cache, dev);
+	print_dev("no event", dev);
+
+	printf("stale: %d\n", send_uevent(cache, "change", makedev(7, 1)));
+	dev = blkid_verify(cache, dev);
+	print_dev("other", dev);
+
+	printf("stale: %d\n", send_uevent(cache, "change", makedev(7, 0)));
+	print_dev("event", dev);
+	dev = blkid_verify(cache, dev);
+	print_dev("verified", dev);
+
+	printf("rescan: %s\n", cache->bic_flags & BLKID_BIC_FL_RESCAN ? "yes" : "no");
+	send_uevent(cache, "add", makedev(7, 2));
+	printf("rescan: %s\n", cache->bic_flags & BLKID_BIC_FL_RESCAN ? "yes" : "no");
+
+	blkid_put_cache(cache);
+	close(fds[1]);
+	return EXIT_SUCCESS;
+}
+# else /* !HAVE_LINUX_NETLINK_H */
+int main(void)
+{
+	fprintf(stderr, "uevents are not supported\n");
+	return EXIT_FAILURE;
+}
+# endif
+#endif /* TEST_PROGRAM */
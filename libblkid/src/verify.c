@@ -23,6 +23,25 @@
 #include "blkidP.h"
 #include "sysfs.h"
 
+/*
+ * Sets tag from the probing result, not all values are stored in the cache.
+ */
+void blkid_verify_set_tag(blkid_dev dev, const char *name,
+			  const char *data, size_t len)
+{
+	if (strncmp(name, "PART_ENTRY_", 11) == 0) {
+		if (strcmp(name, "PART_ENTRY_UUID") == 0)
+			blkid_set_tag(dev, "PARTUUID", data, len);
+		else if (strcmp(name, "PART_ENTRY_NAME") == 0)
+			blkid_set_tag(dev, "PARTLABEL", data, len);
+
+	} else if (!strstr(name, "_ID")) {
+		/* superblock UUID, LABEL, ...
+		 * but not {SYSTEM,APPLICATION,..._ID} */
+		blkid_set_tag(dev, name, data, len);
+	}
+}
+
 static void blkid_probe_to_tags(blkid_probe pr, blkid_dev dev)
 {
 	const char *data;
@@ -35,20 +54,93 @@ static void blkid_probe_to_tags(blkid_probe pr, blkid_dev dev)
 	for (n = 0; n < nvals; n++) {
 		if (blkid_probe_get_value(pr, n, &name, &data, &len) != 0)
 			continue;
-		if (strncmp(name, "PART_ENTRY_", 11) == 0) {
-			if (strcmp(name, "PART_ENTRY_UUID") == 0)
-				blkid_set_tag(dev, "PARTUUID", data, len);
-			else if (strcmp(name, "PART_ENTRY_NAME") == 0)
-				blkid_set_tag(dev, "PARTLABEL", data, len);
-
-		} else if (!strstr(name, "_ID")) {
-			/* superblock UUID, LABEL, ...
-			 * but not {SYSTEM,APPLICATION,..._ID} */
-			blkid_set_tag(dev, name, data, len);
-		}
+		blkid_verify_set_tag(dev, name, data, len);
 	}
 }
 
+/*
+ * Enables chains and flags used to verify cache entries.
+ */
+void blkid_verify_setup_probe(blkid_probe pr)
+{
+	/* enable superblocks probing */
+	blkid_probe_enable_superblocks(pr, TRUE);
+	blkid_probe_set_superblocks_flags(pr,
+		BLKID_SUBLKS_LABEL | BLKID_SUBLKS_UUID |
+		BLKID_SUBLKS_TYPE | BLKID_SUBLKS_SECTYPE);
+
+	/* enable partitions probing */
+	blkid_probe_enable_partitions(pr, TRUE);
+	blkid_probe_set_partitions_flags(pr, BLKID_PARTS_ENTRY_DETAILS);
+}
+
+static void remove_tags(blkid_dev dev)
+{
+	blkid_tag_iterate iter;
+	const char *type, *value;
+
+	iter = blkid_tag_iterate_begin(dev);
+	while (blkid_tag_next(iter, &type, &value) == 0)
+		blkid_set_tag(dev, type, NULL, 0);
+	blkid_tag_iterate_end(iter);
+}
+
+static void set_verified(blkid_cache cache, blkid_dev dev, struct stat *st)
+{
+#ifdef HAVE_STRUCT_STAT_ST_MTIM_TV_NSEC
+	struct timeval tv;
+	if (!gettimeofday(&tv, NULL)) {
+		dev->bid_time = tv.tv_sec;
+		dev->bid_utime = tv.tv_usec;
+	} else
+#endif
+		dev->bid_time = time(0);
+
+	dev->bid_devno = st->st_rdev;
+	dev->bid_flags |= BLKID_BID_FL_VERIFIED;
+	dev->bid_flags &= ~BLKID_BID_FL_STALE;
+	cache->bic_flags |= BLKID_BIC_FL_CHANGED;
+}
+
+#ifdef HAVE_LIBPTHREAD
+/*
+ * Uses result from parallel probing (see prefetch.c). Returns 1 if the device
+ * has not been prefetched.
+ */
+static int verify_prefetched(blkid_cache cache, blkid_dev *dev, struct stat *st)
+{
+	int err = 0;
+
+	switch (blkid_prefetch_wait(cache->prefetch, st->st_rdev, &err)) {
+	case BLKID_PREFETCH_UNKNOWN:
+		return 1;
+	case BLKID_PREFETCH_TIMEOUT:
+		/* don't wait for dead devices, return cache data */
+		DBG(PROBE, ul_debug("%s: probing timeout, returning unverified data",
+					(*dev)->bid_name));
+		break;
+	case BLKID_PREFETCH_OPENERR:
+		if (err == EPERM || err == EACCES || err == ENOENT)
+			break;
+		/* fallthrough */
+	case BLKID_PREFETCH_ERROR:
+	case BLKID_PREFETCH_NONE:
+		blkid_free_dev(*dev);
+		*dev = NULL;
+		break;
+	case BLKID_PREFETCH_OK:
+		remove_tags(*dev);
+		set_verified(cache, *dev, st);
+		blkid_prefetch_to_tags(cache->prefetch, st->st_rdev, *dev);
+
+		DBG(PROBE, ul_debug("%s: devno 0x%04llx, type %s (prefetched)",
+			   (*dev)->bid_name, (long long)st->st_rdev, (*dev)->bid_type));
+		break;
+	}
+	return 0;
+}
+#endif
+
 /*
  * Verify that the data in dev is consistent with what is on the actual
  * block device (using the devname field only).  Normally this will be
@@ -60,8 +152,6 @@ static void blkid_probe_to_tags(blkid_probe pr, blkid_dev dev)
  */
 blkid_dev blkid_verify(blkid_cache cache, blkid_dev dev)
 {
-	blkid_tag_iterate iter;
-	const char *type, *value;
 	struct stat st;
 	time_t diff, now;
 	int fd;
@@ -69,6 +159,18 @@ blkid_dev blkid_verify(blkid_cache cache, blkid_dev dev)
 	if (!dev || !cache)
 		return NULL;
 
+	if (cache->bic_uevent_fd >= 0) {
+		blkid_read_uevents(cache);
+		if (blkid_dev_is_unchanged(dev)) {
+			DBG(PROBE, ul_debug("%s: no uevent, skip revalidation",
+						dev->bid_name));
+			return dev;
+		}
+	}
+	/* stale device is verified again or returned as unverified */
+	if (dev->bid_flags & BLKID_BID_FL_STALE)
+		dev->bid_flags &= ~BLKID_BID_FL_VERIFIED;
+
 	now = time(0);
 	diff = now - dev->bid_time;
 
@@ -87,7 +189,8 @@ blkid_dev blkid_verify(blkid_cache cache, blkid_dev dev)
 		return NULL;
 	}
 
-	if (now >= dev->bid_time &&
+	if (!(dev->bid_flags & BLKID_BID_FL_STALE) &&
+	    now >= dev->bid_time &&
 #ifdef HAVE_STRUCT_STAT_ST_MTIM_TV_NSEC
 	    (st.st_mtime < dev->bid_time ||
 	        (st.st_mtime == dev->bid_time &&
@@ -118,6 +221,10 @@ blkid_dev blkid_verify(blkid_cache cache, blkid_dev dev)
 		blkid_free_dev(dev);
 		return NULL;
 	}
+#ifdef HAVE_LIBPTHREAD
+	if (cache->prefetch && verify_prefetched(cache, &dev, &st) == 0)
+		return dev;
+#endif
 	if (!cache->probe) {
 		cache->probe = blkid_new_probe();
 		if (!cache->probe) {
@@ -142,20 +249,9 @@ blkid_dev blkid_verify(blkid_cache cache, blkid_dev dev)
 	}
 
 	/* remove old cache info */
-	iter = blkid_tag_iterate_begin(dev);
-	while (blkid_tag_next(iter, &type, &value) == 0)
-		blkid_set_tag(dev, type, NULL, 0);
-	blkid_tag_iterate_end(iter);
-
-	/* enable superblocks probing */
-	blkid_probe_enable_superblocks(cache->probe, TRUE);
-	blkid_probe_set_superblocks_flags(cache->probe,
-		BLKID_SUBLKS_LABEL | BLKID_SUBLKS_UUID |
-		BLKID_SUBLKS_TYPE | BLKID_SUBLKS_SECTYPE);
+	remove_tags(dev);
 
-	/* enable partitions probing */
-	blkid_probe_enable_partitions(cache->probe, TRUE);
-	blkid_probe_set_partitions_flags(cache->probe, BLKID_PARTS_ENTRY_DETAILS);
+	blkid_verify_setup_probe(cache->probe);
 
 	/* probe */
 	if (blkid_do_safeprobe(cache->probe)) {
@@ -165,19 +261,7 @@ blkid_dev blkid_verify(blkid_cache cache, blkid_dev dev)
 	}
 
 	if (dev) {
-#ifdef HAVE_STRUCT_STAT_ST_MTIM_TV_NSEC
-		struct timeval tv;
-		if (!gettimeofday(&tv, NULL)) {
-			dev->bid_time = tv.tv_sec;
-			dev->bid_utime = tv.tv_usec;
-		} else
-#endif
-			dev->bid_time = time(0);
-
-		dev->bid_devno = st.st_rdev;
-		dev->bid_flags |= BLKID_BID_FL_VERIFIED;
-		cache->bic_flags |= BLKID_BIC_FL_CHANGED;
-
+		set_verified(cache, dev, &st);
 		blkid_probe_to_tags(cache->probe, dev);
 
 		DBG(PROBE, ul_debug("%s: devno 0x%04llx, type %s",
@@ -31,26 +31,69 @@
 
 /*
  * Canonicalized (resolved) paths & tags cache
+ *
+ * The entries are stored in the ents[] array, the unused entries (evicted
+ * by the limit) are reused. The entries are indexed by open-addressing
+ * (linear probing) hash tables:
+ *
+ *	paths	- path entries by the key (uncanonicalized path)
+ *	tags	- tag entries by the key (NAME and value)
+ *	devs	- tag entries by the value (device name)
+ *
+ * If more entries match, then the oldest one is returned, as the entries
+ * were in the array. All entries are in LRU list, the least recently used
+ * entry is evicted if the cache limit is set (see mnt_cache_set_limit()).
  */
 #define MNT_CACHE_CHUNKSZ	128
+#define MNT_CACHE_MINLIMIT	64	/* minimal size for bounded cache */
+#define MNT_CACHE_NONE		((size_t) -1)
 
 #define MNT_CACHE_ISTAG		(1 << 1) /* entry is TAG */
 #define MNT_CACHE_ISPATH	(1 << 2) /* entry is path */
 #define MNT_CACHE_TAGREAD	(1 << 3) /* tag read by mnt_cache_read_tags() */
 
+enum {
+	MNT_CACHE_HPATHS = 0,
+	MNT_CACHE_HTAGS,
+	MNT_CACHE_HDEVS,
+
+	MNT_CACHE_NHASHES
+};
+
 /* path cache entry */
 struct mnt_cache_entry {
 	char			*key;	/* search key (e.g. uncanonicalized path) */
 	char			*value;	/* value (e.g. canonicalized path) */
-	int			flag;
+	int			flag;	/* zero for unused entry */
+
+	unsigned long		seq;	/* insert order */
+	unsigned int		hash[MNT_CACHE_NHASHES];
+
+	size_t			lru_prev;	/* more recently used */
+	size_t			lru_next;	/* less recently used or next unused */
+};
+
+struct mnt_cache_hash {
+	size_t			*slots;	/* entry index + 1, or zero */
+	size_t			size;	/* power of 2 */
+	size_t			used;
 };
 
 struct libmnt_cache {
 	struct mnt_cache_entry	*ents;
-	size_t			nents;
+	size_t			nents;	/* number of used entries */
 	size_t			nallocs;
+	size_t			ntop;	/* number of initialized entries */
+	size_t			unused;	/* list of unused entries */
 	int			refcount;
 
+	struct mnt_cache_hash	hashes[MNT_CACHE_NHASHES];
+
+	size_t			lru_head;
+	size_t			lru_tail;
+	size_t			limit;	/* max number of entries or zero */
+	unsigned long		seq;
+
 	/* blkid_evaluate_tag() works in two ways:
 	 *
 	 * 1/ all tags are evaluated by udev /dev/disk/by-* symlinks,
@@ -77,6 +120,8 @@ struct libmnt_cache *mnt_new_cache(void)
 		return NULL;
 	DBG(CACHE, ul_debugobj(cache, "alloc"));
 	cache->refcount = 1;
+	cache->unused = MNT_CACHE_NONE;
+	cache->lru_head = cache->lru_tail = MNT_CACHE_NONE;
 	return cache;
 }
 
@@ -96,12 +141,16 @@ void mnt_free_cache(struct libmnt_cache *cache)
 
 	DBG(CACHE, ul_debugobj(cache, "free [refcount=%d]", cache->refcount));
 
-	for (i = 0; i < cache->nents; i++) {
+	for (i = 0; i < cache->ntop; i++) {
 		struct mnt_cache_entry *e = &cache->ents[i];
+		if (!e->flag)
+			continue;
 		if (e->value != e->key)
 			free(e->value);
 		free(e->key);
 	}
+	for (i = 0; i < MNT_CACHE_NHASHES; i++)
+		free(cache->hashes[i].slots);
 	free(cache->ents);
 	if (cache->bc)
 		blkid_put_cache(cache->bc);
@@ -150,7 +199,7 @@ void mnt_unref_cache(struct libmnt_cache *cache)
  * Add to @cache reference to @mtab. This allows to avoid unnecessary paths
  * canonicalization in mnt_resolve_target().
  *
- * Returns: negative number in case of error, or 0 o success.
+ * Returns: negative number in case of error, or 0 on success.
  */
 int mnt_cache_set_targets(struct libmnt_cache *cache,
 				struct libmnt_table *mtab)
@@ -165,30 +214,264 @@ int mnt_cache_set_targets(struct libmnt_cache *cache,
 }
 
 
+/**
+ * mnt_cache_set_limit:
+ * @cache: cache pointer
+ * @nents: maximal number of entries or zero
+ *
+ * Sets maximal number of cached paths and tags, the least recently used
+ * entries are removed from the cache if the limit is reached. The default is
+ * zero (unlimited) and the minimal limit is 64 entries.
+ *
+ * Note that the cache owns all returned strings (e.g. by mnt_resolve_path()).
+ * If the limit is set, then the string is valid only until the cache adds
+ * the next @nents entries.
+ *
+ * Returns: negative number in case of error, or 0 on success.
+ *
+ * Since: 2.29
+ */
+int mnt_cache_set_limit(struct libmnt_cache *cache, size_t nents)
+{
+	if (!cache)
+		return -EINVAL;
+	if (nents && nents < MNT_CACHE_MINLIMIT)
+		nents = MNT_CACHE_MINLIMIT;
+
+	DBG(CACHE, ul_debugobj(cache, "set limit to %zu", nents));
+	cache->limit = nents;
+	return 0;
+}
+
+/* FNV-1a */
+static unsigned int cache_hash_str(unsigned int h, const char *str)
+{
+	const unsigned char *p = (const unsigned char *) str;
+
+	for (; *p; p++)
+		h = (h ^ *p) * 16777619U;
+	return h;
+}
+
+static unsigned int cache_hash_tag(const char *token, const char *value)
+{
+	unsigned int h = cache_hash_str(2166136261U, token);
+
+	return cache_hash_str(h * 16777619U, value);	/* include '\0' */
+}
+
+static unsigned int cache_hash_dev(const char *devname)
+{
+	return cache_hash_str(2166136261U, devname);
+}
+
+static int cache_hash_resize(struct libmnt_cache *cache, int type, size_t sz)
+{
+	struct mnt_cache_hash *h = &cache->hashes[type];
+	size_t *slots, i;
+
+	slots = calloc(sz, sizeof(size_t));
+	if (!slots)
+		return -ENOMEM;
+
+	for (i = 0; i < h->size; i++) {
+		size_t x;
+
+		if (!h->slots[i])
+			continue;
+		x = cache->ents[h->slots[i] - 1].hash[type] & (sz - 1);
+		while (slots[x])
+			x = (x + 1) & (sz - 1);
+		slots[x] = h->slots[i];
+	}
+	free(h->slots);
+	h->slots = slots;
+	h->size = sz;
+	return 0;
+}
+
+static int cache_hash_add(struct libmnt_cache *cache, int type, size_t idx)
+{
+	struct mnt_cache_hash *h = &cache->hashes[type];
+	size_t x;
+
+	/* keep load factor <= 1/2 */
+	if ((h->used + 1) * 2 > h->size) {
+		int rc = cache_hash_resize(cache, type,
+				h->size ? h->size << 1 : MNT_CACHE_CHUNKSZ);
+		if (rc)
+			return rc;
+	}
+
+	x = cache->ents[idx].hash[type] & (h->size - 1);
+	while (h->slots[x])
+		x = (x + 1) & (h->size - 1);
+	h->slots[x] = idx + 1;
+	h->used++;
+	return 0;
+}
+
+static void cache_hash_remove(struct libmnt_cache *cache, int type, size_t idx)
+{
+	struct mnt_cache_hash *h = &cache->hashes[type];
+	size_t mask = h->size - 1, i, j;
+
+	i = cache->ents[idx].hash[type] & mask;
+	while (h->slots[i] != idx + 1) {
+		if (!h->slots[i])
+			return;		/* not found */
+		i = (i + 1) & mask;
+	}
+
+	/* backward shift -- move the next entries to the free slot if
+	 * possible, the linear probing does not allow gaps */
+	j = i;
+	while (1) {
+		size_t k;
+
+		j = (j + 1) & mask;
+		if (!h->slots[j])
+			break;
+		k = cache->ents[h->slots[j] - 1].hash[type] & mask;
+
+		/* the entry's home slot is cyclically in (i, j] */
+		if (i <= j ? (i < k && k <= j) : (i < k || k <= j))
+			continue;
+		h->slots[i] = h->slots[j];
+		i = j;
+	}
+	h->slots[i] = 0;
+	h->used--;
+}
+
+static void cache_lru_unlink(struct libmnt_cache *cache, size_t idx)
+{
+	struct mnt_cache_entry *e = &cache->ents[idx];
+
+	if (e->lru_prev != MNT_CACHE_NONE)
+		cache->ents[e->lru_prev].lru_next = e->lru_next;
+	else
+		cache->lru_head = e->lru_next;
+
+	if (e->lru_next != MNT_CACHE_NONE)
+		cache->ents[e->lru_next].lru_prev = e->lru_prev;
+	else
+		cache->lru_tail = e->lru_prev;
+}
+
+static void cache_lru_push(struct libmnt_cache *cache, size_t idx)
+{
+	struct mnt_cache_entry *e = &cache->ents[idx];
+
+	e->lru_prev = MNT_CACHE_NONE;
+	e->lru_next = cache->lru_head;
+	if (cache->lru_head != MNT_CACHE_NONE)
+		cache->ents[cache->lru_head].lru_prev = idx;
+	else
+		cache->lru_tail = idx;
+	cache->lru_head = idx;
+}
+
+/* marks the entry as the most recently used */
+static void cache_touch(struct libmnt_cache *cache, struct mnt_cache_entry *e)
+{
+	size_t idx = e - cache->ents;
+
+	if (cache->lru_head == idx)
+		return;
+	cache_lru_unlink(cache, idx);
+	cache_lru_push(cache, idx);
+}
+
+static void cache_remove_entry(struct libmnt_cache *cache, size_t idx)
+{
+	struct mnt_cache_entry *e = &cache->ents[idx];
+
+	DBG(CACHE, ul_debugobj(cache, "remove entry [%2zd] (%s): %s: %s",
+			idx, (e->flag & MNT_CACHE_ISPATH) ? "path" : "tag",
+			e->value, e->key));
+
+	if (e->flag & MNT_CACHE_ISPATH)
+		cache_hash_remove(cache, MNT_CACHE_HPATHS, idx);
+	else {
+		cache_hash_remove(cache, MNT_CACHE_HTAGS, idx);
+		cache_hash_remove(cache, MNT_CACHE_HDEVS, idx);
+	}
+	cache_lru_unlink(cache, idx);
+
+	if (e->value != e->key)
+		free(e->value);
+	free(e->key);
+	memset(e, 0, sizeof(*e));
+
+	e->lru_next = cache->unused;
+	cache->unused = idx;
+	cache->nents--;
+}
+
 /* note that the @key could be the same pointer as @value */
 static int cache_add_entry(struct libmnt_cache *cache, char *key,
 					char *value, int flag)
 {
 	struct mnt_cache_entry *e;
+	size_t idx;
+	int rc;
 
 	assert(cache);
 	assert(value);
 	assert(key);
 
-	if (cache->nents == cache->nallocs) {
-		size_t sz = cache->nallocs + MNT_CACHE_CHUNKSZ;
+	if (cache->limit && cache->nents >= cache->limit
+	    && cache->lru_tail != MNT_CACHE_NONE)
+		cache_remove_entry(cache, cache->lru_tail);
 
-		e = realloc(cache->ents, sz * sizeof(struct mnt_cache_entry));
-		if (!e)
-			return -ENOMEM;
-		cache->ents = e;
-		cache->nallocs = sz;
+	if (cache->unused != MNT_CACHE_NONE) {
+		idx = cache->unused;
+		cache->unused = cache->ents[idx].lru_next;
+
+	} else {
+		if (cache->ntop == cache->nallocs) {
+			size_t sz = cache->nallocs + MNT_CACHE_CHUNKSZ;
+
+			e = realloc(cache->ents, sz * sizeof(struct mnt_cache_entry));
+			if (!e)
+				return -ENOMEM;
+			cache->ents = e;
+			cache->nallocs = sz;
+		}
+		idx = cache->ntop++;
 	}
 
-	e = &cache->ents[cache->nents];
+	e = &cache->ents[idx];
+	memset(e, 0, sizeof(*e));
 	e->key = key;
 	e->value = value;
 	e->flag = flag;
+	e->seq = cache->seq++;
+
+	if (flag & MNT_CACHE_ISPATH) {
+		e->hash[MNT_CACHE_HPATHS] = mnt_hash_path(key);
+		rc = cache_hash_add(cache, MNT_CACHE_HPATHS, idx);
+	} else {
+		e->hash[MNT_CACHE_HTAGS] = cache_hash_tag(key, key + strlen(key) + 1);
+		e->hash[MNT_CACHE_HDEVS] = cache_hash_dev(value);
+		rc = cache_hash_add(cache, MNT_CACHE_HTAGS, idx);
+		if (!rc) {
+			rc = cache_hash_add(cache, MNT_CACHE_HDEVS, idx);
+			if (rc)
+				cache_hash_remove(cache, MNT_CACHE_HTAGS, idx);
+		}
+	}
+	if (rc) {
+		/* return the entry to the unused list, the strings are
+		 * deallocated by caller */
+		memset(e, 0, sizeof(*e));
+		e->lru_next = cache->unused;
+		cache->unused = idx;
+		return rc;
+	}
+
+	cache_lru_push(cache, idx);
 	cache->nents++;
 
 	DBG(CACHE, ul_debugobj(cache, "add entry [%2zd] (%s): %s: %s",
@@ -234,24 +517,75 @@ static int cache_add_tag(struct libmnt_cache *cache, const char *tagname,
 }
 
 
+/*
+ * Returns the oldest entry from @type hash with @hash for which @match()
+ * returns true.
+ */
+static struct mnt_cache_entry *cache_lookup(struct libmnt_cache *cache,
+			int type, unsigned int hash,
+			int (*match)(struct mnt_cache_entry *, const char *, const char *),
+			const char *a, const char *b)
+{
+	struct mnt_cache_hash *h = &cache->hashes[type];
+	struct mnt_cache_entry *res = NULL;
+	size_t x;
+
+	if (!h->size)
+		return NULL;
+
+	for (x = hash & (h->size - 1); h->slots[x]; x = (x + 1) & (h->size - 1)) {
+		struct mnt_cache_entry *e = &cache->ents[h->slots[x] - 1];
+
+		if (e->hash[type] != hash || !match(e, a, b))
+			continue;
+		if (!res || e->seq < res->seq)
+			res = e;
+	}
+	return res;
+}
+
+static int match_path(struct mnt_cache_entry *e, const char *path,
+		      const char *unused __attribute__((__unused__)))
+{
+	return streq_paths(path, e->key);
+}
+
+static int match_tag(struct mnt_cache_entry *e, const char *token,
+		     const char *value)
+{
+	return strcmp(token, e->key) == 0 &&
+	       strcmp(value, e->key + strlen(token) + 1) == 0;
+}
+
+static int match_dev_tag(struct mnt_cache_entry *e, const char *devname,
+			 const char *token)
+{
+	return strcmp(e->value, devname) == 0 &&	/* dev name */
+	       strcmp(token, e->key) == 0;		/* tag name */
+}
+
+static int match_dev_tagread(struct mnt_cache_entry *e, const char *devname,
+			     const char *unused __attribute__((__unused__)))
+{
+	return (e->flag & MNT_CACHE_TAGREAD) && strcmp(e->value, devname) == 0;
+}
+
 /*
  * Returns cached canonicalized path or NULL.
  */
 static const char *cache_find_path(struct libmnt_cache *cache, const char *path)
 {
-	size_t i;
+	struct mnt_cache_entry *e;
 
 	if (!cache || !path)
 		return NULL;
 
-	for (i = 0; i < cache->nents; i++) {
-		struct mnt_cache_entry *e = &cache->ents[i];
-		if (!(e->flag & MNT_CACHE_ISPATH))
-			continue;
-		if (streq_paths(path, e->key))
-			return e->value;
-	}
-	return NULL;
+	e = cache_lookup(cache, MNT_CACHE_HPATHS, mnt_hash_path(path),
+			 match_path, path, NULL);
+	if (!e)
+		return NULL;
+	cache_touch(cache, e);
+	return e->value;
 }
 
 /*
@@ -260,44 +594,34 @@ static const char *cache_find_path(struct libmnt_cache *cache, const char *path)
 static const char *cache_find_tag(struct libmnt_cache *cache,
 			const char *token, const char *value)
 {
-	size_t i;
-	size_t tksz;
+	struct mnt_cache_entry *e;
 
 	if (!cache || !token || !value)
 		return NULL;
 
-	tksz = strlen(token);
-
-	for (i = 0; i < cache->nents; i++) {
-		struct mnt_cache_entry *e = &cache->ents[i];
-		if (!(e->flag & MNT_CACHE_ISTAG))
-			continue;
-		if (strcmp(token, e->key) == 0 &&
-		    strcmp(value, e->key + tksz + 1) == 0)
-			return e->value;
-	}
-	return NULL;
+	e = cache_lookup(cache, MNT_CACHE_HTAGS, cache_hash_tag(token, value),
+			 match_tag, token, value);
+	if (!e)
+		return NULL;
+	cache_touch(cache, e);
+	return e->value;
 }
 
 static char *cache_find_tag_value(struct libmnt_cache *cache,
 			const char *devname, const char *token)
 {
-	size_t i;
+	struct mnt_cache_entry *e;
 
 	assert(cache);
 	assert(devname);
 	assert(token);
 
-	for (i = 0; i < cache->nents; i++) {
-		struct mnt_cache_entry *e = &cache->ents[i];
-		if (!(e->flag & MNT_CACHE_ISTAG))
-			continue;
-		if (strcmp(e->value, devname) == 0 &&	/* dev name */
-		    strcmp(token, e->key) == 0)	/* tag name */
-			return e->key + strlen(token) + 1;	/* tag value */
-	}
-
-	return NULL;
+	e = cache_lookup(cache, MNT_CACHE_HDEVS, cache_hash_dev(devname),
+			 match_dev_tag, devname, token);
+	if (!e)
+		return NULL;
+	cache_touch(cache, e);
+	return e->key + strlen(token) + 1;	/* tag value */
 }
 
 /**
@@ -324,14 +648,10 @@ int mnt_cache_read_tags(struct libmnt_cache *cache, const char *devname)
 	DBG(CACHE, ul_debugobj(cache, "tags for %s requested", devname));
 
 	/* check if device is already cached */
-	for (i = 0; i < cache->nents; i++) {
-		struct mnt_cache_entry *e = &cache->ents[i];
-		if (!(e->flag & MNT_CACHE_TAGREAD))
-			continue;
-		if (strcmp(e->value, devname) == 0)
-			/* tags have already been read */
-			return 0;
-	}
+	if (cache_lookup(cache, MNT_CACHE_HDEVS, cache_hash_dev(devname),
+			 match_dev_tagread, devname, NULL))
+		/* tags have already been read */
+		return 0;
 
 	pr =  blkid_new_probe_from_filename(devname);
 	if (!pr)
@@ -805,7 +1125,7 @@ static int test_read_tags(struct libmnt_test *ts, int argc, char *argv[])
 		}
 	}
 
-	for (i = 0; i < cache->nents; i++) {
+	for (i = 0; i < cache->ntop; i++) {
 		struct mnt_cache_entry *e = &cache->ents[i];
 		if (!(e->flag & MNT_CACHE_ISTAG))
 			continue;
@@ -819,12 +1139,62 @@ static int test_read_tags(struct libmnt_test *ts, int argc, char *argv[])
 
 }
 
+/*
+ * Adds 100 paths to the cache limited to @limit entries, the first path is
+ * used (looked up) after @limit paths are added, so it's never evicted.
+ */
+static int test_limit(struct libmnt_test *ts, int argc, char *argv[])
+{
+	struct libmnt_cache *cache;
+	size_t i, limit;
+	char path[32];
+	int rc = 0;
+
+	if (argc != 2)
+		return -EINVAL;
+	limit = strtoul(argv[1], NULL, 10);
+
+	cache = mnt_new_cache();
+	if (!cache)
+		return -ENOMEM;
+	mnt_cache_set_limit(cache, limit);
+
+	for (i = 0; rc == 0 && i < 100; i++) {
+		char *key, *value;
+
+		if (i == limit)
+			cache_find_path(cache, "/limit/0");
+
+		snprintf(path, sizeof(path), "/limit/%zu", i);
+		key = strdup(path);
+		value = strdup(path);
+		if (!key || !value)
+			rc = -ENOMEM;
+		else
+			rc = cache_add_entry(cache, key, value, MNT_CACHE_ISPATH);
+		if (rc) {
+			free(key);
+			free(value);
+		}
+	}
+
+	printf("entries: %zu\n", cache->nents);
+	for (i = 0; rc == 0 && i < 100; i++) {
+		snprintf(path, sizeof(path), "//limit//%zu/", i);
+		printf("%s : %s\n", path, cache_find_path(cache, path) ? : "not cached");
+	}
+
+	mnt_unref_cache(cache);
+	return rc;
+}
+
 int main(int argc, char *argv[])
 {
 	struct libmnt_test ts[] = {
 		{ "--resolve-path", test_resolve_path, "  resolve paths from stdin" },
 		{ "--resolve-spec", test_resolve_spec, "  evaluate specs from stdin" },
 		{ "--read-tags", test_read_tags,       "  read devname or TAG from stdin (\"quit\" to exit)" },
+		{ "--limit", test_limit,               "<num>  add paths to the limited cache" },
 		{ NULL }
 	};
 
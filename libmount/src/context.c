@@ -33,8 +33,10 @@
 
 #include "mountP.h"
 #include "fileutils.h"
+#include "all-io.h"
 
 #include <sys/wait.h>
+#include <poll.h>
 
 /**
  * mnt_new_context:
@@ -93,6 +95,7 @@ void mnt_free_context(struct libmnt_context *cxt)
 	mnt_free_update(cxt->update);
 
 	free(cxt->children);
+	mnt_context_free_jobs(cxt);
 
 	DBG(CXT, ul_debugobj(cxt, "<---- free"));
 	free(cxt);
@@ -699,6 +702,8 @@ int mnt_context_set_fs(struct libmnt_context *cxt, struct libmnt_fs *fs)
 {
 	if (!cxt)
 		return -EINVAL;
+	if (fs && __mnt_fs_unshare_strings(fs))
+		return -ENOMEM;		/* the context modifies the strings */
 
 	mnt_ref_fs(fs);			/* new */
 	mnt_unref_fs(cxt->fs);		/* old */
@@ -993,6 +998,38 @@ int mnt_context_get_fstab(struct libmnt_context *cxt, struct libmnt_table **tb)
 	return 0;
 }
 
+/**
+ * mnt_context_set_mtab:
+ * @cxt: mount context
+ * @tb: table of the mounted filesystems
+ *
+ * The mount context reads mountinfo (or mtab) to the private struct
+ * libmnt_table when necessary. This function allows to overwrite the private
+ * table with an external instance, for example with a subset of the mounted
+ * filesystems for mnt_context_next_umount().
+ *
+ * This function modify the @tb reference counter. Note that the table is
+ * also released by mnt_reset_context().
+ *
+ * If the @tb argument is NULL, then the current table is reset and it will be
+ * read again when necessary.
+ *
+ * Returns: 0 on success, negative number in case of error.
+ *
+ * Since: 2.29
+ */
+int mnt_context_set_mtab(struct libmnt_context *cxt, struct libmnt_table *tb)
+{
+	if (!cxt)
+		return -EINVAL;
+
+	mnt_ref_table(tb);		/* new */
+	mnt_unref_table(cxt->mtab);	/* old */
+
+	cxt->mtab = tb;
+	return 0;
+}
+
 /**
  * mnt_context_get_mtab:
  * @cxt: mount context
@@ -1022,8 +1059,13 @@ int mnt_context_get_mtab(struct libmnt_context *cxt, struct libmnt_table **tb)
 			mnt_table_set_parser_fltrcb(cxt->mtab,
 					cxt->table_fltrcb,
 					cxt->table_fltrcb_data);
+		if (cxt->table_prefltr)
+			mnt_table_set_parser_prefilter(cxt->mtab,
+					MNT_PREFILTER_TARGET | MNT_PREFILTER_SOURCE,
+					cxt->table_prefltr, NULL, 0);
 
 		mnt_table_set_cache(cxt->mtab, mnt_context_get_cache(cxt));
+		mnt_table_enable_index(cxt->mtab, 1);
 
 		/*
 		 * Note that mtab_path is NULL if mtab is useless or unsupported
@@ -1077,13 +1119,20 @@ int mnt_context_get_mtab_for_target(struct libmnt_context *cxt,
 	if (mnt_stat_mountpoint(tgt, &st) == 0 && S_ISDIR(st.st_mode)) {
 		cache = mnt_context_get_cache(cxt);
 		cn_tgt = mnt_resolve_path(tgt, cache);
-		if (cn_tgt)
+		if (cn_tgt) {
 			mnt_context_set_tabfilter(cxt, mtab_filter, cn_tgt);
+
+			/* don't parse unrelated lines at all */
+			cxt->table_prefltr = cn_tgt;
+		}
 	}
 
 	rc = mnt_context_get_mtab(cxt, mtab);
 
 	if (cn_tgt) {
+		cxt->table_prefltr = NULL;
+		if (cxt->mtab)
+			mnt_table_set_parser_prefilter(cxt->mtab, 0, NULL, NULL, 0);
 		mnt_context_set_tabfilter(cxt, NULL, NULL);
 		if (!cache)
 			free(cn_tgt);
@@ -1366,8 +1415,8 @@ int mnt_context_get_mflags(struct libmnt_context *cxt, unsigned long *flags)
 	if (!(cxt->flags & MNT_FL_MOUNTFLAGS_MERGED) && cxt->fs) {
 		const char *o = mnt_fs_get_options(cxt->fs);
 		if (o)
-			rc = mnt_optstr_get_flags(o, flags,
-				    mnt_get_builtin_optmap(MNT_LINUX_MAP));
+			rc = mnt_fs_get_optflags(cxt->fs, MNT_OPTCACHE_OPTSTR,
+				    flags, mnt_get_builtin_optmap(MNT_LINUX_MAP));
 	}
 
 	list_for_each(p, &cxt->addmounts) {
@@ -1422,8 +1471,8 @@ int mnt_context_get_user_mflags(struct libmnt_context *cxt, unsigned long *flags
 	if (!(cxt->flags & MNT_FL_MOUNTFLAGS_MERGED) && cxt->fs) {
 		const char *o = mnt_fs_get_user_options(cxt->fs);
 		if (o)
-			rc = mnt_optstr_get_flags(o, flags,
-				mnt_get_builtin_optmap(MNT_USERSPACE_MAP));
+			rc = mnt_fs_get_optflags(cxt->fs, MNT_OPTCACHE_USER,
+				flags, mnt_get_builtin_optmap(MNT_USERSPACE_MAP));
 	}
 	if (!rc)
 		*flags |= cxt->user_mountflags;
@@ -2405,6 +2454,515 @@ int mnt_context_wait_for_children(struct libmnt_context *cxt,
 	return 0;
 }
 
+/**
+ * mnt_context_set_parallel:
+ * @cxt: mount context
+ * @nworkers: maximal number of concurrently running workers
+ *
+ * Enable parallel mode for mnt_context_next_mount() and
+ * mnt_context_next_umount(). The filesystems are [u]mounted by forked workers
+ * (at most @nworkers at the same time).
+ *
+ * A filesystem is never mounted before the previous fstab entries it depends
+ * on (mountpoints on the same path or on its parent or child directories,
+ * or a mountpoint where the source path lives), and it is never umounted
+ * before its submounts. The results are still returned in the table order.
+ *
+ * The @nworkers 0 or 1 disables the parallel mode. The parallel mode
+ * overrides mnt_context_enable_fork().
+ *
+ * Returns: 0 on success, negative number in case of error.
+ *
+ * Since: 2.29
+ */
+int mnt_context_set_parallel(struct libmnt_context *cxt, int nworkers)
+{
+	if (!cxt || nworkers < 0)
+		return -EINVAL;
+	cxt->nworkers = nworkers;
+	return 0;
+}
+
+/**
+ * mnt_context_get_parallel:
+ * @cxt: mount context
+ *
+ * Returns: maximal number of parallel workers or 0 if the parallel mode
+ *          is disabled.
+ *
+ * Since: 2.29
+ */
+int mnt_context_get_parallel(struct libmnt_context *cxt)
+{
+	return cxt && cxt->nworkers > 1 ? cxt->nworkers : 0;
+}
+
+static int add_job_dependence(struct libmnt_job *job, size_t idx)
+{
+	size_t *deps = realloc(job->deps, (job->ndeps + 1) * sizeof(size_t));
+
+	if (!deps)
+		return -ENOMEM;
+	job->deps = deps;
+	job->deps[job->ndeps++] = idx;
+	return 0;
+}
+
+/* fs-to-job map item for the mount tree lookups */
+struct job_idx {
+	struct libmnt_fs *fs;
+	size_t idx;
+};
+
+static int cmp_job_idx(const void *a, const void *b)
+{
+	const struct libmnt_fs *x = ((const struct job_idx *) a)->fs,
+			       *y = ((const struct job_idx *) b)->fs;
+
+	return x < y ? -1 : x > y ? 1 : 0;
+}
+
+/*
+ * Every job depends on jobs of the child mounts, so children are always
+ * umounted before the parent.
+ */
+static int init_jobs_tree_deps(struct libmnt_context *cxt, struct libmnt_table *tb)
+{
+	struct job_idx *map;
+	size_t i;
+	int rc = 0;
+
+	map = malloc(cxt->njobs * sizeof(struct job_idx));
+	if (!map)
+		return -ENOMEM;
+	for (i = 0; i < cxt->njobs; i++) {
+		map[i].fs = cxt->jobs[i].fs;
+		map[i].idx = i;
+	}
+	qsort(map, cxt->njobs, sizeof(struct job_idx), cmp_job_idx);
+
+	for (i = 0; rc == 0 && i < cxt->njobs; i++) {
+		struct libmnt_job *job = &cxt->jobs[i];
+		struct job_idx key, *parent;
+		int id = mnt_fs_get_id(job->fs),
+		    parent_id = mnt_fs_get_parent_id(job->fs);
+
+		if (job->ignored || id == parent_id)
+			continue;
+
+		key.fs = mnt_table_find_id(tb, parent_id);
+		if (!key.fs)
+			continue;
+		parent = bsearch(&key, map, cxt->njobs, sizeof(struct job_idx),
+				 cmp_job_idx);
+		if (parent && !cxt->jobs[parent->idx].ignored)
+			rc = add_job_dependence(&cxt->jobs[parent->idx], i);
+	}
+
+	free(map);
+	return rc;
+}
+
+/* returns 1 if @path is the same as @dir or a path within @dir */
+static int is_subpath(const char *dir, const char *path)
+{
+	size_t sz;
+
+	if (!dir || !path || *dir != '/' || *path != '/')
+		return 0;
+
+	sz = strlen(dir);
+	while (sz > 1 && dir[sz - 1] == '/')
+		sz--;
+	if (sz == 1)
+		return 1;
+	if (strncmp(dir, path, sz) != 0)
+		return 0;
+	return path[sz] == '\0' || path[sz] == '/';
+}
+
+/* returns 1 if @b has to be finished before @a (@b is before @a in the table) */
+static int is_job_dependence(struct libmnt_job *a, struct libmnt_job *b)
+{
+	const char *atgt = mnt_fs_get_target(a->fs),
+		   *btgt = mnt_fs_get_target(b->fs);
+
+	if (is_subpath(atgt, btgt) || is_subpath(btgt, atgt))
+		return 1;
+
+	/* bind mounts, loop devices, ... */
+	return is_subpath(btgt, mnt_fs_get_srcpath(a->fs))
+	    || is_subpath(atgt, mnt_fs_get_srcpath(b->fs));
+}
+
+/*
+ * Every job depends on all previous jobs with related paths, so the result is
+ * the same as if the table is processed sequentially.
+ */
+static int init_jobs_path_deps(struct libmnt_context *cxt)
+{
+	size_t i, k;
+
+	for (i = 0; i < cxt->njobs; i++) {
+		struct libmnt_job *job = &cxt->jobs[i];
+
+		if (job->ignored)
+			continue;
+		for (k = 0; k < i; k++) {
+			int rc;
+
+			if (cxt->jobs[k].ignored
+			    || !is_job_dependence(job, &cxt->jobs[k]))
+				continue;
+			rc = add_job_dependence(job, k);
+			if (rc)
+				return rc;
+		}
+	}
+	return 0;
+}
+
+/*
+ * Creates a job for all filesystems from @tb. The filesystems, where @ignore
+ * returns non-zero, are marked as ignored and finished.
+ *
+ * If @bytree is non-zero and @tb is mountinfo, then the dependencies follow
+ * the mount tree (children first), otherwise the jobs are ordered by paths.
+ */
+int mnt_context_init_jobs(struct libmnt_context *cxt,
+			struct libmnt_table *tb, int direction, int bytree,
+			int (*ignore)(struct libmnt_context *, struct libmnt_fs *))
+{
+	struct libmnt_iter itr;
+	struct libmnt_fs *fs;
+	size_t i;
+	int n, rc;
+
+	assert(cxt);
+	assert(!cxt->jobs);
+
+	n = mnt_table_get_nents(tb);
+	if (n <= 0)
+		return 0;
+	cxt->jobs = calloc(n, sizeof(struct libmnt_job));
+	if (!cxt->jobs)
+		return -ENOMEM;
+
+	mnt_reset_iter(&itr, direction);
+
+	while (cxt->njobs < (size_t) n && mnt_table_next_fs(tb, &itr, &fs) == 0) {
+		struct libmnt_job *job = &cxt->jobs[cxt->njobs++];
+
+		job->fs = fs;
+		job->fd = -1;
+		mnt_ref_fs(fs);
+
+		if (ignore(cxt, fs)) {
+			job->ignored = 1;
+			job->state = MNT_JOB_DONE;
+		}
+	}
+
+	if (bytree && is_mountinfo(tb))
+		rc = init_jobs_tree_deps(cxt, tb);
+	else
+		rc = init_jobs_path_deps(cxt);
+	if (rc)
+		return rc;
+
+	DBG(CXT, ul_debugobj(cxt, "jobs: initialized %zu jobs", cxt->njobs));
+	for (i = 0; i < cxt->njobs; i++)
+		DBG(CXT, ul_debugobj(cxt, " %s [deps=%zu]",
+				mnt_fs_get_target(cxt->jobs[i].fs),
+				cxt->jobs[i].ndeps));
+	return 0;
+}
+
+struct libmnt_job *mnt_context_find_job(struct libmnt_context *cxt,
+					struct libmnt_fs *fs)
+{
+	size_t i;
+
+	for (i = 0; i < cxt->njobs; i++) {
+		if (cxt->jobs[i].fs == fs)
+			return &cxt->jobs[i];
+	}
+	return NULL;
+}
+
+static int is_job_runnable(struct libmnt_context *cxt, struct libmnt_job *job)
+{
+	size_t i;
+
+	for (i = 0; i < job->ndeps; i++) {
+		if (cxt->jobs[job->deps[i]].state != MNT_JOB_DONE)
+			return 0;
+	}
+	return 1;
+}
+
+/* worker result header; followed by the source string */
+struct libmnt_jobres {
+	int	rc;
+	int	syscall_status;
+	int	helper_exec_status;
+	int	helper_status;
+	int	flags;
+	unsigned long mountflags;
+	unsigned long user_mountflags;
+	size_t	srcsz;
+};
+
+static void __attribute__((__noreturn__))
+run_job(struct libmnt_context *cxt, struct libmnt_job *job, int fd,
+	int (*action)(struct libmnt_context *, struct libmnt_fs *))
+{
+	struct libmnt_jobres res = { .rc = 0 };
+	const char *src;
+
+	/* behave as "mount --fork" child */
+	cxt->pid = getpid();
+	cxt->nworkers = 0;
+	mnt_context_enable_fork(cxt, FALSE);
+
+	DBG(CXT, ul_debugobj(cxt, "worker %d: %s", cxt->pid,
+				mnt_fs_get_target(job->fs)));
+
+	res.rc = action(cxt, job->fs);
+	res.syscall_status = cxt->syscall_status;
+	res.helper_exec_status = cxt->helper_exec_status;
+	res.helper_status = cxt->helper_status;
+	res.flags = cxt->flags & MNT_FL_MOUNTFLAGS_MERGED;
+	res.mountflags = cxt->mountflags;
+	res.user_mountflags = cxt->user_mountflags;
+
+	src = cxt->fs ? mnt_fs_get_source(cxt->fs) : NULL;
+	res.srcsz = src ? strlen(src) : 0;
+
+	if (write_all(fd, &res, sizeof(res)) == 0 && res.srcsz)
+		write_all(fd, src, res.srcsz);
+
+	DBG(CXT, ul_debugobj(cxt, "worker %d: exit [rc=%d]", cxt->pid, res.rc));
+	DBG_FLUSH;
+	exit(res.rc ? EXIT_FAILURE : EXIT_SUCCESS);
+}
+
+static int start_job(struct libmnt_context *cxt, struct libmnt_job *job,
+		int (*action)(struct libmnt_context *, struct libmnt_fs *))
+{
+	int fds[2];
+	pid_t pid;
+
+	if (pipe2(fds, O_CLOEXEC) != 0)
+		return -errno;
+
+	/* don't duplicate unwritten output in the worker */
+	fflush(stdout);
+	fflush(stderr);
+	DBG_FLUSH;
+
+	pid = fork();
+	switch (pid) {
+	case -1:
+		close(fds[0]);
+		close(fds[1]);
+		return -errno;
+	case 0:
+		close(fds[0]);
+		run_job(cxt, job, fds[1], action);
+	default:
+		break;
+	}
+
+	close(fds[1]);
+	job->pid = pid;
+	job->fd = fds[0];
+	job->state = MNT_JOB_RUNNING;
+	cxt->nrunning++;
+
+	DBG(CXT, ul_debugobj(cxt, "jobs: %s started [pid=%d, running=%zu]",
+				mnt_fs_get_target(job->fs), pid, cxt->nrunning));
+	return 0;
+}
+
+static void finish_job(struct libmnt_context *cxt, struct libmnt_job *job)
+{
+	struct libmnt_jobres res;
+	int status = 0;
+
+	if (read_all(job->fd, (char *) &res, sizeof(res)) == sizeof(res)) {
+		job->rc = res.rc;
+		job->syscall_status = res.syscall_status;
+		job->helper_exec_status = res.helper_exec_status;
+		job->helper_status = res.helper_status;
+		job->flags = res.flags;
+		job->mountflags = res.mountflags;
+		job->user_mountflags = res.user_mountflags;
+
+		if (res.srcsz && res.srcsz < PATH_MAX) {
+			job->source = malloc(res.srcsz + 1);
+			if (job->source &&
+			    read_all(job->fd, job->source, res.srcsz) == (ssize_t) res.srcsz)
+				job->source[res.srcsz] = '\0';
+			else {
+				free(job->source);
+				job->source = NULL;
+			}
+		}
+	} else {
+		/* worker died before it sent the result */
+		job->rc = -ECHILD;
+		job->syscall_status = 1;
+		job->helper_exec_status = 1;
+	}
+
+	close(job->fd);
+	job->fd = -1;
+
+	while (waitpid(job->pid, &status, 0) == -1 && errno == EINTR);
+
+	DBG(CXT, ul_debugobj(cxt, "jobs: %s finished [pid=%d, rc=%d, status=%d]",
+				mnt_fs_get_target(job->fs), job->pid, job->rc, status));
+	job->pid = 0;
+	job->state = MNT_JOB_DONE;
+	cxt->nrunning--;
+}
+
+/* waits for at least one running job */
+static int wait_running_jobs(struct libmnt_context *cxt)
+{
+	struct pollfd *fds;
+	struct libmnt_job **running;
+	size_t i, n = 0;
+	int rc;
+
+	fds = calloc(cxt->nrunning, sizeof(struct pollfd));
+	running = calloc(cxt->nrunning, sizeof(struct libmnt_job *));
+	if (!fds || !running) {
+		rc = -ENOMEM;
+		goto done;
+	}
+
+	for (i = 0; i < cxt->njobs && n < cxt->nrunning; i++) {
+		if (cxt->jobs[i].state != MNT_JOB_RUNNING)
+			continue;
+		running[n] = &cxt->jobs[i];
+		fds[n].fd = cxt->jobs[i].fd;
+		fds[n].events = POLLIN;
+		n++;
+	}
+
+	do {
+		rc = poll(fds, n, -1);
+	} while (rc < 0 && errno == EINTR);
+
+	if (rc < 0) {
+		rc = -errno;
+		goto done;
+	}
+	for (i = 0; i < n; i++) {
+		if (fds[i].revents)
+			finish_job(cxt, running[i]);
+	}
+	rc = 0;
+done:
+	free(fds);
+	free(running);
+	return rc;
+}
+
+/*
+ * Runs the pending jobs (at most cxt->nworkers at the same time) until @job
+ * is finished. The optional @prepare callback is called in the parent process
+ * before a job is started; if it returns a positive number, then the job is
+ * not started at all. The @action is called in the worker.
+ */
+int mnt_context_wait_job(struct libmnt_context *cxt,
+			struct libmnt_job *job,
+			int (*prepare)(struct libmnt_context *, struct libmnt_job *),
+			int (*action)(struct libmnt_context *, struct libmnt_fs *))
+{
+	int rc = 0;
+
+	assert(cxt);
+	assert(job);
+
+	while (job->state != MNT_JOB_DONE) {
+		size_t i;
+
+		for (i = 0; i < cxt->njobs && cxt->nrunning < (size_t) cxt->nworkers; i++) {
+			struct libmnt_job *x = &cxt->jobs[i];
+
+			if (x->state != MNT_JOB_PENDING || !is_job_runnable(cxt, x))
+				continue;
+
+			rc = prepare ? prepare(cxt, x) : 0;
+			if (rc < 0)
+				return rc;
+			if (rc > 0) {
+				x->state = MNT_JOB_DONE;
+				continue;
+			}
+			rc = start_job(cxt, x, action);
+			if (rc)
+				return rc;
+		}
+
+		if (job->state == MNT_JOB_DONE)
+			break;
+		rc = wait_running_jobs(cxt);
+		if (rc)
+			return rc;
+	}
+
+	return 0;
+}
+
+/*
+ * Sets @cxt as if the job has been executed in the current process.
+ */
+int mnt_context_apply_job(struct libmnt_context *cxt, struct libmnt_job *job)
+{
+	int rc;
+
+	assert(job->state == MNT_JOB_DONE);
+
+	rc = mnt_context_set_fs(cxt, job->fs);
+	if (rc)
+		return rc;
+	if (job->source)
+		mnt_fs_set_source(job->fs, job->source);
+
+	cxt->syscall_status = job->syscall_status;
+	cxt->helper_exec_status = job->helper_exec_status;
+	cxt->helper_status = job->helper_status;
+	cxt->flags |= job->flags;
+	cxt->mountflags = job->mountflags;
+	cxt->user_mountflags = job->user_mountflags;
+	return 0;
+}
+
+void mnt_context_free_jobs(struct libmnt_context *cxt)
+{
+	size_t i;
+
+	if (!cxt || !cxt->jobs)
+		return;
+
+	for (i = 0; i < cxt->njobs; i++) {
+		struct libmnt_job *job = &cxt->jobs[i];
+
+		if (job->state == MNT_JOB_RUNNING)
+			finish_job(cxt, job);
+		mnt_unref_fs(job->fs);
+		free(job->deps);
+		free(job->source);
+	}
+	free(cxt->jobs);
+	cxt->jobs = NULL;
+	cxt->njobs = 0;
+}
+
 
 
 #ifdef TEST_PROGRAM
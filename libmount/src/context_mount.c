@@ -1090,6 +1090,101 @@ int mnt_context_mount(struct libmnt_context *cxt)
 	return rc;
 }
 
+/*
+ * Returns 1 if the filesystem is not supposed to be mounted by
+ * mnt_context_next_mount().
+ */
+static int is_automount_ignored(struct libmnt_context *cxt, struct libmnt_fs *fs)
+{
+	const char *o = mnt_fs_get_user_options(fs),
+		   *tgt = mnt_fs_get_target(fs);
+
+	/*  ignore swap */
+	if (mnt_fs_is_swaparea(fs) ||
+
+	/* ignore root filesystem */
+	   (tgt && (strcmp(tgt, "/") == 0 || strcmp(tgt, "root") == 0)) ||
+
+	/* ignore noauto filesystems */
+	   (o && mnt_optstr_get_option(o, "noauto", NULL, NULL) == 0) ||
+
+	/* ignore filesystems which don't match options patterns */
+	   (cxt->fstype_pattern && !mnt_fs_match_fstype(fs,
+					cxt->fstype_pattern)) ||
+
+	/* ignore filesystems which don't match type patterns */
+	   (cxt->optstr_pattern && !mnt_fs_match_options(fs,
+					cxt->optstr_pattern))) {
+		DBG(CXT, ul_debugobj(cxt, "next-mount: not-match "
+				"[fstype: %s, t-pattern: %s, options: %s, O-pattern: %s]",
+				mnt_fs_get_fstype(fs),
+				cxt->fstype_pattern,
+				mnt_fs_get_options(fs),
+				cxt->optstr_pattern));
+		return 1;
+	}
+	return 0;
+}
+
+/* called in parent before the worker is started */
+static int prepare_mount_job(struct libmnt_context *cxt, struct libmnt_job *job)
+{
+	int rc, mounted = 0;
+
+	rc = mnt_context_is_fs_mounted(cxt, job->fs, &mounted);
+	if (rc)
+		return rc;
+	if (mounted)
+		job->ignored = 2;
+	return mounted;
+}
+
+/* called in worker */
+static int mount_job(struct libmnt_context *cxt, struct libmnt_fs *fs)
+{
+	int rc = mnt_context_set_fs(cxt, fs);
+
+	return rc ? rc : mnt_context_mount(cxt);
+}
+
+static int next_mount_parallel(struct libmnt_context *cxt,
+			       struct libmnt_table *fstab,
+			       struct libmnt_iter *itr,
+			       struct libmnt_fs *fs,
+			       int *mntrc,
+			       int *ignored)
+{
+	struct libmnt_job *job;
+	int rc;
+
+	if (!cxt->jobs) {
+		rc = mnt_context_init_jobs(cxt, fstab,
+					   mnt_iter_get_direction(itr), 0,
+					   is_automount_ignored);
+		if (rc)
+			return rc;
+	}
+
+	job = mnt_context_find_job(cxt, fs);
+	if (!job)
+		return -EINVAL;		/* fstab modified on the fly */
+
+	rc = mnt_context_wait_job(cxt, job, prepare_mount_job, mount_job);
+	if (rc)
+		return rc;
+
+	if (job->ignored) {
+		if (ignored)
+			*ignored = job->ignored;
+		return 0;
+	}
+
+	rc = mnt_context_apply_job(cxt, job);
+	if (!rc && mntrc)
+		*mntrc = job->rc;
+	return rc;
+}
+
 /**
  * mnt_context_next_mount:
  * @cxt: context
@@ -1105,6 +1200,8 @@ int mnt_context_mount(struct libmnt_context *cxt)
  *	mnt_context_set_options_pattern() to simulate mount -a -O pattern
  *	mnt_context_set_fstype_pattern()  to simulate mount -a -t pattern
  *
+ * See mnt_context_set_parallel() to mount the filesystems concurrently.
+ *
  * If the filesystem is already mounted or does not match defined criteria,
  * then the mnt_context_next_mount() function returns zero, but the @ignored is
  * non-zero. Note that the root filesystem and filesystems with "noauto" option
@@ -1126,7 +1223,6 @@ int mnt_context_next_mount(struct libmnt_context *cxt,
 			   int *ignored)
 {
 	struct libmnt_table *fstab, *mtab;
-	const char *o, *tgt;
 	int rc, mounted = 0;
 
 	if (ignored)
@@ -1147,41 +1243,24 @@ int mnt_context_next_mount(struct libmnt_context *cxt,
 		return rc;
 
 	rc = mnt_table_next_fs(fstab, itr, fs);
-	if (rc != 0)
+	if (rc != 0) {
+		if (rc == 1)
+			mnt_context_free_jobs(cxt);
 		return rc;	/* more filesystems (or error) */
+	}
 
-	o = mnt_fs_get_user_options(*fs);
-	tgt = mnt_fs_get_target(*fs);
-
-	DBG(CXT, ul_debugobj(cxt, "next-mount: trying %s", tgt));
-
-	/*  ignore swap */
-	if (mnt_fs_is_swaparea(*fs) ||
-
-	/* ignore root filesystem */
-	   (tgt && (strcmp(tgt, "/") == 0 || strcmp(tgt, "root") == 0)) ||
-
-	/* ignore noauto filesystems */
-	   (o && mnt_optstr_get_option(o, "noauto", NULL, NULL) == 0) ||
+	DBG(CXT, ul_debugobj(cxt, "next-mount: trying %s",
+				mnt_fs_get_target(*fs)));
 
-	/* ignore filesystems which don't match options patterns */
-	   (cxt->fstype_pattern && !mnt_fs_match_fstype(*fs,
-					cxt->fstype_pattern)) ||
-
-	/* ignore filesystems which don't match type patterns */
-	   (cxt->optstr_pattern && !mnt_fs_match_options(*fs,
-					cxt->optstr_pattern))) {
+	if (is_automount_ignored(cxt, *fs)) {
 		if (ignored)
 			*ignored = 1;
-		DBG(CXT, ul_debugobj(cxt, "next-mount: not-match "
-				"[fstype: %s, t-pattern: %s, options: %s, O-pattern: %s]",
-				mnt_fs_get_fstype(*fs),
-				cxt->fstype_pattern,
-				mnt_fs_get_options(*fs),
-				cxt->optstr_pattern));
 		return 0;
 	}
 
+	if (mnt_context_get_parallel(cxt))
+		return next_mount_parallel(cxt, fstab, itr, *fs, mntrc, ignored);
+
 	/* ignore already mounted filesystems */
 	rc = mnt_context_is_fs_mounted(cxt, *fs, &mounted);
 	if (rc)
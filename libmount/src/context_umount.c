@@ -453,7 +453,7 @@ static int evaluate_permissions(struct libmnt_context *cxt)
 	if (!optstr)
 		goto eperm;
 
-	if (mnt_optstr_get_flags(optstr, &u_flags,
+	if (mnt_fs_get_optflags(fs, MNT_OPTCACHE_USER, &u_flags,
 				mnt_get_builtin_optmap(MNT_USERSPACE_MAP)))
 		goto eperm;
 
@@ -929,6 +929,63 @@ int mnt_context_umount(struct libmnt_context *cxt)
 }
 
 
+/*
+ * Returns 1 if the filesystem is not supposed to be umounted by
+ * mnt_context_next_umount().
+ */
+static int is_autoumount_ignored(struct libmnt_context *cxt, struct libmnt_fs *fs)
+{
+	if (!mnt_fs_get_target(fs))
+		return 1;
+
+	/* ignore filesystems which don't match options patterns */
+	if ((cxt->fstype_pattern && !mnt_fs_match_fstype(fs,
+					cxt->fstype_pattern)) ||
+
+	/* ignore filesystems which don't match type patterns */
+	   (cxt->optstr_pattern && !mnt_fs_match_options(fs,
+					cxt->optstr_pattern)))
+		return 1;
+	return 0;
+}
+
+/* called in worker */
+static int umount_job(struct libmnt_context *cxt, struct libmnt_fs *fs)
+{
+	int rc = mnt_context_set_fs(cxt, fs);
+
+	return rc ? rc : mnt_context_umount(cxt);
+}
+
+static int next_umount_parallel(struct libmnt_context *cxt,
+				struct libmnt_table *mtab,
+				struct libmnt_iter *itr,
+				struct libmnt_fs *fs,
+				int *mntrc)
+{
+	struct libmnt_job *job;
+	int rc;
+
+	if (!cxt->jobs) {
+		rc = mnt_context_init_jobs(cxt, mtab,
+					   mnt_iter_get_direction(itr), 1,
+					   is_autoumount_ignored);
+		if (rc)
+			return rc;
+	}
+
+	job = mnt_context_find_job(cxt, fs);
+	if (!job)
+		return -EINVAL;		/* mtab modified on the fly */
+
+	rc = mnt_context_wait_job(cxt, job, NULL, umount_job);
+	if (!rc)
+		rc = mnt_context_apply_job(cxt, job);
+	if (!rc && mntrc)
+		*mntrc = job->rc;
+	return rc;
+}
+
 /**
  * mnt_context_next_umount:
  * @cxt: context
@@ -944,6 +1001,9 @@ int mnt_context_umount(struct libmnt_context *cxt)
  *	mnt_context_set_options_pattern() to simulate umount -a -O pattern
  *	mnt_context_set_fstype_pattern()  to simulate umount -a -t pattern
  *
+ * See mnt_context_set_parallel() to umount the filesystems concurrently; in
+ * this case a filesystem is never umounted before its submounts.
+ *
  * If the filesystem is not mounted or does not match the defined criteria,
  * then the function mnt_context_next_umount() returns zero, but the @ignored is
  * non-zero. Note that the root filesystem is always ignored.
@@ -985,8 +1045,11 @@ int mnt_context_next_umount(struct libmnt_context *cxt,
 
 	do {
 		rc = mnt_table_next_fs(mtab, itr, fs);
-		if (rc != 0)
+		if (rc != 0) {
+			if (rc == 1)
+				mnt_context_free_jobs(cxt);
 			return rc;	/* no more filesystems (or error) */
+		}
 
 		tgt = mnt_fs_get_target(*fs);
 	} while (!tgt);
@@ -994,13 +1057,7 @@ int mnt_context_next_umount(struct libmnt_context *cxt,
 	DBG(CXT, ul_debugobj(cxt, "next-umount: trying %s [fstype: %s, t-pattern: %s, options: %s, O-pattern: %s]", tgt,
 				 mnt_fs_get_fstype(*fs), cxt->fstype_pattern, mnt_fs_get_options(*fs), cxt->optstr_pattern));
 
-	/* ignore filesystems which don't match options patterns */
-	if ((cxt->fstype_pattern && !mnt_fs_match_fstype(*fs,
-					cxt->fstype_pattern)) ||
-
-	/* ignore filesystems which don't match type patterns */
-	   (cxt->optstr_pattern && !mnt_fs_match_options(*fs,
-					cxt->optstr_pattern))) {
+	if (is_autoumount_ignored(cxt, *fs)) {
 		if (ignored)
 			*ignored = 1;
 
@@ -1008,6 +1065,9 @@ int mnt_context_next_umount(struct libmnt_context *cxt,
 		return 0;
 	}
 
+	if (mnt_context_get_parallel(cxt))
+		return next_umount_parallel(cxt, mtab, itr, *fs, mntrc);
+
 	rc = mnt_context_set_fs(cxt, *fs);
 	if (rc)
 		return rc;
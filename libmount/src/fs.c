@@ -58,6 +58,27 @@ void mnt_free_fs(struct libmnt_fs *fs)
 	free(fs);
 }
 
+/* the table indices are built from source, target, devno and ID */
+static void fs_reset_table_index(struct libmnt_fs *fs)
+{
+	if (fs->tab)
+		__mnt_table_reset_index(fs->tab);
+}
+
+static void fs_free_optcache(struct libmnt_fs *fs)
+{
+	size_t i;
+
+	if (!fs->optcache)
+		return;
+	for (i = 0; i < MNT_OPTCACHE_NUM; i++) {
+		free(fs->optcache[i].str);
+		free(fs->optcache[i].ents);
+	}
+	free(fs->optcache);
+	fs->optcache = NULL;
+}
+
 /**
  * mnt_reset_fs:
  * @fs: fs pointer
@@ -73,22 +94,28 @@ void mnt_reset_fs(struct libmnt_fs *fs)
 
 	ref = fs->refcount;
 
+	fs_reset_table_index(fs);
 	list_del(&fs->ents);
-	free(fs->source);
+	if (fs->strarena)
+		mnt_unref_strarena(fs->strarena);
+	else {
+		free(fs->source);
+		free(fs->root);
+		free(fs->target);
+		free(fs->fstype);
+		free(fs->optstr);
+		free(fs->vfs_optstr);
+		free(fs->fs_optstr);
+		free(fs->opt_fields);
+	}
 	free(fs->bindsrc);
 	free(fs->tagname);
 	free(fs->tagval);
-	free(fs->root);
 	free(fs->swaptype);
-	free(fs->target);
-	free(fs->fstype);
-	free(fs->optstr);
-	free(fs->vfs_optstr);
-	free(fs->fs_optstr);
 	free(fs->user_optstr);
 	free(fs->attrs);
-	free(fs->opt_fields);
 	free(fs->comment);
+	fs_free_optcache(fs);
 
 	memset(fs, 0, sizeof(*fs));
 	INIT_LIST_HEAD(&fs->ents);
@@ -126,6 +153,54 @@ void mnt_unref_fs(struct libmnt_fs *fs)
 	}
 }
 
+/* strings allocated from the arena if fs->strarena is set */
+static const size_t arena_strings[] = {
+	offsetof(struct libmnt_fs, source),
+	offsetof(struct libmnt_fs, root),
+	offsetof(struct libmnt_fs, target),
+	offsetof(struct libmnt_fs, fstype),
+	offsetof(struct libmnt_fs, optstr),
+	offsetof(struct libmnt_fs, vfs_optstr),
+	offsetof(struct libmnt_fs, fs_optstr),
+	offsetof(struct libmnt_fs, opt_fields)
+};
+
+/*
+ * The mountinfo parser does not allocate the strings, the strings are in the
+ * arena shared by all entries parsed from the same file. This function copies
+ * the arena strings to private memory, it has to be called before any change
+ * of the strings.
+ */
+int __mnt_fs_unshare_strings(struct libmnt_fs *fs)
+{
+	char *copies[ARRAY_SIZE(arena_strings)] = { NULL };
+	size_t i;
+
+	if (!fs->strarena)
+		return 0;
+
+	for (i = 0; i < ARRAY_SIZE(arena_strings); i++) {
+		char *str = *((char **) ((char *) fs + arena_strings[i]));
+
+		if (!str)
+			continue;
+		copies[i] = strdup(str);
+		if (!copies[i])
+			goto err;
+	}
+
+	for (i = 0; i < ARRAY_SIZE(arena_strings); i++)
+		*((char **) ((char *) fs + arena_strings[i])) = copies[i];
+
+	mnt_unref_strarena(fs->strarena);
+	fs->strarena = NULL;
+	return 0;
+err:
+	for (i = 0; i < ARRAY_SIZE(arena_strings); i++)
+		free(copies[i]);
+	return -ENOMEM;
+}
+
 static inline int update_str(char **dest, const char *src)
 {
 	size_t sz;
@@ -183,7 +258,10 @@ struct libmnt_fs *mnt_copy_fs(struct libmnt_fs *dest,
 		dest = mnt_new_fs();
 		if (!dest)
 			return NULL;
-	}
+	} else if (__mnt_fs_unshare_strings(dest))
+		return NULL;
+	else
+		fs_reset_table_index(dest);
 
 	/*DBG(FS, ul_debugobj(dest, "copy from %p", src));*/
 
@@ -368,6 +446,10 @@ int __mnt_fs_set_source_ptr(struct libmnt_fs *fs, char *source)
 
 	assert(fs);
 
+	if (__mnt_fs_unshare_strings(fs))
+		return -ENOMEM;
+	fs_reset_table_index(fs);
+
 	if (source && blkid_parse_tag_string(source, &t, &v) == 0 &&
 	    !mnt_valid_tagname(t)) {
 		/* parsable but unknown tag -- ignore */
@@ -528,6 +610,11 @@ const char *mnt_fs_get_target(struct libmnt_fs *fs)
  */
 int mnt_fs_set_target(struct libmnt_fs *fs, const char *tgt)
 {
+	if (!fs)
+		return -EINVAL;
+	if (__mnt_fs_unshare_strings(fs))
+		return -ENOMEM;
+	fs_reset_table_index(fs);
 	return strdup_to_struct_member(fs, target, tgt);
 }
 
@@ -631,6 +718,9 @@ int __mnt_fs_set_fstype_ptr(struct libmnt_fs *fs, char *fstype)
 {
 	assert(fs);
 
+	if (__mnt_fs_unshare_strings(fs))
+		return -ENOMEM;
+
 	if (fstype != fs->fstype)
 		free(fs->fstype);
 
@@ -663,6 +753,7 @@ int __mnt_fs_set_fstype_ptr(struct libmnt_fs *fs, char *fstype)
 int mnt_fs_set_fstype(struct libmnt_fs *fs, const char *fstype)
 {
 	char *p = NULL;
+	int rc;
 
 	if (!fs)
 		return -EINVAL;
@@ -671,7 +762,41 @@ int mnt_fs_set_fstype(struct libmnt_fs *fs, const char *fstype)
 		if (!p)
 			return -ENOMEM;
 	}
-	return  __mnt_fs_set_fstype_ptr(fs, p);
+	rc = __mnt_fs_set_fstype_ptr(fs, p);
+	if (rc)
+		free(p);
+	return rc;
+}
+
+/*
+ * Merges @vfs and @fs options to @buf, see merge_optstr(). The @bufsz has to
+ * be at least strlen(@vfs) + strlen(@fs) + 5.
+ */
+void __mnt_merge_optstr_to_buffer(const char *vfs, const char *fs,
+				  char *buf, size_t bufsz)
+{
+	char *p = buf + 3;		/* make a room for rw/ro flag */
+	int ro = 0, rw = 0;
+
+	assert(bufsz >= strlen(vfs) + strlen(fs) + 5);
+
+	snprintf(p, bufsz - 3, "%s,%s", vfs, fs);
+
+	/* remove 'rw' flags */
+	rw += !mnt_optstr_remove_option(&p, "rw");	/* from vfs */
+	rw += !mnt_optstr_remove_option(&p, "rw");	/* from fs */
+
+	/* remove 'ro' flags if necessary */
+	if (rw != 2) {
+		ro += !mnt_optstr_remove_option(&p, "ro");
+		if (ro + rw < 2)
+			ro += !mnt_optstr_remove_option(&p, "ro");
+	}
+
+	if (!strlen(p))
+		memcpy(buf, ro ? "ro" : "rw", 3);
+	else
+		memcpy(buf, ro ? "ro," : "rw,", 3);
 }
 
 /*
@@ -690,9 +815,8 @@ int mnt_fs_set_fstype(struct libmnt_fs *fs, const char *fstype)
  */
 static char *merge_optstr(const char *vfs, const char *fs)
 {
-	char *res, *p;
+	char *res;
 	size_t sz;
-	int ro = 0, rw = 0;
 
 	if (!vfs && !fs)
 		return NULL;
@@ -706,25 +830,8 @@ static char *merge_optstr(const char *vfs, const char *fs)
 	res = malloc(sz);
 	if (!res)
 		return NULL;
-	p = res + 3;			/* make a room for rw/ro flag */
-
-	snprintf(p, sz - 3, "%s,%s", vfs, fs);
 
-	/* remove 'rw' flags */
-	rw += !mnt_optstr_remove_option(&p, "rw");	/* from vfs */
-	rw += !mnt_optstr_remove_option(&p, "rw");	/* from fs */
-
-	/* remove 'ro' flags if necessary */
-	if (rw != 2) {
-		ro += !mnt_optstr_remove_option(&p, "ro");
-		if (ro + rw < 2)
-			ro += !mnt_optstr_remove_option(&p, "ro");
-	}
-
-	if (!strlen(p))
-		memcpy(res, ro ? "ro" : "rw", 3);
-	else
-		memcpy(res, ro ? "ro," : "rw,", 3);
+	__mnt_merge_optstr_to_buffer(vfs, fs, res, sz);
 	return res;
 }
 
@@ -798,6 +905,8 @@ int mnt_fs_set_options(struct libmnt_fs *fs, const char *optstr)
 
 	if (!fs)
 		return -EINVAL;
+	if (__mnt_fs_unshare_strings(fs))
+		return -ENOMEM;
 	if (optstr) {
 		int rc = mnt_split_optstr(optstr, &u, &v, &f, 0, 0);
 		if (rc)
@@ -845,6 +954,8 @@ int mnt_fs_append_options(struct libmnt_fs *fs, const char *optstr)
 		return -EINVAL;
 	if (!optstr)
 		return 0;
+	if (__mnt_fs_unshare_strings(fs))
+		return -ENOMEM;
 
 	rc = mnt_split_optstr((char *) optstr, &u, &v, &f, 0, 0);
 	if (rc)
@@ -887,6 +998,8 @@ int mnt_fs_prepend_options(struct libmnt_fs *fs, const char *optstr)
 		return -EINVAL;
 	if (!optstr)
 		return 0;
+	if (__mnt_fs_unshare_strings(fs))
+		return -ENOMEM;
 
 	rc = mnt_split_optstr((char *) optstr, &u, &v, &f, 0, 0);
 	if (rc)
@@ -1081,6 +1194,10 @@ const char *mnt_fs_get_root(struct libmnt_fs *fs)
  */
 int mnt_fs_set_root(struct libmnt_fs *fs, const char *path)
 {
+	if (!fs)
+		return -EINVAL;
+	if (__mnt_fs_unshare_strings(fs))
+		return -ENOMEM;
 	return strdup_to_struct_member(fs, root, path);
 }
 
@@ -1209,6 +1326,116 @@ pid_t mnt_fs_get_tid(struct libmnt_fs *fs)
 	return fs ? fs->tid : 0;
 }
 
+static char *fs_optcache_string(struct libmnt_fs *fs, int id)
+{
+	switch (id) {
+	case MNT_OPTCACHE_OPTSTR:
+		return fs->optstr;
+	case MNT_OPTCACHE_VFS:
+		return fs->vfs_optstr;
+	case MNT_OPTCACHE_FS:
+		return fs->fs_optstr;
+	case MNT_OPTCACHE_USER:
+		return fs->user_optstr;
+	}
+	return NULL;
+}
+
+/*
+ * Returns parsed options string. The options strings are often modified
+ * in place (see mnt_optstr_*() functions), so the cache is validated by the
+ * string content rather than by the pointer. Returns NULL if there is no
+ * string or on allocation error.
+ */
+static struct libmnt_optcache *fs_get_optcache(struct libmnt_fs *fs, int id)
+{
+	struct libmnt_optcache *oc;
+	char *str = fs_optcache_string(fs, id), *p, *name, *val;
+	size_t len, namesz, valsz;
+	int rc;
+
+	if (!str)
+		return NULL;
+	if (!fs->optcache) {
+		fs->optcache = calloc(MNT_OPTCACHE_NUM, sizeof(struct libmnt_optcache));
+		if (!fs->optcache)
+			return NULL;
+	}
+
+	oc = &fs->optcache[id];
+	len = strlen(str);
+	if (oc->str && oc->len == len && memcmp(oc->str, str, len) == 0)
+		return oc;
+
+	free(oc->str);
+	free(oc->ents);
+	memset(oc, 0, sizeof(*oc));
+
+	oc->str = strndup(str, len);
+	if (!oc->str)
+		return NULL;
+	oc->len = len;
+
+	p = oc->str;
+	while ((rc = mnt_optstr_next_option(&p, &name, &namesz, &val, &valsz)) == 0) {
+		struct libmnt_optent *ent;
+
+		if ((oc->nents % 16) == 0) {
+			ent = realloc(oc->ents, (oc->nents + 16) * sizeof(*ent));
+			if (!ent)
+				goto err;
+			oc->ents = ent;
+		}
+		ent = &oc->ents[oc->nents++];
+		ent->name = name - oc->str;
+		ent->namesz = namesz;
+		ent->value = val ? (size_t) (val - oc->str) : 0;
+		ent->valsz = valsz;
+	}
+	if (rc < 0)
+		oc->error = 1;
+	return oc;
+err:
+	free(oc->str);
+	free(oc->ents);
+	memset(oc, 0, sizeof(*oc));
+	return NULL;
+}
+
+/* the same as mnt_optstr_get_option(), but uses parsed options */
+static int fs_get_option(struct libmnt_fs *fs, int id, const char *name,
+			 char **value, size_t *valsz)
+{
+	struct libmnt_optcache *oc;
+	char *str = fs_optcache_string(fs, id);
+	size_t i, namesz;
+
+	if (!name)
+		return -EINVAL;
+
+	oc = fs_get_optcache(fs, id);
+	if (!oc)
+		return mnt_optstr_get_option(str, name, value, valsz);
+
+	namesz = strlen(name);
+	for (i = 0; i < oc->nents; i++) {
+		struct libmnt_optent *ent = &oc->ents[i];
+
+		if (ent->namesz != namesz
+		    || memcmp(oc->str + ent->name, name, namesz) != 0)
+			continue;
+
+		/* return pointers to the original string */
+		if (value)
+			*value = ent->value ? str + ent->value : NULL;
+		if (valsz)
+			*valsz = ent->valsz;
+		return 0;
+	}
+
+	return oc->error ? -EINVAL : 1;
+}
+
 /**
  * mnt_fs_get_option:
  * @fs: fstab/mtab/mountinfo entry pointer
@@ -1226,14 +1453,55 @@ int mnt_fs_get_option(struct libmnt_fs *fs, const char *name,
 	if (!fs)
 		return -EINVAL;
 	if (fs->fs_optstr)
-		rc = mnt_optstr_get_option(fs->fs_optstr, name, value, valsz);
+		rc = fs_get_option(fs, MNT_OPTCACHE_FS, name, value, valsz);
 	if (rc == 1 && fs->vfs_optstr)
-		rc = mnt_optstr_get_option(fs->vfs_optstr, name, value, valsz);
+		rc = fs_get_option(fs, MNT_OPTCACHE_VFS, name, value, valsz);
 	if (rc == 1 && fs->user_optstr)
-		rc = mnt_optstr_get_option(fs->user_optstr, name, value, valsz);
+		rc = fs_get_option(fs, MNT_OPTCACHE_USER, name, value, valsz);
 	return rc;
 }
 
+/*
+ * Returns @flags modified by the options string (see mnt_optstr_get_flags()).
+ * The flags are cached for the last used @map.
+ */
+int mnt_fs_get_optflags(struct libmnt_fs *fs, int id, unsigned long *flags,
+			const struct libmnt_optmap *map)
+{
+	struct libmnt_optcache *oc;
+	char *str;
+
+	if (!fs || !flags || !map)
+		return -EINVAL;
+
+	str = fs_optcache_string(fs, id);
+	if (!str)
+		return -EINVAL;
+
+	oc = fs_get_optcache(fs, id);
+	if (!oc)
+		return mnt_optstr_get_flags(str, flags, map);
+
+	if (oc->map != map) {
+		unsigned long set = 0, keep = ~0UL;
+		int rc;
+
+		/* all options only set or clear bits, so the result for any
+		 * input is (input & keep) | set */
+		rc = mnt_optstr_get_flags(str, &set, map);
+		if (!rc)
+			rc = mnt_optstr_get_flags(str, &keep, map);
+		if (rc)
+			return rc;
+		oc->map = map;
+		oc->setflags = set;
+		oc->keepflags = keep;
+	}
+
+	*flags = (*flags & oc->keepflags) | oc->setflags;
+	return 0;
+}
+
 /**
  * mnt_fs_get_attribute:
  * @fs: fstab/mtab/mountinfo entry pointer
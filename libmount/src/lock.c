@@ -37,7 +37,8 @@ struct libmnt_lock {
 
 	unsigned int	locked :1,	/* do we own the lock? */
 			sigblock :1,	/* block signals when locked */
-			simplelock :1;	/* use flock rather than normal mtab lock */
+			simplelock :1,	/* use flock rather than normal mtab lock */
+			sharedlock :1;	/* use LOCK_SH for flock */
 
 	sigset_t oldsigmask;
 };
@@ -161,6 +162,21 @@ int mnt_lock_use_simplelock(struct libmnt_lock *ml, int enable)
 	return 0;
 }
 
+/* don't export this to API
+ *
+ * The shared lock is used for utab appends; the appends do not block each
+ * other, only an exclusive lock (e.g. utab compaction or rewrite).
+ */
+int mnt_lock_use_sharedlock(struct libmnt_lock *ml, int enable)
+{
+	if (!ml)
+		return -EINVAL;
+
+	DBG(LOCKS, ul_debugobj(ml, "flock shared: %s", enable ? "ENABLED" : "DISABLED"));
+	ml->sharedlock = enable ? 1 : 0;
+	return 0;
+}
+
 /*
  * Returns path to lockfile.
  */
@@ -195,10 +211,10 @@ static void unlock_simplelock(struct libmnt_lock *ml)
 	}
 }
 
-static int lock_simplelock(struct libmnt_lock *ml)
+static int lock_simplelock(struct libmnt_lock *ml, int nonblock)
 {
 	const char *lfile;
-	int rc;
+	int rc, op = ml->sharedlock ? LOCK_SH : LOCK_EX;
 
 	assert(ml);
 	assert(ml->simplelock);
@@ -221,14 +237,23 @@ static int lock_simplelock(struct libmnt_lock *ml)
 		goto err;
 	}
 
-	while (flock(ml->lockfile_fd, LOCK_EX) < 0) {
-		int errsv;
-		if ((errno == EAGAIN) || (errno == EINTR))
+	if (nonblock)
+		op |= LOCK_NB;
+
+	while (flock(ml->lockfile_fd, op) < 0) {
+		int errsv = errno;
+
+		if (!nonblock && (errsv == EAGAIN || errsv == EINTR))
+			continue;
+		if (nonblock && errsv == EINTR)
 			continue;
-		errsv = errno;
 		close(ml->lockfile_fd);
 		ml->lockfile_fd = -1;
-		rc = -errsv;
+		if (nonblock && errsv == EWOULDBLOCK) {
+			DBG(LOCKS, ul_debugobj(ml, "%s: busy", lfile));
+			rc = 1;
+		} else
+			rc = -errsv;
 		goto err;
 	}
 	ml->locked = 1;
@@ -524,11 +549,26 @@ int mnt_lock_file(struct libmnt_lock *ml)
 		return -EINVAL;
 
 	if (ml->simplelock)
-		return lock_simplelock(ml);
+		return lock_simplelock(ml, 0);
 
 	return lock_mtab(ml);
 }
 
+/* don't export this to API
+ *
+ * The same as mnt_lock_file(), but does not wait. Supported for flock only.
+ *
+ * Returns: 0 on success, 1 if locked by another process or negative number in
+ * case of error.
+ */
+int mnt_trylock_file(struct libmnt_lock *ml)
+{
+	if (!ml || !ml->simplelock)
+		return -EINVAL;
+
+	return lock_simplelock(ml, 1);
+}
+
 /**
  * mnt_unlock_file:
  * @ml: lock struct
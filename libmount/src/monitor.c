@@ -28,6 +28,8 @@
  *   </programlisting>
  * </informalexample>
  *
+ * Use mnt_table_refresh() to update an already parsed mountinfo table after
+ * the change, only the changed lines are parsed.
  */
 
 #include "fileutils.h"
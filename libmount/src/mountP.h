@@ -62,6 +62,20 @@ UL_DEBUG_DECLARE_MASK(libmount);
 
 #define MNT_UTAB_HEADER	"# libmount utab file\n"
 
+/* append-only utab records, see LIBMOUNT_UTAB_APPEND in tab_update.c */
+enum {
+	MNT_UTAB_ACT_NONE = 0,	/* new entry */
+	MNT_UTAB_ACT_UMOUNT,	/* ACTION=umount TARGET=<target> */
+	MNT_UTAB_ACT_MOVE,	/* ACTION=move SRC=<old target> TARGET=<target> */
+	MNT_UTAB_ACT_REMOUNT	/* ACTION=remount <entry> */
+};
+
+/* the first line of the compacted utab, followed by size of the entries */
+#define MNT_UTAB_COMPACTED	"# compacted="
+
+/* minimal number of appended bytes before compaction */
+#define MNT_UTAB_COMPACT_MINSZ	(16 * 1024)
+
 #ifdef TEST_PROGRAM
 struct libmnt_test {
 	const char	*name;
@@ -76,6 +90,7 @@ extern int mnt_run_test(struct libmnt_test *tests, int argc, char *argv[]);
 /* utils.c */
 extern int mnt_valid_tagname(const char *tagname);
 extern int append_string(char **a, const char *b);
+extern unsigned int mnt_hash_path(const char *path);
 
 extern const char *mnt_statfs_get_fstype(struct statfs *vfs);
 extern int is_file_empty(const char *name);
@@ -146,6 +161,25 @@ struct libmnt_iter {
 	} while(0)
 
 
+/*
+ * Memory for strings of the parsed mountinfo entries. The whole file is read
+ * to the first chunk and the fields of the entries point to the file content.
+ * The arena is shared by all entries from the file and it's deallocated when
+ * the last entry is deallocated.
+ */
+struct libmnt_strchunk {
+	struct libmnt_strchunk	*next;
+	char			*data;
+	size_t			size;	/* size of data[] */
+	size_t			used;	/* already allocated bytes */
+};
+
+struct libmnt_strarena {
+	int			refcount;
+	size_t			chunksz;	/* size of the next chunk */
+	struct libmnt_strchunk	*chunks;
+};
+
 /*
  * This struct represents one entry in a mtab/fstab/mountinfo file.
  * (note that fstab[1] means the first column from fstab, and so on...)
@@ -190,9 +224,46 @@ struct libmnt_fs {
 
 	char		*comment;	/* fstab comment */
 
+	struct libmnt_strarena *strarena; /* source, target, root, fstype and
+					   * options are read-only arena strings */
+	struct libmnt_table *tab;	/* table where the entry is linked */
+	uint64_t	linehash;	/* mountinfo line hash, see mnt_table_refresh() */
+	struct libmnt_optcache *optcache; /* parsed options, MNT_OPTCACHE_* items */
+
 	void		*userdata;	/* library independent data */
 };
 
+/*
+ * Parsed options string, see mnt_fs_get_option() and mnt_fs_get_optflags()
+ */
+enum {
+	MNT_OPTCACHE_OPTSTR = 0,	/* fs->optstr */
+	MNT_OPTCACHE_VFS,		/* fs->vfs_optstr */
+	MNT_OPTCACHE_FS,		/* fs->fs_optstr */
+	MNT_OPTCACHE_USER,		/* fs->user_optstr */
+	MNT_OPTCACHE_NUM
+};
+
+struct libmnt_optent {
+	size_t	name;		/* offset of the name */
+	size_t	namesz;
+	size_t	value;		/* offset of the value or 0 */
+	size_t	valsz;
+};
+
+struct libmnt_optcache {
+	char	*str;		/* copy of the parsed string */
+	size_t	len;
+	int	error;		/* the string is not completely parsed */
+
+	struct libmnt_optent *ents;
+	size_t	nents;
+
+	const struct libmnt_optmap *map;	/* map used for the flags */
+	unsigned long	setflags;	/* flags set by the options */
+	unsigned long	keepflags;	/* flags not cleared by the options */
+};
+
 /*
  * fs flags
  */
@@ -209,6 +280,17 @@ struct libmnt_fs {
 /*
  * mtab/fstab/mountinfo file
  */
+/*
+ * Parser prefilter (see mnt_table_set_parser_prefilter())
+ */
+struct libmnt_prefilter {
+	int		flags;		/* MNT_PREFILTER_* */
+	char		*path;		/* without trailing slash */
+	size_t		pathsz;
+	char		*fstypes;	/* mnt_match_fstype() pattern */
+	dev_t		devno;
+};
+
 struct libmnt_table {
 	int		fmt;		/* MNT_FMT_* file format */
 	int		nents;		/* number of entries */
@@ -225,9 +307,18 @@ struct libmnt_table {
 	int		(*fltrcb)(struct libmnt_fs *fs, void *data);
 	void		*fltrcb_data;
 
+	struct libmnt_prefilter	prefltr;	/* raw lines filter */
+
+	int		(*streamcb)(struct libmnt_table *tb,
+				    struct libmnt_fs *fs, void *data);
+	void		*streamcb_data;
+
 
 	struct list_head	ents;	/* list of entries (libmnt_fs) */
 	void		*userdata;
+
+	int		idx_enabled;	/* enable/disable hash indices */
+	struct libmnt_tabindex *idx;	/* lookup indices or NULL (see tab_index.c) */
 };
 
 extern struct libmnt_table *__mnt_new_table_from_file(const char *filename, int fmt);
@@ -275,6 +366,7 @@ struct libmnt_context
 
 	int	(*table_fltrcb)(struct libmnt_fs *fs, void *data);	/* callback for libmnt_table structs */
 	void	*table_fltrcb_data;
+	const char *table_prefltr;	/* mtab parser prefilter path or NULL */
 
 	char	*(*pwd_get_cb)(struct libmnt_context *);		/* get encryption password */
 	void	(*pwd_release_cb)(struct libmnt_context *, char *);	/* release password */
@@ -311,6 +403,11 @@ struct libmnt_context
 	int	nchildren;	/* number of children */
 	pid_t	pid;		/* 0=parent; PID=child */
 
+	int	nworkers;	/* "mount -a --parallel" max number of workers */
+	struct libmnt_job *jobs; /* "mount -a --parallel" filesystems */
+	size_t	njobs;		/* number of jobs */
+	size_t	nrunning;	/* number of running workers */
+
 
 	int	syscall_status;	/* 1: not called yet, 0: success, <0: -errno */
 };
@@ -344,6 +441,8 @@ struct libmnt_context
 
 /* lock.c */
 extern int mnt_lock_use_simplelock(struct libmnt_lock *ml, int enable);
+extern int mnt_lock_use_sharedlock(struct libmnt_lock *ml, int enable);
+extern int mnt_trylock_file(struct libmnt_lock *ml);
 
 /* optmap.c */
 extern const struct libmnt_optmap *mnt_optmap_get_entry(
@@ -360,6 +459,41 @@ extern int mnt_optstr_fix_uid(char **optstr, char *value, size_t valsz, char **n
 extern int mnt_optstr_fix_secontext(char **optstr, char *value, size_t valsz, char **next);
 extern int mnt_optstr_fix_user(char **optstr);
 
+/* tab_index.c */
+enum {
+	MNT_INDEX_TARGET = 0,
+	MNT_INDEX_SRCPATH,
+	MNT_INDEX_DEVNO,
+	MNT_INDEX_ID,
+	MNT_INDEX_LOOPDEV,	/* all /dev/loopN sources */
+
+	MNT_NINDEXES
+};
+
+struct mnt_idxnode;
+
+struct libmnt_idxiter {
+	struct mnt_idxnode	*first;		/* the first entry with the key */
+	struct mnt_idxnode	*node;		/* the next entry */
+	int			direction;	/* MNT_ITER_{FOR,BACK}WARD */
+};
+
+extern void __mnt_table_reset_index(struct libmnt_table *tb);
+extern int __mnt_table_index_iter(struct libmnt_table *tb, int type,
+				  const void *key, int direction,
+				  struct libmnt_idxiter *ix);
+extern int __mnt_idxiter_next(struct libmnt_idxiter *ix, struct libmnt_fs **fs);
+extern int __mnt_table_index_ntags(struct libmnt_table *tb);
+
+/* tab_diff.c */
+extern int __mnt_tabdiff_reset(struct libmnt_tabdiff *df);
+extern int __mnt_tabdiff_add_entry(struct libmnt_tabdiff *df, struct libmnt_fs *old,
+				   struct libmnt_fs *new, int oper);
+
+/* tab_parse.c */
+extern void mnt_ref_strarena(struct libmnt_strarena *ar);
+extern void mnt_unref_strarena(struct libmnt_strarena *ar);
+
 /* fs.c */
 extern struct libmnt_fs *mnt_copy_mtab_fs(const struct libmnt_fs *fs)
 			__attribute__((nonnull));
@@ -367,6 +501,43 @@ extern int __mnt_fs_set_source_ptr(struct libmnt_fs *fs, char *source)
 			__attribute__((nonnull(1)));
 extern int __mnt_fs_set_fstype_ptr(struct libmnt_fs *fs, char *fstype)
 			__attribute__((nonnull(1)));
+extern int __mnt_fs_unshare_strings(struct libmnt_fs *fs)
+			__attribute__((nonnull));
+extern void __mnt_merge_optstr_to_buffer(const char *vfs, const char *fs,
+			char *buf, size_t bufsz)
+			__attribute__((nonnull));
+extern int mnt_fs_get_optflags(struct libmnt_fs *fs, int id,
+			unsigned long *flags, const struct libmnt_optmap *map);
+
+/*
+ * "mount -a --parallel" job, see mnt_context_set_parallel()
+ */
+enum {
+	MNT_JOB_PENDING = 0,
+	MNT_JOB_RUNNING,
+	MNT_JOB_DONE
+};
+
+struct libmnt_job {
+	struct libmnt_fs *fs;
+	size_t	*deps;		/* jobs to be finished before this one */
+	size_t	ndeps;
+
+	int	state;		/* MNT_JOB_* */
+	int	ignored;	/* see mnt_context_next_mount() */
+	pid_t	pid;		/* worker PID */
+	int	fd;		/* worker result pipe */
+
+	/* worker result */
+	int	rc;		/* mnt_context_[u]mount() return code */
+	int	syscall_status;
+	int	helper_exec_status;
+	int	helper_status;
+	int	flags;		/* MNT_FL_MOUNTFLAGS_MERGED */
+	unsigned long mountflags;
+	unsigned long user_mountflags;
+	char	*source;	/* prepared (e.g. evaluated tag) source */
+};
 
 /* context.c */
 extern int mnt_context_mtab_writable(struct libmnt_context *cxt);
@@ -376,6 +547,19 @@ extern const char *mnt_context_get_writable_tabpath(struct libmnt_context *cxt);
 extern int mnt_context_get_mtab_for_target(struct libmnt_context *cxt,
 				    struct libmnt_table **mtab, const char *tgt);
 
+extern int mnt_context_init_jobs(struct libmnt_context *cxt,
+			struct libmnt_table *tb, int direction, int bytree,
+			int (*ignore)(struct libmnt_context *, struct libmnt_fs *));
+extern struct libmnt_job *mnt_context_find_job(struct libmnt_context *cxt,
+			struct libmnt_fs *fs);
+extern int mnt_context_wait_job(struct libmnt_context *cxt,
+			struct libmnt_job *job,
+			int (*prepare)(struct libmnt_context *, struct libmnt_job *),
+			int (*action)(struct libmnt_context *, struct libmnt_fs *));
+extern int mnt_context_apply_job(struct libmnt_context *cxt,
+			struct libmnt_job *job);
+extern void mnt_context_free_jobs(struct libmnt_context *cxt);
+
 extern int mnt_context_prepare_srcpath(struct libmnt_context *cxt);
 extern int mnt_context_prepare_target(struct libmnt_context *cxt);
 extern int mnt_context_guess_srcpath_fstype(struct libmnt_context *cxt, char **type);
@@ -198,6 +198,122 @@ const struct libmnt_optmap *mnt_get_builtin_optmap(int id)
 	return NULL;
 }
 
+/*
+ * Sorted index of the built-in maps. The maps are searched by binary search;
+ * the (rare) MNT_PREFIX entries are not in the index and they are checked
+ * linearly. The index is built when the library is loaded, so it's never
+ * modified later and it's safe to use it from more threads.
+ */
+struct optmap_index {
+	const struct libmnt_optmap *map;
+	const struct libmnt_optmap **ents;	/* sorted by name */
+	size_t nents;
+	const struct libmnt_optmap **prefixes;	/* MNT_PREFIX entries */
+	size_t nprefixes;
+};
+
+static const struct libmnt_optmap *linux_flags_ents[ARRAY_SIZE(linux_flags_map)];
+static const struct libmnt_optmap *linux_flags_prefixes[ARRAY_SIZE(linux_flags_map)];
+static const struct libmnt_optmap *userspace_opts_ents[ARRAY_SIZE(userspace_opts_map)];
+static const struct libmnt_optmap *userspace_opts_prefixes[ARRAY_SIZE(userspace_opts_map)];
+
+static struct optmap_index builtin_indexes[] = {
+	{ .map = linux_flags_map,
+	  .ents = linux_flags_ents, .prefixes = linux_flags_prefixes },
+	{ .map = userspace_opts_map,
+	  .ents = userspace_opts_ents, .prefixes = userspace_opts_prefixes }
+};
+
+/* returns the length of the option name without "=" or "[=]" suffix */
+static inline size_t optmap_entry_namesz(const struct libmnt_optmap *ent)
+{
+	return strcspn(ent->name, "=[");
+}
+
+static int optmap_namecmp(const char *name, size_t namesz,
+			  const struct libmnt_optmap *ent)
+{
+	size_t sz = optmap_entry_namesz(ent);
+	int rc = strncmp(name, ent->name, min(namesz, sz));
+
+	if (rc == 0 && namesz != sz)
+		rc = namesz < sz ? -1 : 1;
+	return rc;
+}
+
+static int optmap_entcmp(const void *a, const void *b)
+{
+	const struct libmnt_optmap *x = *(const struct libmnt_optmap **) a,
+				   *y = *(const struct libmnt_optmap **) b;
+	int rc = optmap_namecmp(x->name, optmap_entry_namesz(x), y);
+
+	/* keep the map order for the same names */
+	if (rc == 0)
+		rc = x < y ? -1 : x > y ? 1 : 0;
+	return rc;
+}
+
+static void __attribute__((__constructor__)) init_optmap_indexes(void)
+{
+	size_t i;
+
+	for (i = 0; i < ARRAY_SIZE(builtin_indexes); i++) {
+		struct optmap_index *idx = &builtin_indexes[i];
+		const struct libmnt_optmap *ent;
+
+		for (ent = idx->map; ent->name; ent++) {
+			if (ent->mask & MNT_PREFIX)
+				idx->prefixes[idx->nprefixes++] = ent;
+			else
+				idx->ents[idx->nents++] = ent;
+		}
+		qsort(idx->ents, idx->nents, sizeof(struct libmnt_optmap *),
+				optmap_entcmp);
+	}
+}
+
+static struct optmap_index *get_optmap_index(const struct libmnt_optmap *map)
+{
+	size_t i;
+
+	for (i = 0; i < ARRAY_SIZE(builtin_indexes); i++) {
+		if (builtin_indexes[i].map == map)
+			return &builtin_indexes[i];
+	}
+	return NULL;
+}
+
+/* returns the first map entry (in the map order) that matches the @name */
+static const struct libmnt_optmap *optmap_index_lookup(struct optmap_index *idx,
+				const char *name, size_t namesz)
+{
+	const struct libmnt_optmap *res = NULL;
+	size_t lo = 0, hi = idx->nents, i;
+
+	while (lo < hi) {
+		size_t mid = (lo + hi) / 2;
+		int rc = optmap_namecmp(name, namesz, idx->ents[mid]);
+
+		if (rc > 0)
+			lo = mid + 1;
+		else {
+			if (rc == 0)
+				res = idx->ents[mid];
+			hi = mid;
+		}
+	}
+
+	for (i = 0; i < idx->nprefixes; i++) {
+		const struct libmnt_optmap *ent = idx->prefixes[i];
+
+		if (res && res < ent)
+			break;
+		if (startswith(name, ent->name))
+			return ent;
+	}
+	return res;
+}
+
 /*
  * Looks up the @name in @maps and returns a map and in @mapent
  * returns the map entry
@@ -222,8 +338,18 @@ const struct libmnt_optmap *mnt_optmap_get_entry(
 	for (i = 0; i < nmaps; i++) {
 		const struct libmnt_optmap *map = maps[i];
 		const struct libmnt_optmap *ent;
+		struct optmap_index *idx = get_optmap_index(map);
 		const char *p;
 
+		if (idx) {
+			ent = optmap_index_lookup(idx, name, namelen);
+			if (!ent)
+				continue;
+			if (mapent)
+				*mapent = ent;
+			return map;
+		}
+
 		for (ent = map; ent && ent->name; ent++) {
 			if (ent->mask & MNT_PREFIX) {
 				if (startswith(name, ent->name)) {
@@ -1173,6 +1173,49 @@ static int test_flags(struct libmnt_test *ts, int argc, char *argv[])
 	return rc;
 }
 
+static int test_lookup(struct libmnt_test *ts, int argc, char *argv[])
+{
+	const struct libmnt_optmap *maps[2], *ent, *m;
+	char *optstr, *str, *name, *val;
+	size_t namesz, valsz, i;
+	int rc;
+
+	if (argc < 2)
+		return -EINVAL;
+
+	maps[0] = mnt_get_builtin_optmap(MNT_LINUX_MAP);
+	maps[1] = mnt_get_builtin_optmap(MNT_USERSPACE_MAP);
+
+	/* all entries have to be accessible by name */
+	for (i = 0; i < 2; i++) {
+		for (ent = maps[i]; ent->name; ent++) {
+			const struct libmnt_optmap *x = NULL;
+
+			m = mnt_optmap_get_entry(&maps[i], 1, ent->name,
+					strcspn(ent->name, "=["), &x);
+			if (!m || !x || x > ent || strcspn(x->name, "=[") !=
+						    strcspn(ent->name, "=["))
+				printf("%s: lookup failed\n", ent->name);
+		}
+	}
+
+	optstr = str = strdup(argv[1]);
+	if (!optstr)
+		return -ENOMEM;
+
+	while ((rc = mnt_optstr_next_option(&str, &name, &namesz, &val, &valsz)) == 0) {
+		ent = NULL;
+		m = mnt_optmap_get_entry(maps, 2, name, namesz, &ent);
+		printf("%-20.*s %-10s %-15s 0x%08x\n", (int) namesz, name,
+				!m ? "-" : m == maps[0] ? "linux" : "userspace",
+				ent ? ent->name : "-",
+				ent ? ent->id : 0);
+	}
+
+	free(optstr);
+	return rc < 0 ? rc : 0;
+}
+
 static int test_apply(struct libmnt_test *ts, int argc, char *argv[])
 {
 	char *optstr;
@@ -1335,6 +1378,7 @@ int main(int argc, char *argv[])
 		{ "--dedup",  test_dedup,  "<optstr> <name>            deduplicate name in optstr" },
 		{ "--split",  test_split,  "<optstr>                   split into FS, VFS and userspace" },
 		{ "--flags",  test_flags,  "<optstr>                   convert options to MS_* flags" },
+		{ "--lookup", test_lookup, "<optstr>                   search options in built-in maps" },
 		{ "--apply",  test_apply,  "--{linux,user} <optstr> <mask>    apply mask to optstr" },
 		{ "--fix",    test_fix,    "<optstr>                   fix uid=, gid=, user, and context=" },
 
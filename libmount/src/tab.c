@@ -163,7 +163,10 @@ void mnt_free_table(struct libmnt_table *tb)
 	mnt_reset_table(tb);
 	DBG(TAB, ul_debugobj(tb, "free [refcount=%d]", tb->refcount));
 
+	__mnt_table_reset_index(tb);
 	mnt_unref_cache(tb->cache);
+	free(tb->prefltr.path);
+	free(tb->prefltr.fstypes);
 	free(tb->comm_intro);
 	free(tb->comm_tail);
 	free(tb);
@@ -407,7 +410,9 @@ int mnt_table_add_fs(struct libmnt_table *tb, struct libmnt_fs *fs)
 
 	mnt_ref_fs(fs);
 	list_add_tail(&fs->ents, &tb->ents);
+	fs->tab = tb;
 	tb->nents++;
+	__mnt_table_reset_index(tb);
 
 	DBG(TAB, ul_debugobj(tb, "add entry: %s %s",
 			mnt_fs_get_source(fs), mnt_fs_get_target(fs)));
@@ -432,6 +437,8 @@ int mnt_table_remove_fs(struct libmnt_table *tb, struct libmnt_fs *fs)
 
 	list_del(&fs->ents);
 	INIT_LIST_HEAD(&fs->ents);	/* otherwise FS still points to the list */
+	fs->tab = NULL;
+	__mnt_table_reset_index(tb);
 
 	mnt_unref_fs(fs);
 	tb->nents--;
@@ -764,6 +771,31 @@ int mnt_table_set_iter(struct libmnt_table *tb, struct libmnt_iter *itr, struct
 	return 0;
 }
 
+/*
+ * Iterates over entries with the same @key in the table index (see
+ * tab_index.c), or over all entries if the index is not available.
+ */
+struct tab_lookup {
+	struct libmnt_iter	itr;
+	struct libmnt_idxiter	ix;
+	int			indexed;
+};
+
+static void lookup_init(struct libmnt_table *tb, struct tab_lookup *lk,
+			int type, const void *key, int direction)
+{
+	lk->indexed = __mnt_table_index_iter(tb, type, key, direction, &lk->ix) == 0;
+	mnt_reset_iter(&lk->itr, direction);
+}
+
+static int lookup_next(struct libmnt_table *tb, struct tab_lookup *lk,
+		       struct libmnt_fs **fs)
+{
+	if (lk->indexed)
+		return __mnt_idxiter_next(&lk->ix, fs);
+	return mnt_table_next_fs(tb, &lk->itr, fs);
+}
+
 /**
  * mnt_table_find_mountpoint:
  * @tb: tab pointer
@@ -829,6 +861,7 @@ struct libmnt_fs *mnt_table_find_mountpoint(struct libmnt_table *tb,
 struct libmnt_fs *mnt_table_find_target(struct libmnt_table *tb, const char *path, int direction)
 {
 	struct libmnt_iter itr;
+	struct tab_lookup lk;
 	struct libmnt_fs *fs = NULL;
 	char *cn;
 
@@ -840,8 +873,8 @@ struct libmnt_fs *mnt_table_find_target(struct libmnt_table *tb, const char *pat
 	DBG(TAB, ul_debugobj(tb, "lookup TARGET: '%s'", path));
 
 	/* native @target */
-	mnt_reset_iter(&itr, direction);
-	while(mnt_table_next_fs(tb, &itr, &fs) == 0) {
+	lookup_init(tb, &lk, MNT_INDEX_TARGET, path, direction);
+	while(lookup_next(tb, &lk, &fs) == 0) {
 		if (mnt_fs_streq_target(fs, path))
 			return fs;
 	}
@@ -849,8 +882,8 @@ struct libmnt_fs *mnt_table_find_target(struct libmnt_table *tb, const char *pat
 	/* try absolute path */
 	if (is_relative_path(path) && (cn = absolute_path(path))) {
 		DBG(TAB, ul_debugobj(tb, "lookup absolute TARGET: '%s'", cn));
-		mnt_reset_iter(&itr, direction);
-		while (mnt_table_next_fs(tb, &itr, &fs) == 0) {
+		lookup_init(tb, &lk, MNT_INDEX_TARGET, cn, direction);
+		while (lookup_next(tb, &lk, &fs) == 0) {
 			if (mnt_fs_streq_target(fs, cn)) {
 				free(cn);
 				return fs;
@@ -865,8 +898,8 @@ struct libmnt_fs *mnt_table_find_target(struct libmnt_table *tb, const char *pat
 	DBG(TAB, ul_debugobj(tb, "lookup canonical TARGET: '%s'", cn));
 
 	/* canonicalized paths in struct libmnt_table */
-	mnt_reset_iter(&itr, direction);
-	while(mnt_table_next_fs(tb, &itr, &fs) == 0) {
+	lookup_init(tb, &lk, MNT_INDEX_TARGET, cn, direction);
+	while(lookup_next(tb, &lk, &fs) == 0) {
 		if (mnt_fs_streq_target(fs, cn))
 			return fs;
 	}
@@ -874,7 +907,14 @@ struct libmnt_fs *mnt_table_find_target(struct libmnt_table *tb, const char *pat
 	/* non-canonical path in struct libmnt_table
 	 * -- note that mountpoint in /proc/self/mountinfo is already
 	 *    canonicalized by the kernel
+	 *
+	 * The cache may drop @cn when it adds more paths (see
+	 * mnt_cache_set_limit()), so use a private copy.
 	 */
+	cn = strdup(cn);
+	if (!cn)
+		return NULL;
+
 	mnt_reset_iter(&itr, direction);
 	while(mnt_table_next_fs(tb, &itr, &fs) == 0) {
 		char *p;
@@ -888,9 +928,12 @@ struct libmnt_fs *mnt_table_find_target(struct libmnt_table *tb, const char *pat
 		p = mnt_resolve_target(fs->target, tb->cache);
 		/* both canonicalized, strcmp() is fine here */
 		if (p && strcmp(cn, p) == 0)
-			return fs;
+			goto done;
 	}
-	return NULL;
+	fs = NULL;
+done:
+	free(cn);
+	return fs;
 }
 
 /**
@@ -914,6 +957,7 @@ struct libmnt_fs *mnt_table_find_target(struct libmnt_table *tb, const char *pat
 struct libmnt_fs *mnt_table_find_srcpath(struct libmnt_table *tb, const char *path, int direction)
 {
 	struct libmnt_iter itr;
+	struct tab_lookup lk;
 	struct libmnt_fs *fs = NULL;
 	int ntags = 0, nents;
 	char *cn;
@@ -927,13 +971,15 @@ struct libmnt_fs *mnt_table_find_srcpath(struct libmnt_table *tb, const char *pa
 	DBG(TAB, ul_debugobj(tb, "lookup SRCPATH: '%s'", path));
 
 	/* native paths */
-	mnt_reset_iter(&itr, direction);
-	while(mnt_table_next_fs(tb, &itr, &fs) == 0) {
+	lookup_init(tb, &lk, MNT_INDEX_SRCPATH, path, direction);
+	while(lookup_next(tb, &lk, &fs) == 0) {
 		if (mnt_fs_streq_srcpath(fs, path))
 			return fs;
-		if (mnt_fs_get_tag(fs, NULL, NULL) == 0)
+		if (!lk.indexed && mnt_fs_get_tag(fs, NULL, NULL) == 0)
 			ntags++;
 	}
+	if (lk.indexed)
+		ntags = __mnt_table_index_ntags(tb);
 
 	if (!path || !tb->cache || !(cn = mnt_resolve_path(path, tb->cache)))
 		return NULL;
@@ -944,13 +990,18 @@ struct libmnt_fs *mnt_table_find_srcpath(struct libmnt_table *tb, const char *pa
 
 	/* canonicalized paths in struct libmnt_table */
 	if (ntags < nents) {
-		mnt_reset_iter(&itr, direction);
-		while(mnt_table_next_fs(tb, &itr, &fs) == 0) {
+		lookup_init(tb, &lk, MNT_INDEX_SRCPATH, cn, direction);
+		while(lookup_next(tb, &lk, &fs) == 0) {
 			if (mnt_fs_streq_srcpath(fs, cn))
 				return fs;
 		}
 	}
 
+	/* the cache may drop @cn when it adds more paths or tags */
+	cn = strdup(cn);
+	if (!cn)
+		return NULL;
+
 	/* evaluated tag */
 	if (ntags) {
 		int rc = mnt_cache_read_tags(tb->cache, cn);
@@ -966,7 +1017,7 @@ struct libmnt_fs *mnt_table_find_srcpath(struct libmnt_table *tb, const char *pa
 					continue;
 
 				if (mnt_cache_device_has_tag(tb->cache, cn, t, v))
-					return fs;
+					goto done;
 			}
 		} else if (rc < 0 && errno == EACCES) {
 			/* @path is inaccessible, try evaluating all TAGs in @tb
@@ -980,7 +1031,7 @@ struct libmnt_fs *mnt_table_find_srcpath(struct libmnt_table *tb, const char *pa
 
 				 /* both canonicalized, strcmp() is fine here */
 				 if (x && strcmp(x, cn) == 0)
-					 return fs;
+					 goto done;
 			 }
 		}
 	}
@@ -997,11 +1048,14 @@ struct libmnt_fs *mnt_table_find_srcpath(struct libmnt_table *tb, const char *pa
 
 			/* both canonicalized, strcmp() is fine here */
 			if (p && strcmp(p, cn) == 0)
-				return fs;
+				goto done;
 		}
 	}
 
-	return NULL;
+	fs = NULL;
+done:
+	free(cn);
+	return fs;
 }
 
 
@@ -1156,6 +1210,22 @@ struct libmnt_fs *mnt_table_find_pair(struct libmnt_table *tb, const char *sourc
 
 	DBG(TAB, ul_debugobj(tb, "lookup SOURCE: %s TARGET: %s", source, target));
 
+	/* without cache the target is not canonicalized, so only the entries
+	 * with the same target string are possible */
+	if (!tb->cache) {
+		struct tab_lookup lk;
+
+		lookup_init(tb, &lk, MNT_INDEX_TARGET, target, direction);
+		if (lk.indexed) {
+			while (lookup_next(tb, &lk, &fs) == 0) {
+				if (mnt_fs_match_target(fs, target, NULL) &&
+				    mnt_fs_match_source(fs, source, NULL))
+					return fs;
+			}
+			return NULL;
+		}
+	}
+
 	mnt_reset_iter(&itr, direction);
 	while(mnt_table_next_fs(tb, &itr, &fs) == 0) {
 
@@ -1182,7 +1252,7 @@ struct libmnt_fs *mnt_table_find_devno(struct libmnt_table *tb,
 				       dev_t devno, int direction)
 {
 	struct libmnt_fs *fs = NULL;
-	struct libmnt_iter itr;
+	struct tab_lookup lk;
 
 	if (!tb)
 		return NULL;
@@ -1191,9 +1261,9 @@ struct libmnt_fs *mnt_table_find_devno(struct libmnt_table *tb,
 
 	DBG(TAB, ul_debugobj(tb, "lookup DEVNO: %d", (int) devno));
 
-	mnt_reset_iter(&itr, direction);
+	lookup_init(tb, &lk, MNT_INDEX_DEVNO, &devno, direction);
 
-	while(mnt_table_next_fs(tb, &itr, &fs) == 0) {
+	while(lookup_next(tb, &lk, &fs) == 0) {
 		if (mnt_fs_get_devno(fs) == devno)
 			return fs;
 	}
@@ -1201,6 +1271,35 @@ struct libmnt_fs *mnt_table_find_devno(struct libmnt_table *tb,
 	return NULL;
 }
 
+/**
+ * mnt_table_find_id
+ * @tb: /proc/self/mountinfo
+ * @id: mount ID
+ *
+ * Returns: a tab entry with mountinfo ID @id or NULL.
+ *
+ * Since: 2.29
+ */
+struct libmnt_fs *mnt_table_find_id(struct libmnt_table *tb, int id)
+{
+	struct libmnt_fs *fs = NULL;
+	struct tab_lookup lk;
+
+	if (!tb)
+		return NULL;
+
+	DBG(TAB, ul_debugobj(tb, "lookup ID: %d", id));
+
+	lookup_init(tb, &lk, MNT_INDEX_ID, &id, MNT_ITER_FORWARD);
+
+	while(lookup_next(tb, &lk, &fs) == 0) {
+		if (mnt_fs_get_id(fs) == id)
+			return fs;
+	}
+
+	return NULL;
+}
+
 static char *remove_mountpoint_from_path(const char *path, const char *mnt)
 {
         char *res;
@@ -1448,6 +1547,72 @@ err:
 	return NULL;
 }
 
+/*
+ * Compares mountinfo entry @fs with @fstab_fs for mnt_table_is_fs_mounted().
+ * The @xtgt is canonicalized fstab target, it's allocated on demand.
+ */
+static int is_fs_mounted_as(struct libmnt_table *tb, struct libmnt_fs *fs,
+			    struct libmnt_fs *fstab_fs,
+			    const char *src, const char *tgt, const char *root,
+			    dev_t devno, char **xtgt)
+{
+	int eq = mnt_fs_streq_srcpath(fs, src);
+
+	if (!eq && devno && mnt_fs_get_devno(fs) == devno)
+		eq = 1;
+
+	if (!eq) {
+		/* The source does not match. Maybe the source is a loop
+		 * device backing file.
+		 */
+		uint64_t offset = 0;
+		char *val;
+		size_t len;
+		int flags = 0;
+
+		if (!mnt_fs_get_srcpath(fs) ||
+		    !startswith(mnt_fs_get_srcpath(fs), "/dev/loop"))
+			return 0;	/* does not look like loopdev */
+
+		if (mnt_fs_get_option(fstab_fs, "offset", &val, &len) == 0) {
+			if (mnt_parse_offset(val, len, &offset)) {
+				DBG(FS, ul_debugobj(fstab_fs, "failed to parse offset="));
+				return 0;
+			}
+			flags = LOOPDEV_FL_OFFSET;
+		}
+
+		DBG(FS, ul_debugobj(fs, "checking for loop: src=%s", mnt_fs_get_srcpath(fs)));
+#if __linux__
+		if (!loopdev_is_used(mnt_fs_get_srcpath(fs), src, offset, 0, flags))
+			return 0;
+
+		DBG(FS, ul_debugobj(fs, "used loop"));
+#endif
+	}
+
+	if (root) {
+		const char *r = mnt_fs_get_root(fs);
+		if (!r || strcmp(r, root) != 0)
+			return 0;
+	}
+
+	/*
+	 * Compare target, try to minimize the number of situations when we
+	 * need to canonicalize the path to avoid readlink() on
+	 * mountpoints.
+	 */
+	if (!*xtgt) {
+		if (mnt_fs_streq_target(fs, tgt))
+			return 1;
+		if (tb->cache)
+			*xtgt = mnt_resolve_path(tgt, tb->cache);
+	}
+	if (*xtgt && mnt_fs_streq_target(fs, *xtgt))
+		return 1;
+	return 0;
+}
+
 /**
  * mnt_table_is_fs_mounted:
  * @tb: /proc/self/mountinfo file
@@ -1470,8 +1635,11 @@ err:
  */
 int mnt_table_is_fs_mounted(struct libmnt_table *tb, struct libmnt_fs *fstab_fs)
 {
-	struct libmnt_iter itr;
+	static const int keys[] = {
+		MNT_INDEX_SRCPATH, MNT_INDEX_DEVNO, MNT_INDEX_LOOPDEV
+	};
 	struct libmnt_fs *fs;
+	size_t i;
 
 	char *root = NULL;
 	const char *src = NULL, *tgt = NULL;
@@ -1521,70 +1689,30 @@ int mnt_table_is_fs_mounted(struct libmnt_table *tb, struct libmnt_fs *fstab_fs)
 		DBG(FS, ul_debugobj(fstab_fs, "- ignore (no source/target)"));
 		goto done;
 	}
-	mnt_reset_iter(&itr, MNT_ITER_FORWARD);
-
 	DBG(FS, ul_debugobj(fstab_fs, "mnt_table_is_fs_mounted: src=%s, tgt=%s, root=%s", src, tgt, root));
 
-	while (mnt_table_next_fs(tb, &itr, &fs) == 0) {
-
-		int eq = mnt_fs_streq_srcpath(fs, src);
+	/* entries with the same source, devno and all loop devices, or all
+	 * entries if the table index is not available */
+	for (i = 0; i < ARRAY_SIZE(keys); i++) {
+		struct tab_lookup lk;
 
-		if (!eq && devno && mnt_fs_get_devno(fs) == devno)
-			eq = 1;
-
-		if (!eq) {
-			/* The source does not match. Maybe the source is a loop
-			 * device backing file.
-			 */
-			uint64_t offset = 0;
-			char *val;
-			size_t len;
-			int flags = 0;
-
-			if (!mnt_fs_get_srcpath(fs) ||
-			    !startswith(mnt_fs_get_srcpath(fs), "/dev/loop"))
-				continue;	/* does not look like loopdev */
+		if (keys[i] == MNT_INDEX_DEVNO && !devno)
+			continue;
 
-			if (mnt_fs_get_option(fstab_fs, "offset", &val, &len) == 0) {
-				if (mnt_parse_offset(val, len, &offset)) {
-					DBG(FS, ul_debugobj(fstab_fs, "failed to parse offset="));
-					continue;
-				}
-				flags = LOOPDEV_FL_OFFSET;
+		lookup_init(tb, &lk, keys[i],
+			    keys[i] == MNT_INDEX_SRCPATH ?
+				(const void *) src : (const void *) &devno,
+			    MNT_ITER_FORWARD);
+		while (lookup_next(tb, &lk, &fs) == 0) {
+			if (is_fs_mounted_as(tb, fs, fstab_fs, src, tgt, root,
+					     devno, &xtgt)) {
+				rc = 1;		/* success */
+				goto done;
 			}
-
-			DBG(FS, ul_debugobj(fs, "checking for loop: src=%s", mnt_fs_get_srcpath(fs)));
-#if __linux__
-			if (!loopdev_is_used(mnt_fs_get_srcpath(fs), src, offset, 0, flags))
-				continue;
-
-			DBG(FS, ul_debugobj(fs, "used loop"));
-#endif
 		}
-
-		if (root) {
-			const char *r = mnt_fs_get_root(fs);
-			if (!r || strcmp(r, root) != 0)
-				continue;
-		}
-
-		/*
-		 * Compare target, try to minimize the number of situations when we
-		 * need to canonicalize the path to avoid readlink() on
-		 * mountpoints.
-		 */
-		if (!xtgt) {
-			if (mnt_fs_streq_target(fs, tgt))
-				break;
-			if (tb->cache)
-				xtgt = mnt_resolve_path(tgt, tb->cache);
-		}
-		if (xtgt && mnt_fs_streq_target(fs, xtgt))
-			break;
+		if (!lk.indexed)
+			break;		/* all entries already checked */
 	}
-
-	if (fs)
-		rc = 1;		/* success */
 done:
 	free(root);
 
@@ -1593,6 +1721,7 @@ done:
 }
 
 #ifdef TEST_PROGRAM
+#include <sys/time.h>
 #include "pathnames.h"
 
 static int parser_errcb(struct libmnt_table *tb, const char *filename, int line)
@@ -1690,6 +1819,86 @@ done:
 	return rc;
 }
 
+static int prefilter_print(struct libmnt_table *tb __attribute__((__unused__)),
+			   struct libmnt_fs *fs, void *data)
+{
+	int *count = (int *) data;
+
+	printf("%s on %s type %s\n", mnt_fs_get_source(fs),
+			mnt_fs_get_target(fs), mnt_fs_get_fstype(fs));
+	(*count)++;
+	return 0;
+}
+
+static int test_prefilter(struct libmnt_test *ts, int argc, char *argv[])
+{
+	struct libmnt_table *tb;
+	const char *path = NULL, *types = NULL;
+	int rc, flags = 0, count = 0;
+
+	if (argc < 3)
+		return -EINVAL;
+	if (argc > 3) {
+		if (strcmp(argv[2], "target") == 0)
+			flags = MNT_PREFILTER_TARGET;
+		else if (strcmp(argv[2], "mountpoint") == 0)
+			flags = MNT_PREFILTER_MOUNTPOINT;
+		else if (strcmp(argv[2], "source") == 0)
+			flags = MNT_PREFILTER_SOURCE;
+		else
+			return -EINVAL;
+		path = argv[3];
+		if (argc > 4)
+			types = argv[4];
+	} else
+		types = argv[2];
+
+	tb = mnt_new_table();
+	if (!tb)
+		return -ENOMEM;
+
+	mnt_table_set_parser_errcb(tb, parser_errcb);
+	mnt_table_set_parser_prefilter(tb, flags, path, types, 0);
+	mnt_table_set_parser_streamcb(tb, prefilter_print, &count);
+
+	rc = mnt_table_parse_file(tb, argv[1]);
+	if (!rc)
+		printf("%d entries, table size %d\n", count, mnt_table_get_nents(tb));
+
+	mnt_unref_table(tb);
+	return rc;
+}
+
+static int test_parse_bench(struct libmnt_test *ts, int argc, char *argv[])
+{
+	struct timeval start, end;
+	int i, nents = 0, loops = 100;
+	double usec;
+
+	if (argc < 2)
+		return -EINVAL;
+	if (argc == 3)
+		loops = atoi(argv[2]);
+	if (loops <= 0)
+		return -EINVAL;
+
+	gettimeofday(&start, NULL);
+	for (i = 0; i < loops; i++) {
+		struct libmnt_table *tb = create_table(argv[1], FALSE);
+
+		if (!tb)
+			return -1;
+		nents = mnt_table_get_nents(tb);
+		mnt_unref_table(tb);
+	}
+	gettimeofday(&end, NULL);
+
+	usec = (end.tv_sec - start.tv_sec) * 1000000.0 + (end.tv_usec - start.tv_usec);
+	printf("%s: %d entries, %d loops, %.1f usec per parse\n",
+			argv[1], nents, loops, usec / loops);
+	return 0;
+}
+
 static int test_find(struct libmnt_test *ts, int argc, char *argv[], int dr)
 {
 	struct libmnt_table *tb;
@@ -1769,6 +1978,55 @@ done:
 	return rc;
 }
 
+/* compares lookups with and without index for all entries from the file */
+static int test_index(struct libmnt_test *ts, int argc, char *argv[])
+{
+	struct libmnt_table *tb;
+	struct libmnt_iter *itr;
+	struct libmnt_fs *fs;
+	int rc = 0, nlookups = 0;
+
+	tb = create_table(argv[1], FALSE);
+	if (!tb)
+		return -1;
+	itr = mnt_new_iter(MNT_ITER_FORWARD);
+	if (!itr) {
+		mnt_unref_table(tb);
+		return -1;
+	}
+
+	while (mnt_table_next_fs(tb, itr, &fs) == 0) {
+		struct libmnt_fs *res[2][7];
+		const char *tgt = mnt_fs_get_target(fs),
+			   *src = mnt_fs_get_srcpath(fs);
+		int i, k;
+
+		for (i = 0; i < 2; i++) {
+			mnt_table_enable_index(tb, i);
+
+			res[i][0] = mnt_table_find_target(tb, tgt, MNT_ITER_FORWARD);
+			res[i][1] = mnt_table_find_target(tb, tgt, MNT_ITER_BACKWARD);
+			res[i][2] = mnt_table_find_srcpath(tb, src, MNT_ITER_FORWARD);
+			res[i][3] = mnt_table_find_srcpath(tb, src, MNT_ITER_BACKWARD);
+			res[i][4] = mnt_table_find_devno(tb, mnt_fs_get_devno(fs), MNT_ITER_FORWARD);
+			res[i][5] = mnt_table_find_devno(tb, mnt_fs_get_devno(fs), MNT_ITER_BACKWARD);
+			res[i][6] = mnt_table_find_id(tb, mnt_fs_get_id(fs));
+		}
+		for (k = 0; k < 7; k++) {
+			nlookups++;
+			if (res[0][k] != res[1][k]) {
+				printf("%s: lookup %d mismatch\n", tgt, k);
+				rc = -1;
+			}
+		}
+	}
+
+	printf("%d lookups %s\n", nlookups, rc == 0 ? "OK" : "FAILED");
+	mnt_free_iter(itr);
+	mnt_unref_table(tb);
+	return rc;
+}
+
 static int test_find_mountpoint(struct libmnt_test *ts, int argc, char *argv[])
 {
 	struct libmnt_table *tb;
@@ -1892,10 +2150,13 @@ int main(int argc, char *argv[])
 {
 	struct libmnt_test tss[] = {
 	{ "--parse",    test_parse,        "<file> [--comments] parse and print tab" },
+	{ "--parse-bench", test_parse_bench, "<file> [<loops>] measure parsing speed" },
+	{ "--parse-prefilter", test_prefilter, "<file> [target|mountpoint|source <path>] [<fstypes>] print matching entries" },
 	{ "--find-forward",  test_find_fw, "<file> <source|target> <string>" },
 	{ "--find-backward", test_find_bw, "<file> <source|target> <string>" },
 	{ "--uniq-target",   test_uniq,    "<file>" },
 	{ "--find-pair",     test_find_pair, "<file> <source> <target>" },
+	{ "--check-index",   test_index,   "<file>  compare lookups with and without index" },
 	{ "--find-mountpoint", test_find_mountpoint, "<path>" },
 	{ "--copy-fs",       test_copy_fs, "<file>  copy root FS from the file" },
 	{ "--is-mounted",    test_is_mounted, "<fstab> check what from fstab is already mounted" },
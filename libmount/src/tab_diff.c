@@ -19,6 +19,7 @@ struct tabdiff_entry {
 	struct libmnt_fs *new_fs;	/* pointer to the new FS */
 
 	struct list_head changes;
+	struct tabdiff_entry *id_next;	/* next MOUNT entry in the ID hash */
 };
 
 struct libmnt_tabdiff {
@@ -26,6 +27,9 @@ struct libmnt_tabdiff {
 
 	struct list_head changes;	/* list with modified entries */
 	struct list_head unused;	/* list with unused entries */
+
+	struct tabdiff_entry **id_hash;	/* MOUNT entries by mount ID */
+	size_t id_hashsz;		/* power of 2 */
 };
 
 /**
@@ -77,7 +81,13 @@ void mnt_free_tabdiff(struct libmnt_tabdiff *df)
 			                  struct tabdiff_entry, changes);
 		free_tabdiff_entry(de);
 	}
+	while (!list_empty(&df->unused)) {
+		struct tabdiff_entry *de = list_entry(df->unused.next,
+			                  struct tabdiff_entry, changes);
+		free_tabdiff_entry(de);
+	}
 
+	free(df->id_hash);
 	free(df);
 }
 
@@ -119,7 +129,7 @@ int mnt_tabdiff_next_change(struct libmnt_tabdiff *df, struct libmnt_iter *itr,
 	return rc;
 }
 
-static int tabdiff_reset(struct libmnt_tabdiff *df)
+int __mnt_tabdiff_reset(struct libmnt_tabdiff *df)
 {
 	assert(df);
 
@@ -145,8 +155,8 @@ static int tabdiff_reset(struct libmnt_tabdiff *df)
 	return 0;
 }
 
-static int tabdiff_add_entry(struct libmnt_tabdiff *df, struct libmnt_fs *old,
-			     struct libmnt_fs *new, int oper)
+int __mnt_tabdiff_add_entry(struct libmnt_tabdiff *df, struct libmnt_fs *old,
+			    struct libmnt_fs *new, int oper)
 {
 	struct tabdiff_entry *de;
 
@@ -181,18 +191,57 @@ static int tabdiff_add_entry(struct libmnt_tabdiff *df, struct libmnt_fs *old,
 	return 0;
 }
 
+static inline size_t id_hash_slot(struct libmnt_tabdiff *df, int id)
+{
+	return ((unsigned int) id * 2654435761U) & (df->id_hashsz - 1);
+}
+
+/*
+ * Hashes all MOUNT entries by mount ID, the entries with the same hash are
+ * linked in the list order.
+ */
+static int tabdiff_hash_mounts(struct libmnt_tabdiff *df)
+{
+	struct list_head *p;
+	size_t sz = 16;
+
+	while (sz < (size_t) df->nchanges)
+		sz <<= 1;
+
+	if (sz > df->id_hashsz) {
+		struct tabdiff_entry **x = realloc(df->id_hash, sz * sizeof(*x));
+
+		if (!x)
+			return -ENOMEM;
+		df->id_hash = x;
+		df->id_hashsz = sz;
+	}
+	memset(df->id_hash, 0, df->id_hashsz * sizeof(*df->id_hash));
+
+	list_for_each_backwardly(p, &df->changes) {
+		struct tabdiff_entry *de, **x;
+
+		de = list_entry(p, struct tabdiff_entry, changes);
+		if (de->oper != MNT_TABDIFF_MOUNT || !de->new_fs)
+			continue;
+
+		x = &df->id_hash[id_hash_slot(df, mnt_fs_get_id(de->new_fs))];
+		de->id_next = *x;
+		*x = de;
+	}
+	return 0;
+}
+
 static struct tabdiff_entry *tabdiff_get_mount(struct libmnt_tabdiff *df,
 					       const char *src,
 					       int id)
 {
-	struct list_head *p;
+	struct tabdiff_entry *de;
 
 	assert(df);
+	assert(df->id_hash);
 
-	list_for_each(p, &df->changes) {
-		struct tabdiff_entry *de;
-
-		de = list_entry(p, struct tabdiff_entry, changes);
+	for (de = df->id_hash[id_hash_slot(df, id)]; de; de = de->id_next) {
 
 		if (de->oper == MNT_TABDIFF_MOUNT && de->new_fs &&
 		    mnt_fs_get_id(de->new_fs) == id) {
@@ -217,6 +266,10 @@ static struct tabdiff_entry *tabdiff_get_mount(struct libmnt_tabdiff *df,
  * Compares @old_tab and @new_tab, the result is stored in @df and accessible by
  * mnt_tabdiff_next_change().
  *
+ * The entries are paired by source and target, and the hash indices of the
+ * tables are used for the lookups if the tables have no cache (see
+ * mnt_table_enable_index()). The moved filesystems are detected by mount ID.
+ *
  * Returns: number of changes, negative number in case of error.
  */
 int mnt_diff_tables(struct libmnt_tabdiff *df, struct libmnt_table *old_tab,
@@ -224,12 +277,12 @@ int mnt_diff_tables(struct libmnt_tabdiff *df, struct libmnt_table *old_tab,
 {
 	struct libmnt_fs *fs;
 	struct libmnt_iter itr;
-	int no, nn;
+	int no, nn, o_idx, n_idx, rc = 0;
 
 	if (!df || !old_tab || !new_tab)
 		return -EINVAL;
 
-	tabdiff_reset(df);
+	__mnt_tabdiff_reset(df);
 
 	no = mnt_table_get_nents(old_tab);
 	nn = mnt_table_get_nents(new_tab);
@@ -241,17 +294,23 @@ int mnt_diff_tables(struct libmnt_tabdiff *df, struct libmnt_table *old_tab,
 				          "old=%p (%d entries)",
 				new_tab, nn, old_tab, no));
 
+	/* mnt_table_find_pair() lookups by index */
+	o_idx = old_tab->idx_enabled;
+	n_idx = new_tab->idx_enabled;
+	mnt_table_enable_index(old_tab, 1);
+	mnt_table_enable_index(new_tab, 1);
+
 	mnt_reset_iter(&itr, MNT_ITER_FORWARD);
 
 	/* all mounted or umounted */
 	if (!no && nn) {
 		while(mnt_table_next_fs(new_tab, &itr, &fs) == 0)
-			tabdiff_add_entry(df, NULL, fs, MNT_TABDIFF_MOUNT);
+			__mnt_tabdiff_add_entry(df, NULL, fs, MNT_TABDIFF_MOUNT);
 		goto done;
 
 	} else if (no && !nn) {
 		while(mnt_table_next_fs(old_tab, &itr, &fs) == 0)
-			tabdiff_add_entry(df, fs, NULL, MNT_TABDIFF_UMOUNT);
+			__mnt_tabdiff_add_entry(df, fs, NULL, MNT_TABDIFF_UMOUNT);
 		goto done;
 	}
 
@@ -264,7 +323,7 @@ int mnt_diff_tables(struct libmnt_tabdiff *df, struct libmnt_table *old_tab,
 		o_fs = mnt_table_find_pair(old_tab, src, tgt, MNT_ITER_FORWARD);
 		if (!o_fs)
 			/* 'fs' is not in the old table -- so newly mounted */
-			tabdiff_add_entry(df, NULL, fs, MNT_TABDIFF_MOUNT);
+			__mnt_tabdiff_add_entry(df, NULL, fs, MNT_TABDIFF_MOUNT);
 		else {
 			/* is modified? */
 			const char *v1 = mnt_fs_get_vfs_options(o_fs),
@@ -273,10 +332,16 @@ int mnt_diff_tables(struct libmnt_tabdiff *df, struct libmnt_table *old_tab,
 				   *f2 = mnt_fs_get_fs_options(fs);
 
 			if ((v1 && v2 && strcmp(v1, v2)) || (f1 && f2 && strcmp(f1, f2)))
-				tabdiff_add_entry(df, o_fs, fs, MNT_TABDIFF_REMOUNT);
+				__mnt_tabdiff_add_entry(df, o_fs, fs, MNT_TABDIFF_REMOUNT);
 		}
 	}
 
+	if (tabdiff_hash_mounts(df) != 0) {
+		__mnt_tabdiff_reset(df);
+		rc = -ENOMEM;
+		goto done;
+	}
+
 	/* search umounted or moved */
 	mnt_reset_iter(&itr, MNT_ITER_FORWARD);
 	while(mnt_table_next_fs(old_tab, &itr, &fs) == 0) {
@@ -293,37 +358,27 @@ int mnt_diff_tables(struct libmnt_tabdiff *df, struct libmnt_table *old_tab,
 				de->oper = MNT_TABDIFF_MOVE;
 				de->old_fs = fs;
 			} else
-				tabdiff_add_entry(df, fs, NULL, MNT_TABDIFF_UMOUNT);
+				__mnt_tabdiff_add_entry(df, fs, NULL, MNT_TABDIFF_UMOUNT);
 		}
 	}
 done:
+	mnt_table_enable_index(old_tab, o_idx);
+	mnt_table_enable_index(new_tab, n_idx);
+
+	if (rc)
+		return rc;
+
 	DBG(DIFF, ul_debugobj(df, "%d changes detected", df->nchanges));
 	return df->nchanges;
 }
 
 #ifdef TEST_PROGRAM
+#include <sys/time.h>
 
-static int test_diff(struct libmnt_test *ts, int argc, char *argv[])
+static void print_changes(struct libmnt_tabdiff *diff, struct libmnt_iter *itr)
 {
-	struct libmnt_table *tb_old = NULL, *tb_new = NULL;
-	struct libmnt_tabdiff *diff = NULL;
-	struct libmnt_iter *itr;
 	struct libmnt_fs *old, *new;
-	int rc = -1, change;
-
-	tb_old = mnt_new_table_from_file(argv[1]);
-	tb_new = mnt_new_table_from_file(argv[2]);
-	diff = mnt_new_tabdiff();
-	itr = mnt_new_iter(MNT_ITER_FORWARD);
-
-	if (!tb_old || !tb_new || !diff || !itr) {
-		warnx("failed to allocate resources");
-		goto done;
-	}
-
-	rc = mnt_diff_tables(diff, tb_old, tb_new);
-	if (rc < 0)
-		goto done;
+	int change;
 
 	while(mnt_tabdiff_next_change(diff, itr, &old, &new, &change) == 0) {
 
@@ -349,6 +404,30 @@ static int test_diff(struct libmnt_test *ts, int argc, char *argv[])
 			printf("unknown change!\n");
 		}
 	}
+}
+
+static int test_diff(struct libmnt_test *ts, int argc, char *argv[])
+{
+	struct libmnt_table *tb_old = NULL, *tb_new = NULL;
+	struct libmnt_tabdiff *diff = NULL;
+	struct libmnt_iter *itr;
+	int rc = -1;
+
+	tb_old = mnt_new_table_from_file(argv[1]);
+	tb_new = mnt_new_table_from_file(argv[2]);
+	diff = mnt_new_tabdiff();
+	itr = mnt_new_iter(MNT_ITER_FORWARD);
+
+	if (!tb_old || !tb_new || !diff || !itr) {
+		warnx("failed to allocate resources");
+		goto done;
+	}
+
+	rc = mnt_diff_tables(diff, tb_old, tb_new);
+	if (rc < 0)
+		goto done;
+
+	print_changes(diff, itr);
 
 	rc = 0;
 done:
@@ -359,10 +438,186 @@ done:
 	return rc;
 }
 
+static int test_diff_bench(struct libmnt_test *ts, int argc, char *argv[])
+{
+	struct libmnt_table *tb_old = NULL, *tb_new = NULL;
+	struct libmnt_tabdiff *diff = NULL;
+	struct timeval start, end;
+	int rc = -1, i, loops = 100, nchanges = 0;
+	double usec;
+
+	if (argc < 3)
+		return -EINVAL;
+	if (argc > 3)
+		loops = atoi(argv[3]);
+	if (loops <= 0)
+		return -EINVAL;
+
+	tb_old = mnt_new_table_from_file(argv[1]);
+	tb_new = mnt_new_table_from_file(argv[2]);
+	diff = mnt_new_tabdiff();
+
+	if (!tb_old || !tb_new || !diff) {
+		warnx("failed to allocate resources");
+		goto done;
+	}
+
+	gettimeofday(&start, NULL);
+	for (i = 0; i < loops; i++) {
+		nchanges = mnt_diff_tables(diff, tb_old, tb_new);
+		if (nchanges < 0)
+			goto done;
+	}
+	gettimeofday(&end, NULL);
+
+	usec = (end.tv_sec - start.tv_sec) * 1000000.0
+		+ (end.tv_usec - start.tv_usec);
+
+	printf("%d/%d entries, %d changes, %d loops, %.1f usec per diff\n",
+			mnt_table_get_nents(tb_old),
+			mnt_table_get_nents(tb_new),
+			nchanges, loops, usec / loops);
+	rc = 0;
+done:
+	mnt_unref_table(tb_old);
+	mnt_unref_table(tb_new);
+	mnt_free_tabdiff(diff);
+	return rc;
+}
+
+static int streq_or_null(const char *a, const char *b)
+{
+	return a && b ? strcmp(a, b) == 0 : a == b;
+}
+
+/* compares @tb with the file content */
+static int check_table(struct libmnt_table *tb, const char *filename)
+{
+	struct libmnt_table *tb_file = mnt_new_table_from_file(filename);
+	struct libmnt_iter itr1, itr2;
+	struct libmnt_fs *a, *b;
+	int rc = -1;
+
+	if (!tb_file)
+		return -1;
+
+	mnt_reset_iter(&itr1, MNT_ITER_FORWARD);
+	mnt_reset_iter(&itr2, MNT_ITER_FORWARD);
+
+	while (mnt_table_next_fs(tb, &itr1, &a) == 0) {
+		if (mnt_table_next_fs(tb_file, &itr2, &b) != 0) {
+			warnx("%d: unexpected entry", mnt_fs_get_id(a));
+			goto done;
+		}
+		if (mnt_fs_get_id(a) != mnt_fs_get_id(b)
+		    || mnt_fs_get_parent_id(a) != mnt_fs_get_parent_id(b)
+		    || mnt_fs_get_devno(a) != mnt_fs_get_devno(b)
+		    || !streq_or_null(mnt_fs_get_root(a), mnt_fs_get_root(b))
+		    || !streq_or_null(mnt_fs_get_target(a), mnt_fs_get_target(b))
+		    || !streq_or_null(mnt_fs_get_source(a), mnt_fs_get_source(b))
+		    || !streq_or_null(mnt_fs_get_fstype(a), mnt_fs_get_fstype(b))
+		    || !streq_or_null(mnt_fs_get_options(a), mnt_fs_get_options(b))
+		    || !streq_or_null(mnt_fs_get_optional_fields(a),
+				      mnt_fs_get_optional_fields(b))) {
+			warnx("%d: entry does not match the file", mnt_fs_get_id(a));
+			goto done;
+		}
+	}
+	if (mnt_table_next_fs(tb_file, &itr2, &b) == 0) {
+		warnx("%d: missing entry", mnt_fs_get_id(b));
+		goto done;
+	}
+	if (mnt_table_get_nents(tb) != mnt_table_get_nents(tb_file)) {
+		warnx("wrong number of entries");
+		goto done;
+	}
+	rc = 0;
+done:
+	mnt_unref_table(tb_file);
+	return rc;
+}
+
+static int test_refresh(struct libmnt_test *ts, int argc, char *argv[])
+{
+	struct libmnt_table *tb = NULL;
+	struct libmnt_tabdiff *diff = NULL;
+	struct libmnt_iter *itr;
+	int rc = -1;
+
+	tb = mnt_new_table_from_file(argv[1]);
+	diff = mnt_new_tabdiff();
+	itr = mnt_new_iter(MNT_ITER_FORWARD);
+
+	if (!tb || !diff || !itr) {
+		warnx("failed to allocate resources");
+		goto done;
+	}
+
+	rc = mnt_table_refresh(tb, argv[2], diff);
+	if (rc < 0)
+		goto done;
+
+	print_changes(diff, itr);
+
+	rc = check_table(tb, argv[2]);
+done:
+	mnt_unref_table(tb);
+	mnt_free_tabdiff(diff);
+	mnt_free_iter(itr);
+	return rc;
+}
+
+static int test_refresh_bench(struct libmnt_test *ts, int argc, char *argv[])
+{
+	struct libmnt_table *tb = NULL;
+	struct libmnt_tabdiff *diff = NULL;
+	struct timeval start, end;
+	int rc = -1, i, loops = 100, nchanges = 0;
+	double usec;
+
+	if (argc < 3)
+		return -EINVAL;
+	if (argc > 3)
+		loops = atoi(argv[3]);
+	if (loops <= 0)
+		return -EINVAL;
+
+	tb = mnt_new_table_from_file(argv[1]);
+	diff = mnt_new_tabdiff();
+
+	if (!tb || !diff) {
+		warnx("failed to allocate resources");
+		goto done;
+	}
+
+	/* refresh the table from <new> and back to <old> */
+	gettimeofday(&start, NULL);
+	for (i = 0; i < loops; i++) {
+		nchanges = mnt_table_refresh(tb, argv[i % 2 ? 1 : 2], diff);
+		if (nchanges < 0)
+			goto done;
+	}
+	gettimeofday(&end, NULL);
+
+	usec = (end.tv_sec - start.tv_sec) * 1000000.0
+		+ (end.tv_usec - start.tv_usec);
+
+	printf("%d entries, %d changes, %d loops, %.1f usec per refresh\n",
+			mnt_table_get_nents(tb), nchanges, loops, usec / loops);
+	rc = check_table(tb, argv[loops % 2 ? 2 : 1]);
+done:
+	mnt_unref_table(tb);
+	mnt_free_tabdiff(diff);
+	return rc;
+}
+
 int main(int argc, char *argv[])
 {
 	struct libmnt_test tss[] = {
 		{ "--diff", test_diff, "<old> <new> prints change" },
+		{ "--diff-bench", test_diff_bench, "<old> <new> [<loops>] measure diff speed" },
+		{ "--refresh", test_refresh, "<old> <new> refresh <old> table from <new> file" },
+		{ "--refresh-bench", test_refresh_bench, "<old> <new> [<loops>] measure refresh speed" },
 		{ NULL }
 	};
 
@@ -0,0 +1,342 @@
+/*
+ * Copyright (C) 2016 Karel Zak <kzak@redhat.com>
+ *
+ * This file may be redistributed under the terms of the
+ * GNU Lesser General Public License.
+ */
+
+/*
+ * Hash indices for the table lookups. The indices are built on demand (the
+ * first lookup) and dropped when the table or any of the table entries is
+ * modified.
+ *
+ * All entries with the same key are linked by dup_next/dup_prev in the table
+ * order, only the first entry with the key is linked in the bucket. The
+ * dup_prev of the first entry points to the last entry, so the both
+ * directions of the lookup are O(1).
+ */
+#include "mountP.h"
+#include "strutils.h"
+
+/* don't waste time with small tables */
+#define MNT_INDEX_MINENTS	16
+
+struct mnt_idxnode {
+	struct libmnt_fs	*fs;
+	unsigned int		hash;
+
+	struct mnt_idxnode	*next;		/* next key in the bucket */
+	struct mnt_idxnode	*dup_next;	/* next entry with the same key */
+	struct mnt_idxnode	*dup_prev;	/* previous (or the last) entry */
+};
+
+struct mnt_index {
+	struct mnt_idxnode	**buckets;
+	size_t			nbuckets;	/* power of 2 */
+	struct mnt_idxnode	*nodes;		/* NULL if not built yet */
+};
+
+struct libmnt_tabindex {
+	struct mnt_index	indexes[MNT_NINDEXES];
+	int			ntags;		/* number of entries with TAG */
+};
+
+static unsigned int num_hash(uint64_t num)
+{
+	num ^= num >> 33;
+	num *= 0xff51afd7ed558ccdULL;
+	num ^= num >> 33;
+	return (unsigned int) num;
+}
+
+static const char *loopdev_srcpath(struct libmnt_fs *fs)
+{
+	const char *p = mnt_fs_get_srcpath(fs);
+
+	return p && startswith(p, "/dev/loop") ? p : NULL;
+}
+
+/*
+ * Returns 0 and the hash of the @fs key, or 1 if @fs is not indexed.
+ */
+static int fs_key_hash(int type, struct libmnt_fs *fs, unsigned int *hash)
+{
+	const char *p;
+
+	switch (type) {
+	case MNT_INDEX_TARGET:
+		p = mnt_fs_get_target(fs);
+		if (!p)
+			return 1;
+		*hash = mnt_hash_path(p);
+		break;
+	case MNT_INDEX_SRCPATH:
+		p = mnt_fs_get_srcpath(fs);
+		if (!p)
+			return 1;
+		*hash = mnt_hash_path(p);
+		break;
+	case MNT_INDEX_DEVNO:
+		*hash = num_hash(mnt_fs_get_devno(fs));
+		break;
+	case MNT_INDEX_ID:
+		*hash = num_hash(mnt_fs_get_id(fs));
+		break;
+	case MNT_INDEX_LOOPDEV:
+		if (!loopdev_srcpath(fs))
+			return 1;
+		*hash = 0;
+		break;
+	default:
+		return 1;
+	}
+	return 0;
+}
+
+static unsigned int key_hash(int type, const void *key)
+{
+	switch (type) {
+	case MNT_INDEX_TARGET:
+	case MNT_INDEX_SRCPATH:
+		return mnt_hash_path((const char *) key);
+	case MNT_INDEX_DEVNO:
+		return num_hash(*((const dev_t *) key));
+	case MNT_INDEX_ID:
+		return num_hash(*((const int *) key));
+	}
+	return 0;
+}
+
+/*
+ * Returns 1 if the @fs key is @key. Note that the callers have to compare the
+ * entries returned by the index, for example mnt_fs_streq_srcpath() is more
+ * strict for pseudo filesystems.
+ */
+static int fs_key_equal(int type, struct libmnt_fs *fs, const void *key)
+{
+	switch (type) {
+	case MNT_INDEX_TARGET:
+		return streq_paths(mnt_fs_get_target(fs), (const char *) key);
+	case MNT_INDEX_SRCPATH:
+		return streq_paths(mnt_fs_get_srcpath(fs), (const char *) key);
+	case MNT_INDEX_DEVNO:
+		return mnt_fs_get_devno(fs) == *((const dev_t *) key);
+	case MNT_INDEX_ID:
+		return mnt_fs_get_id(fs) == *((const int *) key);
+	case MNT_INDEX_LOOPDEV:
+		return 1;
+	}
+	return 0;
+}
+
+/* returns key of the @fs in format usable for fs_key_equal() */
+static const void *fs_key(int type, struct libmnt_fs *fs)
+{
+	switch (type) {
+	case MNT_INDEX_TARGET:
+		return mnt_fs_get_target(fs);
+	case MNT_INDEX_SRCPATH:
+		return mnt_fs_get_srcpath(fs);
+	case MNT_INDEX_DEVNO:
+		return &fs->devno;
+	case MNT_INDEX_ID:
+		return &fs->id;
+	}
+	return NULL;
+}
+
+static struct mnt_idxnode *index_lookup(struct mnt_index *idx, int type,
+					unsigned int hash, const void *key)
+{
+	struct mnt_idxnode *nd = idx->buckets[hash & (idx->nbuckets - 1)];
+
+	for (; nd; nd = nd->next) {
+		if (nd->hash == hash && fs_key_equal(type, nd->fs, key))
+			return nd;
+	}
+	return NULL;
+}
+
+static int index_build(struct libmnt_table *tb, int type)
+{
+	struct mnt_index *idx = &tb->idx->indexes[type];
+	struct libmnt_iter itr;
+	struct libmnt_fs *fs;
+	size_t n = 0, sz = 16;
+
+	while (sz < (size_t) tb->nents)
+		sz <<= 1;
+
+	idx->buckets = calloc(sz, sizeof(struct mnt_idxnode *));
+	idx->nodes = calloc(tb->nents, sizeof(struct mnt_idxnode));
+	if (!idx->buckets || !idx->nodes) {
+		free(idx->buckets);
+		free(idx->nodes);
+		memset(idx, 0, sizeof(*idx));
+		return -ENOMEM;
+	}
+	idx->nbuckets = sz;
+
+	if (type == MNT_INDEX_SRCPATH)
+		tb->idx->ntags = 0;
+
+	mnt_reset_iter(&itr, MNT_ITER_FORWARD);
+	while (mnt_table_next_fs(tb, &itr, &fs) == 0) {
+		struct mnt_idxnode *nd, *first;
+		unsigned int hash;
+
+		if (type == MNT_INDEX_SRCPATH && mnt_fs_get_tag(fs, NULL, NULL) == 0)
+			tb->idx->ntags++;
+		if (fs_key_hash(type, fs, &hash) != 0)
+			continue;
+
+		nd = &idx->nodes[n++];
+		nd->fs = fs;
+		nd->hash = hash;
+
+		first = type == MNT_INDEX_LOOPDEV ?
+				idx->buckets[0] :
+				index_lookup(idx, type, hash, fs_key(type, fs));
+		if (first) {
+			/* append to the entries with the same key */
+			first->dup_prev->dup_next = nd;
+			nd->dup_prev = first->dup_prev;
+			first->dup_prev = nd;
+		} else {
+			struct mnt_idxnode **bk = &idx->buckets[hash & (sz - 1)];
+
+			nd->dup_prev = nd;
+			nd->next = *bk;
+			*bk = nd;
+		}
+	}
+
+	DBG(TAB, ul_debugobj(tb, "index %d built [entries=%zu, buckets=%zu]", type, n, sz));
+	return 0;
+}
+
+/**
+ * mnt_table_enable_index:
+ * @tb: pointer to tab
+ * @enable: TRUE or FALSE
+ *
+ * Enables hash indices for mnt_table_find_target(), mnt_table_find_srcpath(),
+ * mnt_table_find_devno(), mnt_table_find_id(), mnt_table_find_pair() and
+ * mnt_table_is_fs_mounted(). The indices are built on the first lookup and
+ * dropped when the table or an entry in the table is modified. The lookup
+ * results are the same as without the indices.
+ *
+ * It's a good idea for large tables with many lookups, for example
+ * mountinfo used for all fstab entries.
+ *
+ * Returns: 0 on success or negative number in case of error.
+ *
+ * Since: 2.29
+ */
+int mnt_table_enable_index(struct libmnt_table *tb, int enable)
+{
+	if (!tb)
+		return -EINVAL;
+
+	DBG(TAB, ul_debugobj(tb, "index: %s", enable ? "ENABLED" : "DISABLED"));
+	tb->idx_enabled = enable ? 1 : 0;
+	if (!enable)
+		__mnt_table_reset_index(tb);
+	return 0;
+}
+
+void __mnt_table_reset_index(struct libmnt_table *tb)
+{
+	size_t i;
+
+	if (!tb || !tb->idx)
+		return;
+
+	for (i = 0; i < MNT_NINDEXES; i++) {
+		free(tb->idx->indexes[i].buckets);
+		free(tb->idx->indexes[i].nodes);
+	}
+	free(tb->idx);
+	tb->idx = NULL;
+}
+
+static struct mnt_index *get_index(struct libmnt_table *tb, int type)
+{
+	struct mnt_index *idx;
+
+	if (!tb->idx_enabled || tb->nents < MNT_INDEX_MINENTS)
+		return NULL;
+	if (!tb->idx) {
+		tb->idx = calloc(1, sizeof(struct libmnt_tabindex));
+		if (!tb->idx)
+			return NULL;
+	}
+
+	idx = &tb->idx->indexes[type];
+	if (!idx->nodes && index_build(tb, type) != 0)
+		return NULL;
+	return idx;
+}
+
+/*
+ * Initializes @ix to iterate over entries with @key in the table order
+ * (according to @direction). The @key is a path for MNT_INDEX_{TARGET,SRCPATH},
+ * dev_t for MNT_INDEX_DEVNO, int for MNT_INDEX_ID and ignored for
+ * MNT_INDEX_LOOPDEV.
+ *
+ * Returns: 0 on success, 1 if the index is not available (the caller has to
+ * use the table).
+ */
+int __mnt_table_index_iter(struct libmnt_table *tb, int type, const void *key,
+			   int direction, struct libmnt_idxiter *ix)
+{
+	struct mnt_index *idx;
+
+	assert(tb);
+	assert(ix);
+
+	memset(ix, 0, sizeof(*ix));
+
+	idx = get_index(tb, type);
+	if (!idx)
+		return 1;
+
+	ix->direction = direction;
+	if (type == MNT_INDEX_LOOPDEV)
+		ix->first = idx->buckets[0];
+	else if (key)
+		ix->first = index_lookup(idx, type, key_hash(type, key), key);
+
+	if (ix->first)
+		ix->node = direction == MNT_ITER_FORWARD ?
+				ix->first : ix->first->dup_prev;
+	return 0;
+}
+
+/*
+ * Returns: 0 on success, 1 at the end of the list.
+ */
+int __mnt_idxiter_next(struct libmnt_idxiter *ix, struct libmnt_fs **fs)
+{
+	struct mnt_idxnode *nd = ix->node;
+
+	if (!nd)
+		return 1;
+
+	if (ix->direction == MNT_ITER_FORWARD)
+		ix->node = nd->dup_next;
+	else
+		ix->node = nd == ix->first ? NULL : nd->dup_prev;
+
+	*fs = nd->fs;
+	return 0;
+}
+
+/*
+ * Returns number of entries with TAG (LABEL=, UUID=, ...) or -1 if the index
+ * is not available.
+ */
+int __mnt_table_index_ntags(struct libmnt_table *tb)
+{
+	return get_index(tb, MNT_INDEX_SRCPATH) ? tb->idx->ntags : -1;
+}
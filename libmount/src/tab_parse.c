@@ -23,22 +23,211 @@
 #include "pathnames.h"
 #include "strutils.h"
 
+/*
+ * The parser reads lines from the stream @f, or from the file content in the
+ * first chunk of @arena (see mnt_table_parse_file()). In the second case @buf
+ * points to the current line in the arena and the mountinfo entries use the
+ * file content for their strings.
+ */
 struct libmnt_parser {
 	FILE	*f;		/* fstab, mtab, swaps or mountinfo ... */
 	const char *filename;	/* file name or NULL */
 	char	*buf;		/* buffer (the current line content) */
 	size_t	bufsiz;		/* size of the buffer */
 	size_t	line;		/* current line */
+
+	struct libmnt_strarena *arena;	/* file content or NULL */
+	size_t	pos;		/* the next line offset in the file content */
+	int	eof;		/* end of the file content */
 };
 
+#define STRARENA_CHUNKSZ	(16 * 1024)
+
+static struct libmnt_strarena *new_strarena(void)
+{
+	struct libmnt_strarena *ar = calloc(1, sizeof(*ar));
+
+	if (!ar)
+		return NULL;
+	ar->refcount = 1;
+	ar->chunksz = STRARENA_CHUNKSZ;
+	return ar;
+}
+
+void mnt_ref_strarena(struct libmnt_strarena *ar)
+{
+	if (ar)
+		ar->refcount++;
+}
+
+void mnt_unref_strarena(struct libmnt_strarena *ar)
+{
+	if (!ar || --ar->refcount > 0)
+		return;
+
+	while (ar->chunks) {
+		struct libmnt_strchunk *ch = ar->chunks;
+
+		ar->chunks = ch->next;
+		free(ch->data);
+		free(ch);
+	}
+	free(ar);
+}
+
+/*
+ * Adds @data to the arena, the first chunk is always the file content.
+ */
+static struct libmnt_strchunk *strarena_add_chunk(struct libmnt_strarena *ar,
+						  char *data, size_t size)
+{
+	struct libmnt_strchunk *ch = calloc(1, sizeof(*ch));
+
+	if (!ch)
+		return NULL;
+	ch->data = data;
+	ch->size = size;
+
+	if (ar->chunks) {
+		/* keep the file content at the begin of the list */
+		ch->next = ar->chunks->next;
+		ar->chunks->next = ch;
+	} else
+		ar->chunks = ch;
+	return ch;
+}
+
+static char *strarena_alloc(struct libmnt_strarena *ar, size_t sz)
+{
+	struct libmnt_strchunk *ch = ar->chunks ? ar->chunks->next : NULL;
+	char *res;
+
+	if (!ch || ch->size - ch->used < sz) {
+		size_t chsz = max(sz, ar->chunksz);
+		char *data = malloc(chsz);
+
+		if (!data)
+			return NULL;
+		ch = strarena_add_chunk(ar, data, chsz);
+		if (!ch) {
+			free(data);
+			return NULL;
+		}
+		/* the chunks are larger and larger for large files */
+		ar->chunksz *= 2;
+	}
+
+	res = ch->data + ch->used;
+	ch->used += sz;
+	return res;
+}
+
+/*
+ * Reads the whole file to the first chunk of a new arena, the content is
+ * terminated by zero.
+ *
+ * Returns: 0 on success or negative errno.
+ */
+static int read_to_strarena(int fd, struct libmnt_strarena **res)
+{
+	struct libmnt_strarena *ar;
+	size_t sz = 0, bufsz = 64 * 1024;
+	char *buf = NULL;
+	int rc = -ENOMEM;
+
+	*res = NULL;
+
+	do {
+		ssize_t ret;
+
+		if (bufsz - sz < 2) {
+			char *x;
+
+			bufsz *= 2;
+			x = realloc(buf, bufsz);
+			if (!x)
+				goto err;
+			buf = x;
+		} else if (!buf) {
+			buf = malloc(bufsz);
+			if (!buf)
+				goto err;
+		}
+
+		ret = read(fd, buf + sz, bufsz - sz - 1);
+		if (ret < 0) {
+			if (errno == EINTR || errno == EAGAIN)
+				continue;
+			rc = -errno;
+			goto err;
+		}
+		if (ret == 0)
+			break;
+		sz += ret;
+	} while (1);
+
+	buf[sz] = '\0';
+
+	ar = new_strarena();
+	if (!ar)
+		goto err;
+	if (!strarena_add_chunk(ar, buf, sz + 1)) {
+		mnt_unref_strarena(ar);
+		goto err;
+	}
+	ar->chunks->used = sz + 1;
+	*res = ar;
+	return 0;
+err:
+	free(buf);
+	return rc;
+}
+
 static void parser_cleanup(struct libmnt_parser *pa)
 {
 	if (!pa)
 		return;
-	free(pa->buf);
+	if (pa->arena)
+		mnt_unref_strarena(pa->arena);
+	else
+		free(pa->buf);
 	memset(pa, 0, sizeof(*pa));
 }
 
+static int parser_eof(struct libmnt_parser *pa)
+{
+	return pa->arena ? pa->eof : feof(pa->f);
+}
+
+/*
+ * Reads the next line to pa->buf, the line is terminated by '\n' unless it's
+ * the last line in the file.
+ */
+static int parser_getline(struct libmnt_parser *pa)
+{
+	struct libmnt_strchunk *ch;
+	char *nl;
+
+	if (!pa->arena)
+		return getline(&pa->buf, &pa->bufsiz, pa->f) < 0 ? -1 : 0;
+
+	ch = pa->arena->chunks;
+	if (pa->pos + 1 >= ch->used) {
+		pa->eof = 1;
+		return -1;
+	}
+
+	pa->buf = ch->data + pa->pos;
+	nl = memchr(pa->buf, '\n', ch->used - 1 - pa->pos);
+	if (nl)
+		pa->pos = nl - ch->data + 1;
+	else {
+		pa->pos = ch->used - 1;
+		pa->eof = 1;
+	}
+	return 0;
+}
+
 static int next_number(char **s, int *num)
 {
 	char *end = NULL;
@@ -136,99 +325,211 @@ static int mnt_parse_table_line(struct libmnt_fs *fs, char *s)
 }
 
 /*
- * Parses one line from a mountinfo file
+ * Returns the next blank separated field from @s, the field is terminated in
+ * place and @s points after the field.
  */
-static int mnt_parse_mountinfo_line(struct libmnt_fs *fs, char *s)
+static char *next_field(char **s)
 {
-	int rc, end = 0;
-	unsigned int maj, min;
-	char *fstype = NULL, *src = NULL, *p;
-
-	rc = sscanf(s,	"%d "		/* (1) id */
-			"%d "		/* (2) parent */
-			"%u:%u "	/* (3) maj:min */
-			UL_SCNsA" "	/* (4) mountroot */
-			UL_SCNsA" "	/* (5) target */
-			UL_SCNsA	/* (6) vfs options (fs-independent) */
-			"%n",		/* number of read bytes */
-
-			&fs->id,
-			&fs->parent,
-			&maj, &min,
-			&fs->root,
-			&fs->target,
-			&fs->vfs_optstr,
-			&end);
+	char *p = (char *) skip_blank(*s), *begin = p;
 
-	if (rc >= 7 && end > 0)
-		s += end;
+	if (!*p)
+		return NULL;
+	while (*p && *p != ' ' && *p != '\t')
+		p++;
+	if (*p)
+		*p++ = '\0';
+	*s = p;
+	return begin;
+}
 
-	/* (7) optional fields, terminated by " - " */
-	p = strstr(s, " - ");
-	if (!p) {
-		DBG(TAB, ul_debug("mountinfo parse error: separator not found"));
-		return -EINVAL;
-	}
-	if (p > s + 1)
-		fs->opt_fields = strndup(s + 1, p - s - 1);
-	s = p + 3;
+static int next_devno(char **s, dev_t *devno)
+{
+	unsigned long maj, min;
+	char *end = NULL;
 
-	rc += sscanf(s,	UL_SCNsA" "	/* (8) FS type */
-			UL_SCNsA" "	/* (9) source */
-			UL_SCNsA,	/* (10) fs options (fs specific) */
+	*s = (char *) skip_blank(*s);
 
-			&fstype,
-			&src,
-			&fs->fs_optstr);
+	maj = strtoul(*s, &end, 10);
+	if (end == *s || *end != ':')
+		return -1;
+	*s = end + 1;
 
-	if (rc >= 10) {
-		size_t sz;
+	min = strtoul(*s, &end, 10);
+	if (end == *s || (*end != ' ' && *end != '\t'))
+		return -1;
+	*s = end;
 
-		fs->flags |= MNT_FS_KERNEL;
-		fs->devno = makedev(maj, min);
+	*devno = makedev(maj, min);
+	return 0;
+}
 
-		/* remove "(deleted)" suffix */
-		sz = strlen(fs->target);
-		if (sz > PATH_DELETED_SUFFIX_SZ) {
-			char *ptr = fs->target + (sz - PATH_DELETED_SUFFIX_SZ);
+/* strdup() for mountinfo fields, NULL is not an error */
+static int dup_field(char **dest, const char *src)
+{
+	if (!src)
+		return 0;
+	*dest = strdup(src);
+	return *dest ? 0 : -ENOMEM;
+}
+
+/*
+ * Parses one line from a mountinfo file. The line is split and unmangled in
+ * place. If @arena is not NULL, then the line is in the arena and the fields
+ * point to the line, otherwise the fields are copied.
+ */
+static int mnt_parse_mountinfo_line(struct libmnt_fs *fs, char *s,
+				    struct libmnt_strarena *arena)
+{
+	char *root, *target, *vfs_optstr, *opt_fields = NULL;
+	char *fstype, *src, *fs_optstr, *optstr, *p;
+	dev_t devno;
+	size_t sz;
+	int rc;
+
+	if (next_number(&s, &fs->id) != 0 ||		/* (1) id */
+	    next_number(&s, &fs->parent) != 0 ||	/* (2) parent */
+	    next_devno(&s, &devno) != 0)		/* (3) maj:min */
+		goto err;
 
-			if (strcmp(ptr, PATH_DELETED_SUFFIX) == 0)
-				*ptr = '\0';
+	root = next_field(&s);				/* (4) mountroot */
+	target = next_field(&s);			/* (5) target */
+	vfs_optstr = next_field(&s);			/* (6) vfs options */
+	if (!root || !target || !vfs_optstr)
+		goto err;
+
+	/* (7) optional fields, terminated by " - " */
+	s = (char *) skip_blank(s);
+	if (*s == '-' && (s[1] == ' ' || s[1] == '\t'))
+		s++;
+	else {
+		p = strstr(s, " - ");
+		if (!p) {
+			DBG(TAB, ul_debug("mountinfo parse error: separator not found"));
+			return -EINVAL;
 		}
+		*p = '\0';
+		if (*s)
+			opt_fields = s;
+		s = p + 3;
+	}
 
-		unmangle_string(fs->root);
-		unmangle_string(fs->target);
-		unmangle_string(fs->vfs_optstr);
-		unmangle_string(fstype);
-		unmangle_string(src);
-		unmangle_string(fs->fs_optstr);
+	fstype = next_field(&s);			/* (8) FS type */
+	src = next_field(&s);				/* (9) source */
+	fs_optstr = next_field(&s);			/* (10) fs options */
+	if (!fstype || !src || !fs_optstr)
+		goto err;
+
+	/* remove "(deleted)" suffix */
+	sz = strlen(target);
+	if (sz > PATH_DELETED_SUFFIX_SZ) {
+		p = target + (sz - PATH_DELETED_SUFFIX_SZ);
+		if (strcmp(p, PATH_DELETED_SUFFIX) == 0)
+			*p = '\0';
+	}
 
+	unmangle_string(root);
+	unmangle_string(target);
+	unmangle_string(vfs_optstr);
+	unmangle_string(fstype);
+	unmangle_string(src);
+	unmangle_string(fs_optstr);
+
+	fs->flags |= MNT_FS_KERNEL;
+	fs->devno = devno;
+
+	if (!arena) {
+		if (dup_field(&fs->root, root) ||
+		    dup_field(&fs->target, target) ||
+		    dup_field(&fs->vfs_optstr, vfs_optstr) ||
+		    dup_field(&fs->opt_fields, opt_fields) ||
+		    dup_field(&fs->fs_optstr, fs_optstr))
+			return -ENOMEM;
+
+		/* note that __foo functions do not reallocate the string */
+		if (dup_field(&fstype, fstype))
+			return -ENOMEM;
 		rc = __mnt_fs_set_fstype_ptr(fs, fstype);
-		if (!rc) {
-			fstype = NULL;
-			rc = __mnt_fs_set_source_ptr(fs, src);
-			if (!rc)
-				src = NULL;
+		if (rc) {
+			free(fstype);
+			return rc;
+		}
+
+		if (dup_field(&src, src))
+			return -ENOMEM;
+		rc = __mnt_fs_set_source_ptr(fs, src);
+		if (rc) {
+			free(src);
+			return rc;
 		}
 
 		/* merge VFS and FS options to one string */
 		fs->optstr = mnt_fs_strdup_options(fs);
-		if (!fs->optstr)
-			rc = -ENOMEM;
-	} else {
-		free(fstype);
-		free(src);
-		DBG(TAB, ul_debug(
-			"mountinfo parse error [sscanf rc=%d]: '%s'", rc, s));
-		rc = -EINVAL;
+		return fs->optstr ? 0 : -ENOMEM;
 	}
-	return rc;
+
+	/* merge VFS and FS options to one string */
+	if (strcmp(vfs_optstr, fs_optstr) == 0)
+		optstr = vfs_optstr;
+	else {
+		sz = strlen(vfs_optstr) + strlen(fs_optstr) + 5;
+		optstr = strarena_alloc(arena, sz);
+		if (!optstr)
+			return -ENOMEM;
+		__mnt_merge_optstr_to_buffer(vfs_optstr, fs_optstr, optstr, sz);
+	}
+
+	/* fs->strarena is not set yet, so the strings are not copied */
+	rc = __mnt_fs_set_fstype_ptr(fs, fstype);
+	if (!rc)
+		rc = __mnt_fs_set_source_ptr(fs, src);
+	if (rc) {
+		/* don't deallocate the arena strings by mnt_free_fs() */
+		if (fs->fstype == fstype)
+			fs->fstype = NULL;
+		if (fs->source == src)
+			fs->source = NULL;
+		return rc;
+	}
+
+	mnt_ref_strarena(arena);
+	fs->strarena = arena;
+	fs->root = root;
+	fs->target = target;
+	fs->vfs_optstr = vfs_optstr;
+	fs->opt_fields = opt_fields;
+	fs->fs_optstr = fs_optstr;
+	fs->optstr = optstr;
+	return 0;
+err:
+	DBG(TAB, ul_debug("mountinfo parse error: '%s'", s));
+	return -EINVAL;
+}
+
+/*
+ * Returns hash of the mountinfo line, it's used to detect unchanged lines
+ * without parsing, see mnt_table_refresh(). The line is hashed by 8 bytes, it
+ * has to be fast, it's calculated for all mountinfo lines.
+ */
+static uint64_t mountinfo_line_hash(const char *s)
+{
+	size_t len = strlen(s);
+	uint64_t h = len, w;
+
+	for (; len >= sizeof(w); s += sizeof(w), len -= sizeof(w)) {
+		memcpy(&w, s, sizeof(w));
+		h = (h ^ w) * 0x9e3779b97f4a7c15ULL;
+		h ^= h >> 29;
+	}
+	w = 0;
+	memcpy(&w, s, len);
+	h = (h ^ w) * 0x9e3779b97f4a7c15ULL;
+	return h ^ (h >> 32);
 }
 
 /*
  * Parses one line from utab file
  */
-static int mnt_parse_utab_line(struct libmnt_fs *fs, const char *s)
+static int mnt_parse_utab_line(struct libmnt_fs *fs, const char *s, int *action)
 {
 	const char *p = s;
 
@@ -237,6 +538,8 @@ static int mnt_parse_utab_line(struct libmnt_fs *fs, const char *s)
 	assert(!fs->source);
 	assert(!fs->target);
 
+	*action = MNT_UTAB_ACT_NONE;
+
 	while (p && *p) {
 		char *end = NULL;
 
@@ -244,7 +547,19 @@ static int mnt_parse_utab_line(struct libmnt_fs *fs, const char *s)
 		if (!*p)
 			break;
 
-		if (!fs->source && !strncmp(p, "SRC=", 4)) {
+		if (!strncmp(p, "ACTION=", 7)) {
+			p += 7;
+			if (!strncmp(p, "umount", 6) && (p[6] == ' ' || !p[6]))
+				*action = MNT_UTAB_ACT_UMOUNT;
+			else if (!strncmp(p, "move", 4) && (p[4] == ' ' || !p[4]))
+				*action = MNT_UTAB_ACT_MOVE;
+			else if (!strncmp(p, "remount", 7) && (p[7] == ' ' || !p[7]))
+				*action = MNT_UTAB_ACT_REMOUNT;
+			else
+				return -EINVAL;
+			while (*p && *p != ' ') p++;
+
+		} else if (!fs->source && !strncmp(p, "SRC=", 4)) {
 			char *v = unmangle(p + 4, &end);
 			if (!v)
 				goto enomem;
@@ -289,6 +604,66 @@ enomem:
 	return -ENOMEM;
 }
 
+static struct libmnt_fs *utab_find_target(struct libmnt_table *tb,
+					   const char *target)
+{
+	struct libmnt_iter itr;
+	struct libmnt_fs *fs;
+
+	mnt_reset_iter(&itr, MNT_ITER_BACKWARD);
+	while (mnt_table_next_fs(tb, &itr, &fs) == 0) {
+		if (fs->target && strcmp(fs->target, target) == 0)
+			return fs;
+	}
+	return NULL;
+}
+
+/*
+ * Applies utab change record (see LIBMOUNT_UTAB_APPEND in tab_update.c) to
+ * the already parsed entries. The records follow the rules of the utab
+ * rewrite in tab_update.c.
+ *
+ * Returns: 0 if @fs should be added to the table, 1 if the record has been
+ * applied, <0 on error.
+ */
+static int utab_apply_record(struct libmnt_table *tb, struct libmnt_fs *fs,
+			     int action)
+{
+	struct libmnt_fs *cur;
+	int rc = 0;
+
+	switch (action) {
+	case MNT_UTAB_ACT_UMOUNT:
+		if (!fs->target)
+			return -EINVAL;
+		cur = utab_find_target(tb, fs->target);
+		if (cur)
+			mnt_table_remove_fs(tb, cur);
+		break;
+	case MNT_UTAB_ACT_MOVE:
+		if (!fs->source || !fs->target)
+			return -EINVAL;
+		cur = utab_find_target(tb, fs->source);
+		if (cur)
+			rc = mnt_fs_set_target(cur, fs->target);
+		break;
+	case MNT_UTAB_ACT_REMOUNT:
+		if (!fs->target)
+			return -EINVAL;
+		cur = utab_find_target(tb, fs->target);
+		if (!cur)
+			return 0;	/* not found, add new */
+		rc = mnt_fs_set_attributes(cur, fs->attrs);
+		if (!rc)
+			rc = mnt_fs_set_options(cur, fs->user_optstr);
+		break;
+	default:
+		return 0;
+	}
+
+	return rc ? rc : 1;
+}
+
 /*
  * Parses one line from /proc/swaps
  */
@@ -397,8 +772,8 @@ static int is_terminated_by_blank(const char *str)
  */
 static int next_comment_line(struct libmnt_parser *pa, char **last)
 {
-	if (getline(&pa->buf, &pa->bufsiz, pa->f) < 0)
-		return feof(pa->f) ? 1 : -errno;
+	if (parser_getline(pa) < 0)
+		return parser_eof(pa) ? 1 : -errno;
 
 	pa->line++;
 	*last = strchr(pa->buf, '\n');
@@ -433,6 +808,148 @@ static int append_comment(struct libmnt_table *tb,
 	return rc;
 }
 
+/*
+ * Returns the next field from the raw line and its size, the line is not
+ * modified.
+ */
+static const char *raw_next_field(const char **s, size_t *sz)
+{
+	const char *p = skip_blank(*s), *end = p;
+
+	while (*end && !isblank((unsigned char) *end))
+		end++;
+	if (end == p)
+		return NULL;
+	*sz = end - p;
+	*s = end;
+	return p;
+}
+
+/*
+ * Returns 1 if the raw (mangled) path @fld matches the prefilter path, for
+ * @parents the parent directories of the path match too.
+ */
+static int prefilter_match_path(struct libmnt_prefilter *pf,
+				const char *fld, size_t sz, int parents)
+{
+	char buf[PATH_MAX];
+
+	/* "(deleted)" suffix */
+	if (sz > PATH_DELETED_SUFFIX_SZ
+	    && memcmp(fld + sz - PATH_DELETED_SUFFIX_SZ, PATH_DELETED_SUFFIX,
+		      PATH_DELETED_SUFFIX_SZ) == 0)
+		sz -= PATH_DELETED_SUFFIX_SZ;
+
+	if (memchr(fld, '\\', sz)) {
+		if (sz >= sizeof(buf))
+			return 1;	/* unknown, let's parse it */
+		memcpy(buf, fld, sz);
+		buf[sz] = '\0';
+		unmangle_string(buf);
+		sz = strlen(buf);
+		fld = buf;
+	}
+
+	/* ignore trailing slashes */
+	while (sz > 1 && fld[sz - 1] == '/')
+		sz--;
+
+	if (sz > pf->pathsz || memcmp(fld, pf->path, sz) != 0)
+		return 0;
+	if (sz == pf->pathsz)
+		return 1;
+	return parents && (sz == 1 || pf->path[sz] == '/');
+}
+
+static int prefilter_match_fstype(struct libmnt_prefilter *pf,
+				  const char *fld, size_t sz)
+{
+	char buf[64];
+
+	if (sz >= sizeof(buf))
+		return 1;	/* unknown, let's parse it */
+	memcpy(buf, fld, sz);
+	buf[sz] = '\0';
+	if (memchr(buf, '\\', sz))
+		unmangle_string(buf);
+
+	return mnt_match_fstype(buf, pf->fstypes);
+}
+
+/*
+ * Returns 0 if the raw line @s does not match the parser prefilter. The line
+ * is not parsed and nothing is allocated, so it has to be fast. The broken
+ * lines match, the parser reports the errors.
+ */
+static int prefilter_match_line(struct libmnt_table *tb, const char *s)
+{
+	struct libmnt_prefilter *pf = &tb->prefltr;
+	const char *src, *tgt, *type;
+	size_t srcsz = 0, tgtsz = 0, typesz = 0, sz;
+
+	switch (tb->fmt) {
+	case MNT_FMT_MOUNTINFO:
+		/* (1) id, (2) parent */
+		if (!raw_next_field(&s, &sz) || !raw_next_field(&s, &sz))
+			return 1;
+		if (pf->devno) {
+			/* (3) maj:min */
+			char *end = NULL;
+			unsigned int maj, min;
+
+			maj = strtoul(s, &end, 10);
+			if (!end || *end != ':')
+				return 1;
+			min = strtoul(end + 1, NULL, 10);
+			if (makedev(maj, min) != pf->devno)
+				return 0;
+		}
+		/* (3) maj:min, (4) root, (5) target */
+		if (!raw_next_field(&s, &sz) || !raw_next_field(&s, &sz))
+			return 1;
+		tgt = raw_next_field(&s, &tgtsz);
+		s = tgt ? strstr(s, " - ") : NULL;
+		if (!s)
+			return 1;
+		s += 3;
+		/* (8) fstype, (9) source */
+		type = raw_next_field(&s, &typesz);
+		src = raw_next_field(&s, &srcsz);
+		break;
+	case MNT_FMT_FSTAB:
+		src = raw_next_field(&s, &srcsz);
+		tgt = raw_next_field(&s, &tgtsz);
+		type = raw_next_field(&s, &typesz);
+		break;
+	default:
+		return 1;
+	}
+	if (!src || !tgt || !type)
+		return 1;
+
+	if (pf->fstypes && !prefilter_match_fstype(pf, type, typesz))
+		return 0;
+	if (!pf->path)
+		return 1;
+
+	if ((pf->flags & (MNT_PREFILTER_TARGET | MNT_PREFILTER_MOUNTPOINT))
+	    && prefilter_match_path(pf, tgt, tgtsz,
+				    pf->flags & MNT_PREFILTER_MOUNTPOINT))
+		return 1;
+	if ((pf->flags & MNT_PREFILTER_SOURCE)
+	    && (prefilter_match_path(pf, src, srcsz, 0)
+		/* converted by kernel_fs_postparse() */
+		|| (srcsz == 9 && memcmp(src, "/dev/root", 9) == 0)))
+		return 1;
+	return 0;
+}
+
+static inline int prefilter_enabled(struct libmnt_table *tb)
+{
+	return !tb->comms &&
+	       (tb->prefltr.path || tb->prefltr.fstypes || tb->prefltr.devno);
+}
+
 /*
  * Read and parse the next line from {fs,m}tab or mountinfo
  */
@@ -450,14 +967,20 @@ static int mnt_table_parse_next(struct libmnt_parser *pa,
 	/* read the next non-blank non-comment line */
 next_line:
 	do {
-		if (getline(&pa->buf, &pa->bufsiz, pa->f) < 0)
+		if (parser_getline(pa) < 0)
 			return -EINVAL;
 		pa->line++;
 		s = strchr(pa->buf, '\n');
 		if (!s) {
 			/* Missing final newline?  Otherwise an extremely */
 			/* long line - assume file was corrupted */
-			if (feof(pa->f)) {
+			if (parser_eof(pa) && tb->fmt == MNT_FMT_UTAB) {
+				/* unfinished append, see tab_update.c */
+				DBG(TAB, ul_debugobj(tb,
+					"%s: ignore incomplete utab line", pa->filename));
+				return -EINVAL;
+			}
+			if (parser_eof(pa)) {
 				DBG(TAB, ul_debugobj(tb,
 					"%s: no final newline",	pa->filename));
 				s = strchr(pa->buf, '\0');
@@ -474,12 +997,12 @@ next_line:
 		    && (tb->fmt == MNT_FMT_GUESS || tb->fmt == MNT_FMT_FSTAB)
 		    && is_comment_line(pa->buf)) {
 			do {
-				rc = append_comment(tb, fs, pa->buf, feof(pa->f));
+				rc = append_comment(tb, fs, pa->buf, parser_eof(pa));
 				if (!rc)
 					rc = next_comment_line(pa, &s);
 			} while (rc == 0);
 
-			if (rc == 1 && feof(pa->f))
+			if (rc == 1 && parser_eof(pa))
 				rc = append_comment(tb, fs, NULL, 1);
 			if (rc < 0)
 				return rc;
@@ -498,16 +1021,31 @@ next_line:
 			goto next_line;			/* skip swap header */
 	}
 
+	if (prefilter_enabled(tb) && !prefilter_match_line(tb, s))
+		goto next_line;
+
 	switch (tb->fmt) {
 	case MNT_FMT_FSTAB:
 		rc = mnt_parse_table_line(fs, s);
 		break;
 	case MNT_FMT_MOUNTINFO:
-		rc = mnt_parse_mountinfo_line(fs, s);
+		fs->linehash = mountinfo_line_hash(s);
+		rc = mnt_parse_mountinfo_line(fs, s, pa->arena);
 		break;
 	case MNT_FMT_UTAB:
-		rc = mnt_parse_utab_line(fs, s);
+	{
+		int act;
+
+		rc = mnt_parse_utab_line(fs, s, &act);
+		if (rc == 0 && act != MNT_UTAB_ACT_NONE) {
+			rc = utab_apply_record(tb, fs, act);
+			if (rc == 1) {
+				mnt_reset_fs(fs);
+				goto next_line;
+			}
+		}
 		break;
+	}
 	case MNT_FMT_SWAPS:
 		if (strncmp(s, "Filename\t", 9) == 0)
 			goto next_line;			/* skip swap header */
@@ -600,52 +1138,63 @@ static int kernel_fs_postparse(struct libmnt_table *tb,
 	return rc;
 }
 
-/**
- * mnt_table_parse_stream:
- * @tb: tab pointer
- * @f: file stream
- * @filename: filename used for debug and error messages
- *
- * Returns: 0 on success, negative number in case of error.
+/*
+ * Parses all lines from the stream or from the memory, see struct
+ * libmnt_parser.
  */
-int mnt_table_parse_stream(struct libmnt_table *tb, FILE *f, const char *filename)
+static int mnt_table_parse_lines(struct libmnt_table *tb, struct libmnt_parser *pa)
 {
 	int rc = -1;
 	int flags = 0;
 	pid_t tid = -1;
 	struct libmnt_fs *fs = NULL;
-	struct libmnt_parser pa = { .line = 0 };
-
-	assert(tb);
-	assert(f);
-	assert(filename);
+	const char *filename = pa->filename;
 
 	DBG(TAB, ul_debugobj(tb, "%s: start parsing [entries=%d, filter=%s]",
 				filename, mnt_table_get_nents(tb),
 				tb->fltrcb ? "yes" : "not"));
 
-	pa.filename = filename;
-	pa.f = f;
-
 	/* necessary for /proc/mounts only, the /proc/self/mountinfo
 	 * parser sets the flag properly
 	 */
 	if (filename && strcmp(filename, _PATH_PROC_MOUNTS) == 0)
 		flags = MNT_FS_KERNEL;
 
-	while (!feof(f)) {
+	while (!parser_eof(pa)) {
 		if (!fs) {
 			fs = mnt_new_fs();
 			if (!fs)
 				goto err;
 		}
 
-		rc = mnt_table_parse_next(&pa, tb, fs);
+		rc = mnt_table_parse_next(pa, tb, fs);
 
 		if (!rc && tb->fltrcb && tb->fltrcb(fs, tb->fltrcb_data))
 			rc = 1;	/* filtered out by callback... */
 
-		if (!rc) {
+		if (!rc && tb->streamcb) {
+			/* don't add to the table, give it to the caller */
+			fs->flags |= flags;
+			if (tb->fmt == MNT_FMT_MOUNTINFO)
+				rc = kernel_fs_postparse(tb, fs, &tid, filename);
+			if (!rc)
+				rc = tb->streamcb(tb, fs, tb->streamcb_data);
+			if (rc == 1) {
+				DBG(TAB, ul_debugobj(tb, "%s: stopped by callback", filename));
+				break;
+			}
+			if (rc == 0) {
+				if (fs->refcount > 1) {
+					/* the callback keeps the entry */
+					mnt_unref_fs(fs);
+					fs = NULL;
+				} else
+					mnt_reset_fs(fs);
+				continue;
+			}
+			if (rc > 0)
+				rc = -EINVAL;	/* unexpected return code */
+		} else if (!rc) {
 			rc = mnt_table_add_fs(tb, fs);
 			fs->flags |= flags;
 
@@ -664,7 +1213,8 @@ int mnt_table_parse_stream(struct libmnt_table *tb, FILE *f, const char *filenam
 			}
 
 			mnt_unref_fs(fs);
-			if (feof(f))
+			fs = NULL;
+			if (parser_eof(pa))
 				break;
 			goto err;		/* fatal error */
 		}
@@ -672,12 +1222,57 @@ int mnt_table_parse_stream(struct libmnt_table *tb, FILE *f, const char *filenam
 		fs = NULL;
 	}
 
+	mnt_unref_fs(fs);	/* unused after recoverable error at the end */
+
 	DBG(TAB, ul_debugobj(tb, "%s: stop parsing (%d entries)",
 				filename, mnt_table_get_nents(tb)));
-	parser_cleanup(&pa);
 	return 0;
 err:
 	DBG(TAB, ul_debugobj(tb, "%s: parse error (rc=%d)", filename, rc));
+	return rc;
+}
+
+/**
+ * mnt_table_parse_stream:
+ * @tb: tab pointer
+ * @f: file stream
+ * @filename: filename used for debug and error messages
+ *
+ * Returns: 0 on success, negative number in case of error.
+ */
+int mnt_table_parse_stream(struct libmnt_table *tb, FILE *f, const char *filename)
+{
+	struct libmnt_parser pa = { .line = 0 };
+	int rc;
+
+	assert(tb);
+	assert(f);
+	assert(filename);
+
+	pa.filename = filename;
+	pa.f = f;
+
+	rc = mnt_table_parse_lines(tb, &pa);
+	parser_cleanup(&pa);
+	return rc;
+}
+
+/*
+ * Parses the file from the memory. The mountinfo strings are not allocated,
+ * the entries point to the file content in the arena. It's not used with
+ * comments, the comments parser requires separately allocated lines.
+ */
+static int mnt_table_parse_fd(struct libmnt_table *tb, int fd, const char *filename)
+{
+	struct libmnt_parser pa = { .line = 0 };
+	int rc;
+
+	pa.filename = filename;
+	rc = read_to_strarena(fd, &pa.arena);
+	if (rc)
+		return rc;
+
+	rc = mnt_table_parse_lines(tb, &pa);
 	parser_cleanup(&pa);
 	return rc;
 }
@@ -696,23 +1291,426 @@ err:
  */
 int mnt_table_parse_file(struct libmnt_table *tb, const char *filename)
 {
-	FILE *f;
 	int rc;
 
 	if (!filename || !tb)
 		return -EINVAL;
 
-	f = fopen(filename, "r" UL_CLOEXECSTR);
-	if (f) {
-		rc = mnt_table_parse_stream(tb, f, filename);
-		fclose(f);
-	} else
-		rc = -errno;
+	if (!tb->comms) {
+		int fd = open(filename, O_RDONLY|O_CLOEXEC);
+
+		if (fd >= 0) {
+			rc = mnt_table_parse_fd(tb, fd, filename);
+			close(fd);
+		} else
+			rc = -errno;
+	} else {
+		FILE *f = fopen(filename, "r" UL_CLOEXECSTR);
+
+		if (f) {
+			rc = mnt_table_parse_stream(tb, f, filename);
+			fclose(f);
+		} else
+			rc = -errno;
+	}
 
 	DBG(TAB, ul_debugobj(tb, "parsing done [filename=%s, rc=%d]", filename, rc));
 	return rc;
 }
 
+/*
+ * Mount ID to mountinfo entry map for mnt_table_refresh(), open addressing
+ * with linear probing.
+ */
+struct refresh_idmap {
+	struct libmnt_fs	**slots;
+	size_t			size;	/* power of 2 */
+};
+
+static inline size_t idmap_slot(struct refresh_idmap *m, int id)
+{
+	return ((unsigned int) id * 2654435761U) & (m->size - 1);
+}
+
+static int idmap_init(struct refresh_idmap *m, struct list_head *ents, size_t nents)
+{
+	struct list_head *p;
+	size_t sz = 16;
+
+	while (sz < nents * 2)
+		sz <<= 1;
+
+	m->slots = calloc(sz, sizeof(struct libmnt_fs *));
+	if (!m->slots)
+		return -ENOMEM;
+	m->size = sz;
+
+	list_for_each(p, ents) {
+		struct libmnt_fs *fs = list_entry(p, struct libmnt_fs, ents);
+		size_t x = idmap_slot(m, fs->id);
+
+		while (m->slots[x])
+			x = (x + 1) & (sz - 1);
+		m->slots[x] = fs;
+	}
+	return 0;
+}
+
+/* returns and removes entry with @id from the map */
+static struct libmnt_fs *idmap_take(struct refresh_idmap *m, int id)
+{
+	struct libmnt_fs *fs;
+	size_t mask = m->size - 1, i, j;
+
+	if (!m->size)
+		return NULL;
+
+	for (i = idmap_slot(m, id); m->slots[i]; i = (i + 1) & mask) {
+		if (m->slots[i]->id == id)
+			break;
+	}
+	fs = m->slots[i];
+	if (!fs)
+		return NULL;
+
+	/* backward shift, linear probing does not allow gaps */
+	for (j = (i + 1) & mask; m->slots[j]; j = (j + 1) & mask) {
+		size_t k = idmap_slot(m, m->slots[j]->id);
+
+		/* the entry's home slot is cyclically in (i, j] */
+		if (i <= j ? (i < k && k <= j) : (i < k || k <= j))
+			continue;
+		m->slots[i] = m->slots[j];
+		i = j;
+	}
+	m->slots[i] = NULL;
+	return fs;
+}
+
+static inline int refresh_streq(const char *a, const char *b)
+{
+	if (!a || !b)
+		return a == b;
+	return strcmp(a, b) == 0;
+}
+
+/* returns 1 if the entries describe the same mountinfo line */
+static int refresh_fs_equal(struct libmnt_fs *a, struct libmnt_fs *b)
+{
+	return a->id == b->id
+	    && a->parent == b->parent
+	    && a->devno == b->devno
+	    && refresh_streq(a->root, b->root)
+	    && refresh_streq(a->target, b->target)
+	    && refresh_streq(a->fstype, b->fstype)
+	    && refresh_streq(a->source, b->source)
+	    && refresh_streq(a->vfs_optstr, b->vfs_optstr)
+	    && refresh_streq(a->fs_optstr, b->fs_optstr)
+	    && refresh_streq(a->opt_fields, b->opt_fields);
+}
+
+/* returns MNT_TABDIFF_* for the entries with the same ID, or 0 */
+static int refresh_fs_change(struct libmnt_fs *old, struct libmnt_fs *new)
+{
+	if (!refresh_streq(old->source, new->source)
+	    || !refresh_streq(old->root, new->root)
+	    || old->devno != new->devno)
+		return MNT_TABDIFF_UMOUNT;	/* ID reused by another mount */
+	if (!refresh_streq(old->target, new->target))
+		return MNT_TABDIFF_MOVE;
+	if (!refresh_streq(old->vfs_optstr, new->vfs_optstr)
+	    || !refresh_streq(old->fs_optstr, new->fs_optstr))
+		return MNT_TABDIFF_REMOUNT;
+	return 0;
+}
+
+/*
+ * Reads the next mountinfo line from the file content, returns NULL at the end
+ * of the file.
+ */
+static char *refresh_next_line(struct libmnt_parser *pa)
+{
+	char *s;
+
+	do {
+		if (parser_getline(pa) < 0)
+			return NULL;
+		pa->line++;
+
+		s = strchr(pa->buf, '\n');
+		if (!s)
+			s = strchr(pa->buf, '\0');	/* no final newline */
+		*s = '\0';
+		if (--s >= pa->buf && *s == '\r')
+			*s = '\0';
+		s = (char *) skip_blank(pa->buf);
+	} while (*s == '\0' || *s == '#');
+
+	return s;
+}
+
+/*
+ * Parses the mountinfo line @s, returns 0 on success, 1 if the line should
+ * be ignored or negative number in case of error.
+ */
+static int refresh_parse_line(struct libmnt_table *tb, struct libmnt_parser *pa,
+			      char *s, pid_t *tid, struct libmnt_fs **res)
+{
+	struct libmnt_fs *fs;
+	uint64_t hash = mountinfo_line_hash(s);
+	int rc;
+
+	if (prefilter_enabled(tb) && !prefilter_match_line(tb, s))
+		return 1;
+
+	fs = mnt_new_fs();
+	if (!fs)
+		return -ENOMEM;
+
+	/* the strings are allocated, the file content is not kept */
+	rc = mnt_parse_mountinfo_line(fs, s, NULL);
+	if (rc) {
+		DBG(TAB, ul_debugobj(tb, "%s:%zu: mountinfo parse error",
+					pa->filename, pa->line));
+		rc = tb->errcb ? tb->errcb(tb, pa->filename, pa->line) : 1;
+	}
+	if (!rc && tb->fltrcb && tb->fltrcb(fs, tb->fltrcb_data))
+		rc = 1;
+	if (!rc)
+		rc = kernel_fs_postparse(tb, fs, tid, pa->filename);
+	if (rc) {
+		mnt_unref_fs(fs);
+		return rc;
+	}
+
+	fs->linehash = hash;
+	*res = fs;
+	return 0;
+}
+
+/*
+ * Re-parses the whole file to a new table and moves the entries to @tb, used
+ * for non-mountinfo files.
+ */
+static int refresh_by_diff(struct libmnt_table *tb, const char *filename,
+			   struct libmnt_tabdiff *df)
+{
+	struct libmnt_table *new;
+	struct libmnt_tabdiff *diff = df;
+	struct libmnt_fs *fs;
+	int rc;
+
+	new = mnt_new_table();
+	if (!new)
+		return -ENOMEM;
+
+	new->comms = tb->comms;
+	new->errcb = tb->errcb;
+	new->fltrcb = tb->fltrcb;
+	new->fltrcb_data = tb->fltrcb_data;
+	mnt_table_set_cache(new, tb->cache);
+
+	rc = mnt_table_parse_file(new, filename);
+	if (!rc && !diff) {
+		diff = mnt_new_tabdiff();
+		if (!diff)
+			rc = -ENOMEM;
+	}
+	if (!rc)
+		rc = mnt_diff_tables(diff, tb, new);
+	if (rc < 0)
+		goto done;
+
+	mnt_reset_table(tb);
+	while (!list_empty(&new->ents)) {
+		fs = list_entry(new->ents.next, struct libmnt_fs, ents);
+		mnt_ref_fs(fs);
+		mnt_table_remove_fs(new, fs);
+		mnt_table_add_fs(tb, fs);
+		mnt_unref_fs(fs);
+	}
+	if (tb->comms) {
+		mnt_table_set_intro_comment(tb, mnt_table_get_intro_comment(new));
+		mnt_table_set_trailing_comment(tb, mnt_table_get_trailing_comment(new));
+	}
+	tb->fmt = new->fmt;
+done:
+	if (diff != df)
+		mnt_free_tabdiff(diff);
+	mnt_unref_table(new);
+	return rc;
+}
+
+/**
+ * mnt_table_refresh:
+ * @tb: tab pointer
+ * @filename: file or NULL for /proc/self/mountinfo
+ * @df: diff handler or NULL
+ *
+ * Updates @tb in place to match the current content of the mountinfo file, for
+ * example after a change reported by mnt_monitor_next_change(). The changes
+ * are stored in @df and accessible by mnt_tabdiff_next_change(), the @df keeps
+ * references to the removed entries.
+ *
+ * The unchanged lines are detected by mount ID and a hash of the line without
+ * parsing, so the cost is proportional to the number of changes. The unchanged
+ * entries are not modified and remain in @tb. The changed lines are parsed and
+ * replace the original entries (the strings are allocated, see
+ * mnt_fs_get_target() etc.).
+ *
+ * The entries in @tb are expected to be unmodified since the previous parsing
+ * of the file, the filter and error callbacks of @tb are used for the new
+ * lines. The other file formats (fstab, mtab, ...) are re-parsed and compared
+ * by mnt_diff_tables().
+ *
+ * Note that the table content is undefined after an error, mnt_reset_table()
+ * and parse the file again.
+ *
+ * Returns: number of changes or negative number in case of error.
+ *
+ * Since: 2.29
+ */
+int mnt_table_refresh(struct libmnt_table *tb, const char *filename,
+		      struct libmnt_tabdiff *df)
+{
+	struct libmnt_parser pa = { .line = 0 };
+	struct refresh_idmap map = { .size = 0 };
+	struct list_head rest, *p;
+	struct libmnt_fs *fs, *new;
+	size_t nrest = 0;
+	pid_t tid = -1;
+	int rc = 0, fd, nchanges = 0, oper;
+	char *s;
+
+	if (!tb)
+		return -EINVAL;
+	if (!filename)
+		filename = _PATH_PROC_MOUNTINFO;
+	if (df)
+		__mnt_tabdiff_reset(df);
+
+	if (tb->fmt != MNT_FMT_MOUNTINFO)
+		return refresh_by_diff(tb, filename, df);
+
+	DBG(TAB, ul_debugobj(tb, "%s: refresh [entries=%d]", filename, tb->nents));
+
+	fd = open(filename, O_RDONLY|O_CLOEXEC);
+	if (fd < 0)
+		return -errno;
+	pa.filename = filename;
+	rc = read_to_strarena(fd, &pa.arena);
+	close(fd);
+	if (rc)
+		return rc;
+
+	INIT_LIST_HEAD(&rest);
+
+	/* skip the unchanged lines at the begin of the file */
+	p = tb->ents.next;
+	while ((s = refresh_next_line(&pa))) {
+		char *x = s;
+		int id;
+
+		if (p == &tb->ents)
+			break;
+		fs = list_entry(p, struct libmnt_fs, ents);
+		if (fs->linehash != mountinfo_line_hash(s)
+		    || next_number(&x, &id) != 0 || fs->id != id)
+			break;
+		p = p->next;
+	}
+
+	/* move the rest of the entries to the separate list */
+	if (p != &tb->ents) {
+		rest.next = p;
+		rest.prev = tb->ents.prev;
+		p->prev->next = &tb->ents;
+		tb->ents.prev = p->prev;
+		p->prev = &rest;
+		rest.prev->next = &rest;
+
+		list_for_each(p, &rest)
+			nrest++;
+		rc = idmap_init(&map, &rest, nrest);
+		if (rc)
+			goto done;
+	}
+
+	for (; s; s = refresh_next_line(&pa)) {
+		struct libmnt_fs *old = NULL;
+		char *x = s;
+		int id;
+
+		if (next_number(&x, &id) == 0)
+			old = idmap_take(&map, id);
+		if (old && old->linehash == mountinfo_line_hash(s)) {
+			/* unchanged */
+			list_del(&old->ents);
+			list_add_tail(&old->ents, &tb->ents);
+			continue;
+		}
+
+		new = NULL;
+		rc = refresh_parse_line(tb, &pa, s, &tid, &new);
+		if (rc < 0)
+			goto done;
+		if (rc == 1)
+			continue;	/* ignored, @old (if any) is removed later */
+
+		if (old && refresh_fs_equal(old, new)) {
+			/* unchanged, hash unknown */
+			old->linehash = new->linehash;
+			list_del(&old->ents);
+			list_add_tail(&old->ents, &tb->ents);
+			mnt_unref_fs(new);
+			continue;
+		}
+
+		oper = old ? refresh_fs_change(old, new) : MNT_TABDIFF_MOUNT;
+		if (oper == MNT_TABDIFF_UMOUNT) {
+			oper = MNT_TABDIFF_MOUNT;
+			old = NULL;		/* removed later */
+		}
+		if (oper && df)
+			rc = __mnt_tabdiff_add_entry(df, old, new, oper);
+		if (!rc)
+			rc = mnt_table_add_fs(tb, new);
+		mnt_unref_fs(new);
+		if (rc)
+			goto done;
+		if (old)
+			mnt_table_remove_fs(tb, old);
+		if (oper)
+			nchanges++;
+	}
+
+	/* umounted */
+	while (!list_empty(&rest)) {
+		fs = list_entry(rest.next, struct libmnt_fs, ents);
+		if (df) {
+			rc = __mnt_tabdiff_add_entry(df, fs, NULL, MNT_TABDIFF_UMOUNT);
+			if (rc)
+				goto done;
+		}
+		mnt_table_remove_fs(tb, fs);
+		nchanges++;
+	}
+
+	__mnt_table_reset_index(tb);
+	rc = nchanges;
+	DBG(TAB, ul_debugobj(tb, "%s: refresh done [entries=%d, changes=%d]",
+				filename, tb->nents, nchanges));
+done:
+	if (!list_empty(&rest)) {
+		/* error, keep all entries in the table */
+		list_splice(&rest, tb->ents.prev);
+		__mnt_table_reset_index(tb);
+	}
+	free(map.slots);
+	parser_cleanup(&pa);
+	return rc;
+}
+
 static int mnt_table_parse_dir_filter(const struct dirent *d)
 {
 	size_t namesz;
@@ -940,6 +1938,116 @@ int mnt_table_set_parser_fltrcb(struct libmnt_table *tb,
 	return 0;
 }
 
+/**
+ * mnt_table_set_parser_prefilter:
+ * @tb: pointer to table
+ * @flags: MNT_PREFILTER_{TARGET,MOUNTPOINT,SOURCE} to specify usage of @path
+ * @path: path or NULL
+ * @fstypes: filesystems pattern (see mnt_match_fstype()) or NULL
+ * @devno: device number (mountinfo only) or zero
+ *
+ * The parser ignores mountinfo, fstab and mtab lines that do not match the
+ * filter. The raw lines are checked before the line is parsed and before
+ * anything is allocated, so it's fast way to read only relevant entries from
+ * a large table. The filter is not used when parsing comments is enabled.
+ *
+ * The @path is compared as a string, so it should be canonicalized (the
+ * kernel mountinfo paths are canonical). The entry matches if the target
+ * (MNT_PREFILTER_TARGET), the target or a parent directory of the @path
+ * (MNT_PREFILTER_MOUNTPOINT) or the source (MNT_PREFILTER_SOURCE) is the @path.
+ * The source /dev/root always matches, because it's converted to the real
+ * device name after parsing. The fstypes and devno have to match too, if
+ * specified.
+ *
+ * Note that the filter selects a superset of the requested entries, for
+ * example the root filesystem always matches MNT_PREFILTER_MOUNTPOINT.
+ *
+ * Use all arguments zero or NULL to disable the filter.
+ *
+ * Returns: 0 on success or negative number in case of error.
+ *
+ * Since: 2.29
+ */
+int mnt_table_set_parser_prefilter(struct libmnt_table *tb, int flags,
+				   const char *path, const char *fstypes,
+				   dev_t devno)
+{
+	struct libmnt_prefilter *pf;
+	char *p = NULL, *t = NULL;
+	size_t sz = 0;
+
+	if (!tb)
+		return -EINVAL;
+	if (path && !(flags & (MNT_PREFILTER_TARGET |
+			       MNT_PREFILTER_MOUNTPOINT |
+			       MNT_PREFILTER_SOURCE)))
+		return -EINVAL;
+
+	if (path) {
+		p = strdup(path);
+		if (!p)
+			return -ENOMEM;
+		sz = strlen(p);
+		while (sz > 1 && p[sz - 1] == '/')
+			p[--sz] = '\0';
+	}
+	if (fstypes) {
+		t = strdup(fstypes);
+		if (!t) {
+			free(p);
+			return -ENOMEM;
+		}
+	}
+
+	pf = &tb->prefltr;
+	free(pf->path);
+	free(pf->fstypes);
+
+	pf->flags = p ? flags : 0;
+	pf->path = p;
+	pf->pathsz = sz;
+	pf->fstypes = t;
+	pf->devno = devno;
+
+	DBG(TAB, ul_debugobj(tb, "parser prefilter: path=%s, fstypes=%s, devno=%u:%u",
+				p, t, major(devno), minor(devno)));
+	return 0;
+}
+
+/**
+ * mnt_table_set_parser_streamcb:
+ * @tb: pointer to table
+ * @cb: pointer to callback function or NULL
+ * @data: callback private data
+ *
+ * The parsed entries are not added to @tb, but passed to the callback. The
+ * entry is reused or deallocated after the callback, use mnt_ref_fs() to keep
+ * it. The callback return codes:
+ *
+ *   <0  : fatal error (abort parsing)
+ *    0	 : success (parsing continues)
+ *    1  : stop parsing (the parser returns success)
+ *
+ * It's usable together with mnt_table_set_parser_prefilter() to read only
+ * a few entries from a large table without allocating the others.
+ *
+ * Returns: 0 on success or negative number in case of error.
+ *
+ * Since: 2.29
+ */
+int mnt_table_set_parser_streamcb(struct libmnt_table *tb,
+		int (*cb)(struct libmnt_table *tb, struct libmnt_fs *fs, void *data),
+		void *data)
+{
+	if (!tb)
+		return -EINVAL;
+
+	DBG(TAB, ul_debugobj(tb, "%s table parser stream callback", cb ? "set" : "unset"));
+	tb->streamcb = cb;
+	tb->streamcb_data = data;
+	return 0;
+}
+
 /**
  * mnt_table_parse_swaps:
  * @tb: table
@@ -25,6 +25,9 @@
 #include "mountP.h"
 #include "mangle.h"
 #include "pathnames.h"
+#include "strutils.h"
+#include "all-io.h"
+#include "env.h"
 
 struct libmnt_update {
 	char		*target;
@@ -814,6 +817,205 @@ static int update_modify_options(struct libmnt_update *upd, struct libmnt_lock *
 	return rc;
 }
 
+/*
+ * Append-only utab
+ *
+ * If $LIBMOUNT_UTAB_APPEND is set then utab is not rewritten on every change,
+ * but the change is appended to the file as one record (see MNT_UTAB_ACT_*)
+ * by O_APPEND write(2). The records are applied by the utab parser. The
+ * appends use a shared lock, so concurrent mounts and umounts do not wait for
+ * each other.
+ *
+ * The file is compacted (rewritten in the usual way) when the appended
+ * records are larger than the compacted entries. The compaction is done by
+ * the process that crossed the limit; it is skipped if the exclusive lock is
+ * not immediately available.
+ */
+static int utab_append_enabled(struct libmnt_update *upd)
+{
+	return upd->userspace_only && safe_getenv("LIBMOUNT_UTAB_APPEND");
+}
+
+static int utab_format_record(struct libmnt_update *upd, char **buf, size_t *bufsz)
+{
+	FILE *f;
+	char *src = NULL, *tgt = NULL;
+	int rc = 0;
+
+	f = open_memstream(buf, bufsz);
+	if (!f)
+		return -errno;
+
+	if (!upd->fs) {
+		/* umount */
+		tgt = mangle(upd->target);
+		rc = tgt ? fprintf(f, "ACTION=umount TARGET=%s\n", tgt) : -ENOMEM;
+
+	} else if (upd->mountflags & MS_MOVE) {
+		src = mangle(mnt_fs_get_srcpath(upd->fs));
+		tgt = mangle(mnt_fs_get_target(upd->fs));
+		rc = src && tgt ? fprintf(f, "ACTION=move SRC=%s TARGET=%s\n",
+					  src, tgt) : -ENOMEM;
+	} else {
+		/* mount or remount */
+		if (upd->mountflags & MS_REMOUNT)
+			rc = fprintf(f, "ACTION=remount ");
+		if (rc >= 0)
+			rc = fprintf_utab_fs(f, upd->fs);
+	}
+
+	free(src);
+	free(tgt);
+
+	if (fclose(f) != 0 && rc >= 0)
+		rc = -errno;
+	if (rc < 0) {
+		free(*buf);
+		*buf = NULL;
+		return rc;
+	}
+	return 0;
+}
+
+/* returns 1 if the utab should be compacted */
+static int utab_need_compaction(int fd)
+{
+	char buf[sizeof(MNT_UTAB_COMPACTED) + 32];
+	uint64_t sz = 0;
+	struct stat st;
+	ssize_t n;
+
+	if (fstat(fd, &st) != 0 || st.st_size < MNT_UTAB_COMPACT_MINSZ)
+		return 0;
+
+	n = pread(fd, buf, sizeof(buf) - 1, 0);
+	if (n > 0) {
+		buf[n] = '\0';
+		if (startswith(buf, MNT_UTAB_COMPACTED))
+			sz = strtoull(buf + sizeof(MNT_UTAB_COMPACTED) - 1, NULL, 10);
+	}
+
+	return (uint64_t) st.st_size > 2 * sz + MNT_UTAB_COMPACT_MINSZ;
+}
+
+static int utab_compact(struct libmnt_update *upd, struct libmnt_lock *lc)
+{
+	struct libmnt_table *tb = NULL;
+	struct libmnt_iter itr;
+	struct libmnt_fs *fs;
+	char *buf = NULL, *hdr = NULL;
+	size_t bufsz = 0;
+	FILE *f;
+	int rc;
+
+	rc = mnt_trylock_file(lc);
+	if (rc == 1) {
+		DBG(UPDATE, ul_debugobj(upd, "%s: busy, compaction skipped",
+					upd->filename));
+		return 0;
+	}
+	if (rc)
+		return rc;
+
+	DBG(UPDATE, ul_debugobj(upd, "%s: compacting", upd->filename));
+
+	tb = __mnt_new_table_from_file(upd->filename, MNT_FMT_UTAB);
+	if (!tb) {
+		rc = -EINVAL;
+		goto done;
+	}
+
+	/* size of the entries for the header, see utab_need_compaction() */
+	f = open_memstream(&buf, &bufsz);
+	if (!f) {
+		rc = -errno;
+		goto done;
+	}
+	mnt_reset_iter(&itr, MNT_ITER_FORWARD);
+	while (rc == 0 && mnt_table_next_fs(tb, &itr, &fs) == 0)
+		rc = fprintf_utab_fs(f, fs);
+	if (fclose(f) != 0 && !rc)
+		rc = -errno;
+	if (rc)
+		goto done;
+
+	if (asprintf(&hdr, MNT_UTAB_COMPACTED "%zu\n", bufsz) < 0) {
+		hdr = NULL;
+		rc = -ENOMEM;
+		goto done;
+	}
+	mnt_table_enable_comments(tb, TRUE);
+	rc = mnt_table_set_intro_comment(tb, hdr);
+	if (!rc)
+		rc = update_table(upd, tb);
+done:
+	mnt_unlock_file(lc);
+	mnt_unref_table(tb);
+	free(buf);
+	free(hdr);
+	return rc;
+}
+
+static int update_append_record(struct libmnt_update *upd, struct libmnt_lock *lc)
+{
+	char *buf = NULL;
+	size_t bufsz = 0;
+	int fd, rc, compact = 0;
+
+	assert(upd);
+
+	DBG(UPDATE, ul_debugobj(upd, "%s: append record", upd->filename));
+
+	if (!upd->fs || (upd->mountflags & MS_MOVE)) {
+		/* umount or move; ignore filesystems without utab entry */
+		struct libmnt_table *tb = __mnt_new_table_from_file(
+					upd->filename, MNT_FMT_UTAB);
+		const char *tgt = upd->fs ? mnt_fs_get_srcpath(upd->fs) : upd->target;
+		int found = tb && tgt && mnt_table_find_target(tb, tgt, MNT_ITER_BACKWARD);
+
+		mnt_unref_table(tb);
+		if (!found) {
+			DBG(UPDATE, ul_debugobj(upd, "%s: no entry for %s",
+						upd->filename, tgt));
+			return 0;
+		}
+	}
+
+	rc = utab_format_record(upd, &buf, &bufsz);
+	if (rc)
+		return rc;
+
+	if (lc) {
+		mnt_lock_use_sharedlock(lc, TRUE);
+		rc = mnt_lock_file(lc);
+		mnt_lock_use_sharedlock(lc, FALSE);
+		if (rc)
+			goto done;
+	}
+
+	fd = open(upd->filename, O_RDWR|O_APPEND|O_CREAT|O_CLOEXEC,
+			S_IRUSR|S_IWUSR|S_IRGRP|S_IROTH);
+	if (fd < 0)
+		rc = -errno;
+	else {
+		if (write_all(fd, buf, bufsz) != 0)
+			rc = -errno;
+		else
+			compact = utab_need_compaction(fd);
+		close(fd);
+	}
+
+	if (lc)
+		mnt_unlock_file(lc);
+
+	/* the record is already written, compaction errors are not fatal */
+	if (!rc && compact && lc)
+		utab_compact(upd, lc);
+done:
+	free(buf);
+	return rc;
+}
+
 /**
  * mnt_update_table:
  * @upd: update
@@ -850,7 +1052,9 @@ int mnt_update_table(struct libmnt_update *upd, struct libmnt_lock *lc)
 	if (lc && upd->userspace_only)
 		mnt_lock_use_simplelock(lc, TRUE);	/* use flock */
 
-	if (!upd->fs && upd->target)
+	if (utab_append_enabled(upd))
+		rc = update_append_record(upd, lc);	/* append-only utab */
+	else if (!upd->fs && upd->target)
 		rc = update_remove_entry(upd, lc);	/* umount */
 	else if (upd->mountflags & MS_MOVE)
 		rc = update_modify_target(upd, lc);	/* move */
@@ -885,8 +1089,12 @@ int mnt_update_already_done(struct libmnt_update *upd, struct libmnt_lock *lc)
 	}
 	if (lc && upd->userspace_only)
 		mnt_lock_use_simplelock(lc, TRUE);	/* use flock */
-	if (lc)
+	if (lc) {
+		/* don't block appends, see update_append_record() */
+		mnt_lock_use_sharedlock(lc, utab_append_enabled(upd));
 		rc = mnt_lock_file(lc);
+		mnt_lock_use_sharedlock(lc, FALSE);
+	}
 	if (rc)
 		goto done;
 
@@ -1039,6 +1247,33 @@ static int test_replace(struct libmnt_test *ts, int argc, char *argv[])
 	return rc;
 }
 
+static int test_compact(struct libmnt_test *ts, int argc, char *argv[])
+{
+	struct libmnt_update *upd = mnt_new_update();
+	struct libmnt_lock *lc = NULL;
+	int rc;
+
+	if (!upd)
+		return -ENOMEM;
+
+	rc = mnt_update_set_filename(upd, NULL, 0);
+	if (!rc && !upd->userspace_only)
+		rc = -EINVAL;
+	if (!rc) {
+		lc = mnt_new_lock(upd->filename, 0);
+		if (!lc)
+			rc = -ENOMEM;
+	}
+	if (!rc) {
+		mnt_lock_use_simplelock(lc, TRUE);
+		rc = utab_compact(upd, lc);
+	}
+
+	mnt_free_lock(lc);
+	mnt_free_update(upd);
+	return rc;
+}
+
 int main(int argc, char *argv[])
 {
 	struct libmnt_test tss[] = {
@@ -1047,6 +1282,7 @@ int main(int argc, char *argv[])
 	{ "--move",   test_move,    "<old_target>  <target>        MS_MOVE mtab change" },
 	{ "--remount",test_remount, "<target>  <options>           MS_REMOUNT mtab change" },
 	{ "--replace",test_replace, "<src> <target>                Add a line to LIBMOUNT_FSTAB and replace the original file" },
+	{ "--compact",test_compact, "                              compact append-only utab" },
 	{ NULL }
 	};
 
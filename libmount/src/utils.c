@@ -52,6 +52,23 @@ int append_string(char **a, const char *b)
 	return 0;
 }
 
+/*
+ * FNV-1a hash of the path, the redundant slashes are ignored, so the paths
+ * equal by streq_paths() have the same hash.
+ */
+unsigned int mnt_hash_path(const char *path)
+{
+	unsigned int h = 2166136261U;
+	const unsigned char *p = (const unsigned char *) path;
+
+	for (; *p; p++) {
+		if (*p == '/' && (*(p + 1) == '/' || *(p + 1) == '\0'))
+			continue;
+		h = (h ^ *p) * 16777619U;
+	}
+	return h;
+}
+
 /*
  * Return 1 if the file is not accessible or empty
  */
@@ -0,0 +1,132 @@
+/*
+ * Copyright (C) 2016 Karel Zak <kzak@redhat.com>
+ *
+ * This file may be redistributed under the terms of the
+ * GNU Lesser General Public License.
+ */
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <getopt.h>
+
+#include "c.h"
+#include "nls.h"
+#include "strutils.h"
+#include "xalloc.h"
+
+#include "libsmartcols.h"
+
+enum { COL_NUM, COL_NAME, COL_DATA };
+
+/* add columns to the @tb */
+static void setup_columns(struct libscols_table *tb)
+{
+	if (!scols_table_new_column(tb, "NUM", 8, SCOLS_FL_RIGHT))
+		goto fail;
+	if (!scols_table_new_column(tb, "NAME", 0, 0))
+		goto fail;
+	if (!scols_table_new_column(tb, "DATA", 0, 0))
+		goto fail;
+	return;
+fail:
+	scols_unref_table(tb);
+	err(EXIT_FAILURE, "failed to create output columns");
+}
+
+static void add_line(struct libscols_table *tb, size_t i)
+{
+	char *p;
+	struct libscols_line *ln = scols_table_new_line(tb, NULL);
+
+	if (!ln)
+		err(EXIT_FAILURE, "failed to create output line");
+
+	/* the line is printed when the next line is added */
+	xasprintf(&p, "%zu", i);
+	if (scols_line_refer_data(ln, COL_NUM, p))
+		goto fail;
+
+	xasprintf(&p, "name-%zu", i % 7 ? i : i * 1000);
+	if (scols_line_refer_data(ln, COL_NAME, p))
+		goto fail;
+
+	xasprintf(&p, "data-%02zu-%02zu-%02zu-end", i + 1, i + 2, i + 3);
+	if (scols_line_refer_data(ln, COL_DATA, p))
+		goto fail;
+	return;
+fail:
+	scols_unref_table(tb);
+	err(EXIT_FAILURE, "failed to create output line");
+}
+
+static void __attribute__((__noreturn__)) usage(FILE *out)
+{
+	fprintf(out, " %s [options]\n", program_invocation_short_name);
+	fputs(" -n, --lines <num>    number of lines\n", out);
+	fputs(" -s, --sample <num>   number of lines to count widths\n", out);
+	fputs(" -J, --json           use JSON output format\n", out);
+	fputs(" -r, --raw            use raw output format\n", out);
+	fputs(" -E, --export         use key=\"value\" output format\n", out);
+
+	exit(out == stderr ? EXIT_FAILURE : EXIT_SUCCESS);
+}
+
+int main(int argc, char *argv[])
+{
+	struct libscols_table *tb;
+	size_t i, nlines = 20;
+	int c;
+
+	static const struct option longopts[] = {
+		{ "lines",  1, 0, 'n' },
+		{ "sample", 1, 0, 's' },
+		{ "json",   0, 0, 'J' },
+		{ "raw",    0, 0, 'r' },
+		{ "export", 0, 0, 'E' },
+		{ "help",   0, 0, 'h' },
+		{ NULL, 0, 0, 0 },
+	};
+
+	scols_init_debug(0);
+
+	tb = scols_new_table();
+	if (!tb)
+		err(EXIT_FAILURE, "failed to create output table");
+
+	while((c = getopt_long(argc, argv, "n:s:JrEh", longopts, NULL)) != -1) {
+		switch(c) {
+		case 'n':
+			nlines = strtou32_or_err(optarg, "failed to parse number of lines");
+			break;
+		case 's':
+			scols_table_set_streaming_sample(tb,
+				strtou32_or_err(optarg, "failed to parse sample size"));
+			break;
+		case 'J':
+			scols_table_enable_json(tb, 1);
+			scols_table_set_name(tb, "stream");
+			break;
+		case 'r':
+			scols_table_enable_raw(tb, 1);
+			break;
+		case 'E':
+			scols_table_enable_export(tb, 1);
+			break;
+		case 'h':
+			usage(stdout);
+		default:
+			usage(stderr);
+		}
+	}
+
+	scols_table_enable_streaming(tb, 1);
+	setup_columns(tb);
+
+	for (i = 0; i < nlines; i++)
+		add_line(tb, i);
+
+	scols_print_table(tb);		/* print the rest */
+	scols_unref_table(tb);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,125 @@
+/*
+ * arena.c - table-owned memory for lines and cells data
+ *
+ * Copyright (C) 2016 Karel Zak <kzak@redhat.com>
+ *
+ * This file may be redistributed under the terms of the
+ * GNU Lesser General Public License.
+ */
+
+/*
+ * The arena is a list of large memory blocks, the small allocations are
+ * carved from the blocks and never deallocated separately. All memory is
+ * deallocated at once by scols_free_arena(). See scols_table_enable_arena().
+ */
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "smartcolsP.h"
+
+#define ARENA_BLOCKSZ	(64 * 1024)
+#define ARENA_ALIGN	(2 * sizeof(void *))
+
+struct libscols_arena_block {
+	struct libscols_arena_block *next;
+	size_t	size;		/* size of the data[] */
+	size_t	used;		/* already allocated bytes from data[] */
+	char	data[];
+};
+
+struct libscols_arena {
+	struct libscols_arena_block *blocks;	/* the first is the current */
+	size_t	nblocks;
+};
+
+struct libscols_arena *scols_new_arena(void)
+{
+	struct libscols_arena *ar = calloc(1, sizeof(*ar));
+
+	if (ar)
+		DBG(TAB, ul_debugobj(ar, "alloc arena"));
+	return ar;
+}
+
+void scols_free_arena(struct libscols_arena *ar)
+{
+	if (!ar)
+		return;
+
+	DBG(TAB, ul_debugobj(ar, "dealloc arena [blocks=%zu]", ar->nblocks));
+	while (ar->blocks) {
+		struct libscols_arena_block *blk = ar->blocks;
+
+		ar->blocks = blk->next;
+		free(blk);
+	}
+	free(ar);
+}
+
+static void *arena_alloc(struct libscols_arena *ar, size_t sz, size_t align)
+{
+	struct libscols_arena_block *blk = ar->blocks;
+	size_t pad = 0;
+
+	if (blk) {
+		uintptr_t p = (uintptr_t) (blk->data + blk->used);
+		pad = (align - (p & (align - 1))) & (align - 1);
+	}
+
+	if (!blk || blk->used + pad + sz > blk->size) {
+		/* large requests get a private block, don't waste the current */
+		size_t bsz = sz + ARENA_ALIGN > ARENA_BLOCKSZ / 4 ?
+				sz + ARENA_ALIGN : ARENA_BLOCKSZ;
+
+		blk = malloc(sizeof(*blk) + bsz);
+		if (!blk)
+			return NULL;
+		blk->size = bsz;
+		blk->used = 0;
+
+		if (ar->blocks && bsz != ARENA_BLOCKSZ) {
+			blk->next = ar->blocks->next;
+			ar->blocks->next = blk;
+		} else {
+			blk->next = ar->blocks;
+			ar->blocks = blk;
+		}
+		ar->nblocks++;
+
+		pad = (align - ((uintptr_t) blk->data & (align - 1))) & (align - 1);
+	}
+
+	blk->used += pad;
+	blk->used += sz;
+	return blk->data + blk->used - sz;
+}
+
+/* returns zeroized memory aligned for any libsmartcols struct */
+void *scols_arena_calloc(struct libscols_arena *ar, size_t sz)
+{
+	void *p;
+
+	if (!ar || !sz)
+		return NULL;
+
+	p = arena_alloc(ar, sz, ARENA_ALIGN);
+	if (p)
+		memset(p, 0, sz);
+	return p;
+}
+
+char *scols_arena_strdup(struct libscols_arena *ar, const char *str)
+{
+	size_t sz;
+	char *p;
+
+	if (!ar || !str)
+		return NULL;
+
+	sz = strlen(str) + 1;
+	p = arena_alloc(ar, sz, 1);
+	if (p)
+		memcpy(p, str, sz);
+	return p;
+}
@@ -20,6 +20,7 @@
 
 
 #include <stdlib.h>
+#include <stdint.h>
 #include <unistd.h>
 #include <string.h>
 #include <ctype.h>
@@ -45,7 +46,8 @@ int scols_reset_cell(struct libscols_cell *ce)
 		return -EINVAL;
 
 	/*DBG(CELL, ul_debugobj(ce, "reset"));*/
-	free(ce->data);
+	if (!ce->in_arena)
+		free(ce->data);
 	free(ce->color);
 	memset(ce, 0, sizeof(*ce));
 	return 0;
@@ -62,7 +64,16 @@ int scols_reset_cell(struct libscols_cell *ce)
  */
 int scols_cell_set_data(struct libscols_cell *ce, const char *str)
 {
-	return strdup_to_struct_member(ce, data, str);
+	char *p = NULL;
+
+	if (!ce)
+		return -EINVAL;
+	if (str) {
+		p = strdup(str);
+		if (!p)
+			return -ENOMEM;
+	}
+	return scols_cell_refer_data(ce, p);
 }
 
 /**
@@ -81,8 +92,32 @@ int scols_cell_refer_data(struct libscols_cell *ce, char *str)
 {
 	if (!ce)
 		return -EINVAL;
-	free(ce->data);
+	if (!ce->in_arena)
+		free(ce->data);
 	ce->data = str;
+	ce->in_arena = 0;
+	ce->width_gen = 0;
+	return 0;
+}
+
+/*
+ * The same as scols_cell_set_data(), but the copy of @str is allocated from
+ * the table arena @ar, see scols_table_enable_arena().
+ */
+int scols_cell_set_arena_data(struct libscols_cell *ce,
+			      struct libscols_arena *ar, const char *str)
+{
+	char *p = NULL;
+
+	if (!ce || !ar)
+		return -EINVAL;
+	if (str) {
+		p = scols_arena_strdup(ar, str);
+		if (!p)
+			return -ENOMEM;
+	}
+	scols_cell_refer_data(ce, p);
+	ce->in_arena = p ? 1 : 0;
 	return 0;
 }
 
@@ -155,6 +190,41 @@ int scols_cmpstr_cells(struct libscols_cell *a,
 	return strcmp(adata, bdata);
 }
 
+/**
+ * scols_cmpu64_cells:
+ * @a: pointer to cell
+ * @b: pointer to cell
+ * @data: unused pointer to private data (defined by API)
+ *
+ * Compares numbers stored in the cells user data, the user data has to be
+ * a pointer to uint64_t (or NULL). The function is designed for
+ * scols_column_set_cmpfunc() and scols_sort_table().
+ *
+ * Returns: -1, 0 or 1 (cells without number are the smallest).
+ *
+ * Since: 2.29
+ */
+int scols_cmpu64_cells(struct libscols_cell *a,
+		       struct libscols_cell *b,
+		       __attribute__((__unused__)) void *data)
+{
+	uint64_t *adata, *bdata;
+
+	if (a == b)
+		return 0;
+
+	adata = (uint64_t *) scols_cell_get_userdata(a);
+	bdata = (uint64_t *) scols_cell_get_userdata(b);
+
+	if (adata == NULL && bdata == NULL)
+		return 0;
+	if (adata == NULL)
+		return -1;
+	if (bdata == NULL)
+		return 1;
+	return *adata == *bdata ? 0 : *adata > *bdata ? 1 : -1;
+}
+
 /**
  * scols_cell_set_color:
  * @ce: a pointer to a struct libscols_cell instance
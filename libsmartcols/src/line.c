@@ -35,15 +35,29 @@
  * Returns: a pointer to a new struct libscols_line instance.
  */
 struct libscols_line *scols_new_line(void)
+{
+	return scols_new_arena_line(NULL);
+}
+
+/*
+ * Allocates the line (and later its cells) from the table arena @ar or by
+ * calloc() if @ar is NULL. The arena line is never deallocated by
+ * scols_unref_line(), the memory is released together with the table.
+ */
+struct libscols_line *scols_new_arena_line(struct libscols_arena *ar)
 {
 	struct libscols_line *ln;
 
-	ln = calloc(1, sizeof(*ln));
+	if (ar)
+		ln = scols_arena_calloc(ar, sizeof(*ln));
+	else
+		ln = calloc(1, sizeof(*ln));
 	if (!ln)
 		return NULL;
 
-	DBG(LINE, ul_debugobj(ln, "alloc"));
+	DBG(LINE, ul_debugobj(ln, "alloc%s", ar ? " [arena]" : ""));
 	ln->refcount = 1;
+	ln->arena = ar;
 	INIT_LIST_HEAD(&ln->ln_lines);
 	INIT_LIST_HEAD(&ln->ln_children);
 	INIT_LIST_HEAD(&ln->ln_branch);
@@ -78,7 +92,8 @@ void scols_unref_line(struct libscols_line *ln)
 		list_del(&ln->ln_children);
 		scols_line_free_cells(ln);
 		free(ln->color);
-		free(ln);
+		if (!ln->arena)
+			free(ln);
 		return;
 	}
 }
@@ -101,7 +116,8 @@ void scols_line_free_cells(struct libscols_line *ln)
 	for (i = 0; i < ln->ncells; i++)
 		scols_reset_cell(&ln->cells[i]);
 
-	free(ln->cells);
+	if (!ln->arena)
+		free(ln->cells);
 	ln->ncells = 0;
 	ln->cells = NULL;
 }
@@ -134,9 +150,18 @@ int scols_line_alloc_cells(struct libscols_line *ln, size_t n)
 
 	DBG(LINE, ul_debugobj(ln, "alloc %zu cells", n));
 
-	ce = realloc(ln->cells, n * sizeof(struct libscols_cell));
-	if (!ce)
-		return -errno;
+	if (ln->arena) {
+		/* the old array is released together with the arena */
+		ce = scols_arena_calloc(ln->arena, n * sizeof(struct libscols_cell));
+		if (!ce)
+			return -ENOMEM;
+		if (ln->cells)
+			memcpy(ce, ln->cells, min(n, ln->ncells) * sizeof(struct libscols_cell));
+	} else {
+		ce = realloc(ln->cells, n * sizeof(struct libscols_cell));
+		if (!ce)
+			return -errno;
+	}
 
 	if (n > ln->ncells)
 		memset(ce + ln->ncells, 0,
@@ -369,6 +394,8 @@ int scols_line_set_data(struct libscols_line *ln, size_t n, const char *data)
 
 	if (!ce)
 		return -EINVAL;
+	if (ln->arena)
+		return scols_cell_set_arena_data(ce, ln->arena, data);
 	return scols_cell_set_data(ce, data);
 }
 
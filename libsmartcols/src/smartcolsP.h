@@ -64,6 +64,11 @@ struct libscols_cell {
 	char	*color;
 	void    *userdata;
 	int	flags;
+
+	size_t	width;		/* cached number of cells, see cell_get_width() */
+	unsigned int width_gen;	/* print generation of the cached width */
+	unsigned int is_ascii :1, /* data are printable ASCII only */
+		     in_arena :1; /* data allocated from table arena */
 };
 
 
@@ -118,6 +123,7 @@ struct libscols_line {
 	struct list_head	ln_children;
 
 	struct libscols_line	*parent;
+	struct libscols_arena	*arena;		/* line and cells allocated from table arena */
 };
 
 enum {
@@ -130,6 +136,9 @@ enum {
 /*
  * The table
  */
+struct libscols_buffer;
+struct libscols_arena;
+
 struct libscols_table {
 	int	refcount;
 	char	*name;		/* optional table name (for JSON) */
@@ -148,6 +157,15 @@ struct libscols_table {
 	struct libscols_symbols	*symbols;
 	struct libscols_cell	title;		/* optional table title (for humans) */
 
+	struct libscols_buffer	*stream_buf;	/* streaming output buffer */
+	size_t	stream_sample;	/* number of lines used to count widths */
+	unsigned int print_gen;	/* incremented for each print, see cell_get_width() */
+	struct libscols_arena	*arena;	/* memory for lines and cells data */
+
+	char	*outbuf;	/* direct output buffer, see out_begin() */
+	size_t	outbuf_used;	/* number of bytes in outbuf */
+	int	outfd;		/* file descriptor of the output stream */
+
 	int	indent;		/* indention counter */
 	int	indent_last_sep;/* last printed has been line separator */
 	int	format;		/* SCOLS_FMT_* */
@@ -160,7 +178,10 @@ struct libscols_table {
 			header_printed  :1,	/* header already printed */
 			no_headings	:1,	/* don't print header */
 			no_linesep	:1,	/* don't print line separator */
-			no_wrap		:1;	/* never wrap lines */
+			no_wrap		:1,	/* never wrap lines */
+			streaming	:1,	/* print lines when added */
+			stream_started	:1,	/* header already printed by streaming */
+			use_arena	:1;	/* allocate new lines from arena */
 };
 
 #define IS_ITER_FORWARD(_i)	((_i)->direction == SCOLS_ITER_FORWARD)
@@ -189,4 +210,29 @@ static inline int scols_iter_is_last(struct libscols_iter *itr)
 	return itr->p == itr->head;
 }
 
+/*
+ * arena.c
+ */
+extern struct libscols_arena *scols_new_arena(void);
+extern void scols_free_arena(struct libscols_arena *ar);
+extern void *scols_arena_calloc(struct libscols_arena *ar, size_t sz);
+extern char *scols_arena_strdup(struct libscols_arena *ar, const char *str);
+
+/*
+ * line.c
+ */
+extern struct libscols_line *scols_new_arena_line(struct libscols_arena *ar);
+
+/*
+ * cell.c
+ */
+extern int scols_cell_set_arena_data(struct libscols_cell *ce,
+				     struct libscols_arena *ar, const char *str);
+
+/*
+ * table_print.c
+ */
+extern int scols_table_print_stream(struct libscols_table *tb);
+extern void scols_table_free_stream(struct libscols_table *tb);
+
 #endif /* _LIBSMARTCOLS_PRIVATE_H */
@@ -19,6 +19,7 @@
 
 
 #include <stdlib.h>
+#include <stdint.h>
 #include <unistd.h>
 #include <string.h>
 #include <termios.h>
@@ -84,8 +85,10 @@ void scols_unref_table(struct libscols_table *tb)
 {
 	if (tb && (--tb->refcount <= 0)) {
 		DBG(TAB, ul_debugobj(tb, "dealloc"));
+		scols_table_free_stream(tb);
 		scols_table_remove_lines(tb);
 		scols_table_remove_columns(tb);
+		scols_free_arena(tb->arena);		/* after lines! */
 		scols_unref_symbols(tb->symbols);
 		scols_reset_cell(&tb->title);
 		free(tb->linesep);
@@ -423,6 +426,9 @@ struct libscols_column *scols_table_get_column(struct libscols_table *tb,
  * Note that this function calls scols_line_alloc_cells() if number
  * of the cells in the line is too small for @tb.
  *
+ * If the streaming output is enabled then the previous lines are printed and
+ * removed from the table, see scols_table_enable_streaming().
+ *
  * Returns: 0, a negative value in case of an error.
  */
 int scols_table_add_line(struct libscols_table *tb, struct libscols_line *ln)
@@ -440,6 +446,9 @@ int scols_table_add_line(struct libscols_table *tb, struct libscols_line *ln)
 	list_add_tail(&ln->ln_lines, &tb->tb_lines);
 	ln->seqnum = tb->nlines++;
 	scols_ref_line(ln);
+
+	if (tb->streaming)
+		return scols_table_print_stream(tb);
 	return 0;
 }
 
@@ -540,7 +549,10 @@ struct libscols_line *scols_table_new_line(struct libscols_table *tb,
 	if (!tb || !tb->ncols)
 		return NULL;
 
-	ln = scols_new_line();
+	if (tb->use_arena && !tb->streaming)
+		ln = scols_new_arena_line(tb->arena);
+	else
+		ln = scols_new_line();
 	if (!ln)
 		return NULL;
 
@@ -889,6 +901,108 @@ int scols_table_enable_nowrap(struct libscols_table *tb, int enable)
 	return 0;
 }
 
+/**
+ * scols_table_enable_streaming:
+ * @tb: table
+ * @enable: 1 or 0
+ *
+ * Enable/disable streaming output. The lines are printed and removed from
+ * the table when the next line is added (the line is usually filled after
+ * scols_table_new_line()), and the rest of the table is printed by
+ * scols_print_table(). The memory used by the table does not grow with the
+ * number of lines, so don't use the lines after the next line is added.
+ *
+ * The column widths are not counted from all data, but from the column
+ * width hints and from the first lines, see scols_table_set_streaming_sample().
+ * The raw, export and JSON output formats do not use the widths at all and
+ * the lines are printed immediately.
+ *
+ * The tree output is not supported, the tree is printed by
+ * scols_print_table() as usual.
+ *
+ * Returns: 0 on success, negative number in case of an error.
+ *
+ * Since: 2.29
+ */
+int scols_table_enable_streaming(struct libscols_table *tb, int enable)
+{
+	if (!tb || tb->stream_started)
+		return -EINVAL;
+	DBG(TAB, ul_debugobj(tb, "streaming: %s", enable ? "ENABLE" : "DISABLE"));
+	tb->streaming = enable ? 1 : 0;
+	return 0;
+}
+
+/**
+ * scols_table_set_streaming_sample:
+ * @tb: table
+ * @nlines: number of lines
+ *
+ * Sets number of the first lines used to count column widths for the
+ * streaming output. The lines are kept in the table until the sample is
+ * complete. The default is zero, so the widths are based on the column width
+ * hints and the column headers only.
+ *
+ * Returns: 0 on success, negative number in case of an error.
+ *
+ * Since: 2.29
+ */
+int scols_table_set_streaming_sample(struct libscols_table *tb, size_t nlines)
+{
+	if (!tb)
+		return -EINVAL;
+	DBG(TAB, ul_debugobj(tb, "streaming sample: %zu lines", nlines));
+	tb->stream_sample = nlines;
+	return 0;
+}
+
+/**
+ * scols_table_is_streaming:
+ * @tb: table
+ *
+ * Returns: 1 if streaming output is enabled.
+ *
+ * Since: 2.29
+ */
+int scols_table_is_streaming(struct libscols_table *tb)
+{
+	return tb && tb->streaming;
+}
+
+/**
+ * scols_table_enable_arena:
+ * @tb: table
+ * @enable: 1 or 0
+ *
+ * Enable/disable allocation of the lines and cells data from a memory owned
+ * by the table. The memory is allocated in large blocks and all the memory is
+ * deallocated at once by scols_unref_table(). This is recommended for large
+ * tables to reduce number of malloc() and free() calls.
+ *
+ * The arena is used for lines created by scols_table_new_line() and for data
+ * set by scols_line_set_data() and scols_line_set_column_data(). The memory
+ * is not released when the line is removed from the table, so don't use the
+ * lines after scols_unref_table(), and don't use arena for streaming output
+ * (it's ignored if streaming is enabled).
+ *
+ * Returns: 0 on success, negative number in case of an error.
+ *
+ * Since: 2.29
+ */
+int scols_table_enable_arena(struct libscols_table *tb, int enable)
+{
+	if (!tb)
+		return -EINVAL;
+	if (enable && !tb->arena) {
+		tb->arena = scols_new_arena();
+		if (!tb->arena)
+			return -ENOMEM;
+	}
+	DBG(TAB, ul_debugobj(tb, "arena: %s", enable ? "ENABLE" : "DISABLE"));
+	tb->use_arena = enable ? 1 : 0;
+	return 0;
+}
+
 /**
  * scols_table_colors_wanted:
  * @tb: table
@@ -1047,22 +1161,154 @@ char *scols_table_get_line_separator(struct libscols_table *tb)
 
 }
 
-static int cells_cmp_wrapper(struct list_head *a, struct list_head *b, void *data)
+/*
+ * Sorting
+ *
+ * The sort keys are extracted from the lines to an array, the array is sorted
+ * and the list of the lines is re-linked according to the array. The keys
+ * for the built-in scols_cmpstr_cells() and scols_cmpu64_cells() functions
+ * are strings and numbers compared directly, for another cmpfunc the key is
+ * the cell.
+ */
+enum {
+	SORT_KEY_CELL,
+	SORT_KEY_STR,
+	SORT_KEY_U64
+};
+
+struct sort_item {
+	union {
+		struct libscols_cell *cell;
+		const char *str;
+		uint64_t num;
+	} key;
+	struct libscols_line *ln;
+	int nokey;		/* NULL data or userdata */
+};
+
+struct sort_cxt {
+	struct libscols_column *cl;
+	int keytype;		/* SORT_KEY_* */
+
+	struct sort_item *items;
+	struct sort_item *tmp;
+	size_t size;		/* allocated items */
+};
+
+static void sort_item_set_key(struct sort_cxt *cx, struct sort_item *it,
+			      struct libscols_line *ln)
+{
+	struct libscols_cell *ce = scols_line_get_cell(ln, cx->cl->seqnum);
+
+	it->ln = ln;
+	it->nokey = 0;
+
+	switch (cx->keytype) {
+	case SORT_KEY_STR:
+		it->key.str = scols_cell_get_data(ce);
+		it->nokey = it->key.str == NULL;
+		break;
+	case SORT_KEY_U64:
+	{
+		uint64_t *num = (uint64_t *) scols_cell_get_userdata(ce);
+
+		it->key.num = num ? *num : 0;
+		it->nokey = num == NULL;
+		break;
+	}
+	default:
+		it->key.cell = ce;
+		break;
+	}
+}
+
+static int sort_item_cmp(struct sort_cxt *cx, struct sort_item *a, struct sort_item *b)
 {
-	struct libscols_column *cl = (struct libscols_column *) data;
-	struct libscols_line *ra, *rb;
-	struct libscols_cell *ca, *cb;
+	if (cx->keytype == SORT_KEY_CELL)
+		return cx->cl->cmpfunc(a->key.cell, b->key.cell, cx->cl->cmpfunc_data);
 
-	assert(a);
-	assert(b);
-	assert(cl);
+	/* items without key are the smallest */
+	if (a->nokey || b->nokey)
+		return b->nokey - a->nokey;
 
-	ra = list_entry(a, struct libscols_line, ln_lines);
-	rb = list_entry(b, struct libscols_line, ln_lines);
-	ca = scols_line_get_cell(ra, cl->seqnum);
-	cb = scols_line_get_cell(rb, cl->seqnum);
+	if (cx->keytype == SORT_KEY_STR)
+		return strcmp(a->key.str, b->key.str);
 
-	return cl->cmpfunc(ca, cb, cl->cmpfunc_data);
+	return a->key.num == b->key.num ? 0 : a->key.num > b->key.num ? 1 : -1;
+}
+
+/* stable bottom-up merge sort of cx->items */
+static void sort_items(struct sort_cxt *cx, size_t nitems)
+{
+	struct sort_item *src = cx->items, *dst = cx->tmp;
+	size_t width;
+
+	for (width = 1; width < nitems; width *= 2) {
+		struct sort_item *x;
+		size_t i;
+
+		for (i = 0; i < nitems; i += 2 * width) {
+			size_t a = i, k = i,
+			       mid = min(i + width, nitems),
+			       b = mid,
+			       end = min(i + 2 * width, nitems);
+
+			while (a < mid && b < end) {
+				if (sort_item_cmp(cx, &src[b], &src[a]) < 0)
+					dst[k++] = src[b++];
+				else
+					dst[k++] = src[a++];
+			}
+			while (a < mid)
+				dst[k++] = src[a++];
+			while (b < end)
+				dst[k++] = src[b++];
+		}
+		x = src, src = dst, dst = x;
+	}
+
+	if (src != cx->items)
+		memcpy(cx->items, src, nitems * sizeof(struct sort_item));
+}
+
+/* sorts list of the lines linked by ln_lines (@children = 0) or ln_children */
+static int sort_lines_list(struct sort_cxt *cx, struct list_head *head, int children)
+{
+	struct list_head *p;
+	size_t i, n = 0;
+
+	list_for_each(p, head)
+		n++;
+	if (n < 2)
+		return 0;
+
+	if (n > cx->size) {
+		struct sort_item *items = realloc(cx->items,
+					2 * n * sizeof(struct sort_item));
+		if (!items)
+			return -ENOMEM;
+		cx->items = items;
+		cx->tmp = items + n;
+		cx->size = n;
+	}
+
+	n = 0;
+	list_for_each(p, head) {
+		struct libscols_line *ln = children ?
+			list_entry(p, struct libscols_line, ln_children) :
+			list_entry(p, struct libscols_line, ln_lines);
+
+		sort_item_set_key(cx, &cx->items[n++], ln);
+	}
+
+	sort_items(cx, n);
+
+	INIT_LIST_HEAD(head);
+	for (i = 0; i < n; i++)
+		list_add_tail(children ?
+				&cx->items[i].ln->ln_children :
+				&cx->items[i].ln->ln_lines, head);
+	return 0;
 }
 
 /**
@@ -1070,16 +1316,42 @@ static int cells_cmp_wrapper(struct list_head *a, struct list_head *b, void *dat
  * @tb: table
  * @cl: order by this column
  *
- * Orders the table by the column. See also scols_column_set_cmpfunc().
+ * Orders the table by the column. See also scols_column_set_cmpfunc(). If the
+ * tree is enabled then the children of every line are sorted too.
+ *
+ * The sort is stable, so the table could be ordered by more columns if sorted
+ * by the least significant column first.
  *
  * Returns: 0, a negative value in case of an error.
  */
 int scols_sort_table(struct libscols_table *tb, struct libscols_column *cl)
 {
+	struct sort_cxt cx = { .cl = cl };
+	int rc;
+
 	if (!tb || !cl || !cl->cmpfunc)
 		return -EINVAL;
 
 	DBG(TAB, ul_debugobj(tb, "sorting table"));
-	list_sort(&tb->tb_lines, cells_cmp_wrapper, cl);
-	return 0;
+
+	if (cl->cmpfunc == scols_cmpstr_cells)
+		cx.keytype = SORT_KEY_STR;
+	else if (cl->cmpfunc == scols_cmpu64_cells)
+		cx.keytype = SORT_KEY_U64;
+	else
+		cx.keytype = SORT_KEY_CELL;
+
+	rc = sort_lines_list(&cx, &tb->tb_lines, 0);
+
+	if (!rc && scols_table_is_tree(tb)) {
+		struct libscols_line *ln;
+		struct libscols_iter itr;
+
+		scols_reset_iter(&itr, SCOLS_ITER_FORWARD);
+		while (rc == 0 && scols_table_next_line(tb, &itr, &ln) == 0)
+			rc = sort_lines_list(&cx, &ln->ln_branch, 1);
+	}
+
+	free(cx.items);
+	return rc;
 }
@@ -21,6 +21,7 @@
 #include <string.h>
 #include <termios.h>
 #include <ctype.h>
+#include <sys/uio.h>
 
 #include "mbsalign.h"
 #include "ttyutils.h"
@@ -192,6 +193,173 @@ static int is_last_column(struct libscols_column *cl)
 #define colsep(tb) ((tb)->colsep ? (tb)->colsep : " ")
 #define linesep(tb) ((tb)->linesep ? (tb)->linesep : "\n")
 
+/*
+ * Output
+ *
+ * The output is formatted into a large buffer and the buffer is written to
+ * the file descriptor of the output stream by write() or writev(). This is
+ * much faster than many small stdio calls (every call locks the stream). The
+ * stream is used directly if it has no file descriptor (e.g. open_memstream()),
+ * for the streaming output, or if the buffer cannot be allocated.
+ */
+#define OUTBUF_SIZE	(64 * 1024)
+
+static const char padding[] = "                                "
+			      "                                ";
+
+/* start direct output, called at the begin of the print functions */
+static void out_begin(struct libscols_table *tb)
+{
+	int fd;
+
+	if (tb->outbuf)
+		return;
+	fd = fileno(tb->out);
+	if (fd < 0)
+		return;
+	tb->outbuf = malloc(OUTBUF_SIZE);
+	if (!tb->outbuf)
+		return;
+
+	fflush(tb->out);	/* keep order with the previous output */
+	tb->outfd = fd;
+	tb->outbuf_used = 0;
+	DBG(TAB, ul_debugobj(tb, "direct output to fd %d", fd));
+}
+
+/*
+ * Writes all @iov to the output file descriptor. On error the direct output is
+ * disabled and the rest is written to the stream to set the stream error
+ * indicator for the application (e.g. close_stdout()).
+ */
+static void out_writev(struct libscols_table *tb, struct iovec *iov, int iovcnt)
+{
+	while (iovcnt > 0) {
+		ssize_t ret;
+
+		errno = 0;
+		ret = writev(tb->outfd, iov, iovcnt);
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+			if (errno == EAGAIN) {		/* Try later, *sigh* */
+				xusleep(250000);
+				continue;
+			}
+			DBG(TAB, ul_debugobj(tb, "direct output failed [errno=%d]", errno));
+			for (; iovcnt > 0; iov++, iovcnt--)
+				fwrite(iov->iov_base, 1, iov->iov_len, tb->out);
+			free(tb->outbuf);
+			tb->outbuf = NULL;
+			return;
+		}
+		while (iovcnt > 0 && (size_t) ret >= iov->iov_len) {
+			ret -= iov->iov_len;
+			iov++;
+			iovcnt--;
+		}
+		if (iovcnt > 0) {
+			iov->iov_base = (char *) iov->iov_base + ret;
+			iov->iov_len -= ret;
+		}
+	}
+}
+
+static void out_flush(struct libscols_table *tb)
+{
+	struct iovec iov;
+
+	if (!tb->outbuf || !tb->outbuf_used)
+		return;
+
+	iov.iov_base = tb->outbuf;
+	iov.iov_len = tb->outbuf_used;
+	tb->outbuf_used = 0;
+	out_writev(tb, &iov, 1);
+}
+
+/* flush and stop direct output, called at the end of the print functions */
+static void out_end(struct libscols_table *tb)
+{
+	out_flush(tb);
+	free(tb->outbuf);
+	tb->outbuf = NULL;
+}
+
+static void out_write(struct libscols_table *tb, const char *data, size_t sz)
+{
+	if (!sz)
+		return;
+	if (!tb->outbuf) {
+		fwrite(data, 1, sz, tb->out);
+		return;
+	}
+	if (tb->outbuf_used + sz > OUTBUF_SIZE) {
+		/* write the buffer and the data by one syscall */
+		struct iovec iov[2] = {
+			{ .iov_base = tb->outbuf, .iov_len = tb->outbuf_used },
+			{ .iov_base = (char *) data, .iov_len = sz }
+		};
+		tb->outbuf_used = 0;
+		out_writev(tb, iov, 2);
+		return;
+	}
+	memcpy(tb->outbuf + tb->outbuf_used, data, sz);
+	tb->outbuf_used += sz;
+}
+
+static void out_puts(struct libscols_table *tb, const char *str)
+{
+	if (str)
+		out_write(tb, str, strlen(str));
+}
+
+static void out_putc(struct libscols_table *tb, int c)
+{
+	if (!tb->outbuf) {
+		fputc(c, tb->out);
+		return;
+	}
+	if (tb->outbuf_used == OUTBUF_SIZE)
+		out_flush(tb);
+	if (tb->outbuf)
+		tb->outbuf[tb->outbuf_used++] = c;
+	else
+		fputc(c, tb->out);
+}
+
+/* prints @n spaces */
+static void out_pad(struct libscols_table *tb, size_t n)
+{
+	while (n) {
+		size_t sz = min(n, sizeof(padding) - 1);
+
+		out_write(tb, padding, sz);
+		n -= sz;
+	}
+}
+
+/* careful_write_t callback for the escaping functions from carefulputc.h */
+static void out_write_careful(void *tb, const char *data, size_t sz)
+{
+	out_write((struct libscols_table *) tb, data, sz);
+}
+
+static void out_puts_nonblank(struct libscols_table *tb, const char *data)
+{
+	careful_puts_nonblank(out_write_careful, tb, data);
+}
+
+static void out_puts_quoted(struct libscols_table *tb, const char *data)
+{
+	careful_puts_quoted(out_write_careful, tb, data, 0);
+}
+
+static void out_puts_quoted_json(struct libscols_table *tb, const char *data, int lower)
+{
+	careful_puts_quoted_json(out_write_careful, tb, data, lower ? -1 : 0);
+}
+
 
 static int has_pending_data(struct libscols_table *tb)
 {
@@ -221,7 +389,7 @@ static void print_empty_cell(struct libscols_table *tb,
 		if (!ln->parent) {
 			/* only print symbols->vert if followed by child */
 			if (!list_empty(&ln->ln_branch)) {
-				fputs(tb->symbols->vert, tb->out);
+				out_puts(tb, tb->symbols->vert);
 				len_pad = mbs_safe_width(tb->symbols->vert);
 			}
 		} else {
@@ -236,14 +404,14 @@ static void print_empty_cell(struct libscols_table *tb,
 					buffer_append_data(art, tb->symbols->vert);
 				data = buffer_get_safe_data(art, &len_pad);
 				if (data && len_pad)
-					fputs(data, tb->out);
+					out_puts(tb, data);
 				free_buffer(art);
 			}
 		}
 	}
 	/* fill rest of cell with space */
-	for(; len_pad <= cl->width; ++len_pad)
-		fputc(' ', tb->out);
+	if (len_pad <= cl->width)
+		out_pad(tb, cl->width - len_pad + 1);
 }
 
 
@@ -286,7 +454,7 @@ static void print_newline_padding(struct libscols_table *tb,
 	assert(tb);
 	assert(cl);
 
-	fputs(linesep(tb), tb->out);		/* line break */
+	out_puts(tb, linesep(tb));		/* line break */
 
 	/* fill cells after line break */
 	for (i = 0; i <= (size_t) cl->seqnum; i++)
@@ -348,7 +516,7 @@ static int print_pending_data(
 {
 	const char *color = get_cell_color(tb, cl, ln, ce);
 	size_t width = cl->width, bytes;
-	size_t len = width, i;
+	size_t len = width;
 	char *data;
 
 	if (!cl->pending_data)
@@ -366,32 +534,68 @@ static int print_pending_data(
 	step_pending_data(cl, bytes);
 
 	if (color)
-		fputs(color, tb->out);
-	fputs(data, tb->out);
+		out_puts(tb, color);
+	out_puts(tb, data);
 	if (color)
-		fputs(UL_COLOR_RESET, tb->out);
+		out_puts(tb, UL_COLOR_RESET);
 	free(data);
 
-	for (i = len; i < width; i++)
-		fputc(' ', tb->out);		/* padding */
+	if (len < width)
+		out_pad(tb, width - len);	/* padding */
 
 	if (is_last_column(cl))
 		return 0;
 
-	fputs(colsep(tb), tb->out);		/* columns separator */
+	out_puts(tb, colsep(tb));		/* columns separator */
 	return 0;
 err:
 	free(data);
 	return -errno;
 }
 
+/*
+ * Returns number of cells of the @ce data in safe encoding. The width is
+ * counted only once per print (see tb->print_gen) and cached in the cell;
+ * the cache is not valid for the next print as data referenced by
+ * scols_cell_refer_data() may be modified in-place by applications.
+ *
+ * Printable ASCII strings are not affected by mbs_safe_encode(), so for
+ * such strings the width is the same as the size in bytes.
+ */
+static size_t cell_get_width(struct libscols_table *tb, struct libscols_cell *ce)
+{
+	const char *data = ce ? scols_cell_get_data(ce) : NULL;
+	const char *p;
+
+	if (!data)
+		return 0;
+	if (ce->width_gen == tb->print_gen)
+		return ce->width;
+
+	for (p = data; *p; p++) {
+		if ((unsigned char) *p < 0x20 || (unsigned char) *p > 0x7e)
+			break;
+	}
+
+	ce->is_ascii = *p == '\0';
+	if (ce->is_ascii)
+		ce->width = p - data;
+	else {
+		ce->width = mbs_safe_width(data);
+		if (ce->width == (size_t) -1)	/* ignore broken multibyte strings */
+			ce->width = 0;
+	}
+	ce->width_gen = tb->print_gen;
+	return ce->width;
+}
+
 static int print_data(struct libscols_table *tb,
 		      struct libscols_column *cl,
 		      struct libscols_line *ln,	/* optional */
 		      struct libscols_cell *ce,	/* optional */
 		      struct libscols_buffer *buf)
 {
-	size_t len = 0, i, width, bytes;
+	size_t len = 0, width, bytes;
 	const char *color = NULL;
 	char *data;
 
@@ -408,27 +612,28 @@ static int print_data(struct libscols_table *tb,
 
 	switch (tb->format) {
 	case SCOLS_FMT_RAW:
-		fputs_nonblank(data, tb->out);
+		out_puts_nonblank(tb, data);
 		if (!is_last_column(cl))
-			fputs(colsep(tb), tb->out);
+			out_puts(tb, colsep(tb));
 		return 0;
 
 	case SCOLS_FMT_EXPORT:
-		fprintf(tb->out, "%s=", scols_cell_get_data(&cl->header));
-		fputs_quoted(data, tb->out);
+		out_puts(tb, scols_cell_get_data(&cl->header));
+		out_putc(tb, '=');
+		out_puts_quoted(tb, data);
 		if (!is_last_column(cl))
-			fputs(colsep(tb), tb->out);
+			out_puts(tb, colsep(tb));
 		return 0;
 
 	case SCOLS_FMT_JSON:
-		fputs_quoted_json_lower(scols_cell_get_data(&cl->header), tb->out);
-		fputs(": ", tb->out);
+		out_puts_quoted_json(tb, scols_cell_get_data(&cl->header), 1);
+		out_puts(tb, ": ");
 		if (!data || !*data)
-			fputs("null", tb->out);
+			out_puts(tb, "null");
 		else
-			fputs_quoted_json(data, tb->out);
+			out_puts_quoted_json(tb, data, 0);
 		if (!is_last_column(cl))
-			fputs(", ", tb->out);
+			out_puts(tb, ", ");
 		return 0;
 
 	case SCOLS_FMT_HUMAN:
@@ -438,7 +643,13 @@ static int print_data(struct libscols_table *tb,
 	color = get_cell_color(tb, cl, ln, ce);
 
 	/* encode, note that 'len' and 'width' are number of cells, not bytes */
-	data = buffer_get_safe_data(buf, &len);
+	if (ce && (!ln || !ln->parent || !scols_column_is_tree(cl))
+	    && cell_get_width(tb, ce) && ce->is_ascii) {
+		/* the buffer contains the cell data only, nothing to encode */
+		data = buffer_get_data(buf);
+		len = ce->width;
+	} else
+		data = buffer_get_safe_data(buf, &len);
 	if (!data)
 		data = "";
 	width = cl->width;
@@ -475,12 +686,12 @@ static int print_data(struct libscols_table *tb,
 	if (data) {
 		if (scols_column_is_right(cl)) {
 			if (color)
-				fputs(color, tb->out);
-			for (i = len; i < width; i++)
-				fputc(' ', tb->out);
-			fputs(data, tb->out);
+				out_puts(tb, color);
+			if (len < width)
+				out_pad(tb, width - len);
+			out_puts(tb, data);
 			if (color)
-				fputs(UL_COLOR_RESET, tb->out);
+				out_puts(tb, UL_COLOR_RESET);
 			len = width;
 
 		} else if (color) {
@@ -489,26 +700,27 @@ static int print_data(struct libscols_table *tb,
 
 			/* we don't want to colorize tree ascii art */
 			if (scols_column_is_tree(cl) && art && art < bytes) {
-				fwrite(p, 1, art, tb->out);
+				out_write(tb, p, art);
 				p += art;
 			}
 
-			fputs(color, tb->out);
-			fputs(p, tb->out);
-			fputs(UL_COLOR_RESET, tb->out);
+			out_puts(tb, color);
+			out_puts(tb, p);
+			out_puts(tb, UL_COLOR_RESET);
 		} else
-			fputs(data, tb->out);
+			out_puts(tb, data);
 	}
-	for (i = len; i < width; i++)
-		fputc(' ', tb->out);		/* padding */
+	if (len < width)
+		out_pad(tb, width - len);	/* padding */
 
 	if (is_last_column(cl))
 		return 0;
 
-	if (len > width && !scols_column_is_trunc(cl))
+	if (len > width && !scols_column_is_trunc(cl)
+	    && (tb->is_term || !tb->stream_started))
 		print_newline_padding(tb, cl, ln, buf->bufsz);	/* next column starts on next line */
 	else
-		fputs(colsep(tb), tb->out);		/* columns separator */
+		out_puts(tb, colsep(tb));		/* columns separator */
 
 	return 0;
 }
@@ -559,10 +771,8 @@ static int cell_to_buffer(struct libscols_table *tb,
 
 static void fput_indent(struct libscols_table *tb)
 {
-	int i;
-
-	for (i = 0; i <= tb->indent; i++)
-		fputs("   ", tb->out);
+	if (tb->indent >= 0)
+		out_pad(tb, (tb->indent + 1) * 3);
 }
 
 static void fput_table_open(struct libscols_table *tb)
@@ -570,13 +780,13 @@ static void fput_table_open(struct libscols_table *tb)
 	tb->indent = 0;
 
 	if (scols_table_is_json(tb)) {
-		fputc('{', tb->out);
-		fputs(linesep(tb), tb->out);
+		out_putc(tb, '{');
+		out_puts(tb, linesep(tb));
 
 		fput_indent(tb);
-		fputs_quoted(tb->name, tb->out);
-		fputs(": [", tb->out);
-		fputs(linesep(tb), tb->out);
+		out_puts_quoted(tb, tb->name);
+		out_puts(tb, ": [");
+		out_puts(tb, linesep(tb));
 
 		tb->indent++;
 		tb->indent_last_sep = 1;
@@ -589,11 +799,11 @@ static void fput_table_close(struct libscols_table *tb)
 
 	if (scols_table_is_json(tb)) {
 		fput_indent(tb);
-		fputc(']', tb->out);
+		out_putc(tb, ']');
 		tb->indent--;
-		fputs(linesep(tb), tb->out);
-		fputc('}', tb->out);
-		fputs(linesep(tb), tb->out);
+		out_puts(tb, linesep(tb));
+		out_putc(tb, '}');
+		out_puts(tb, linesep(tb));
 		tb->indent_last_sep = 1;
 	}
 }
@@ -601,13 +811,13 @@ static void fput_table_close(struct libscols_table *tb)
 static void fput_children_open(struct libscols_table *tb)
 {
 	if (scols_table_is_json(tb)) {
-		fputc(',', tb->out);
-		fputs(linesep(tb), tb->out);
+		out_putc(tb, ',');
+		out_puts(tb, linesep(tb));
 		fput_indent(tb);
-		fputs("\"children\": [", tb->out);
+		out_puts(tb, "\"children\": [");
 	}
 	/* between parent and child is separator */
-	fputs(linesep(tb), tb->out);
+	out_puts(tb, linesep(tb));
 	tb->indent_last_sep = 1;
 	tb->indent++;
 }
@@ -618,8 +828,8 @@ static void fput_children_close(struct libscols_table *tb)
 
 	if (scols_table_is_json(tb)) {
 		fput_indent(tb);
-		fputc(']', tb->out);
-		fputs(linesep(tb), tb->out);
+		out_putc(tb, ']');
+		out_puts(tb, linesep(tb));
 		tb->indent_last_sep = 1;
 	}
 }
@@ -628,7 +838,7 @@ static void fput_line_open(struct libscols_table *tb)
 {
 	if (scols_table_is_json(tb)) {
 		fput_indent(tb);
-		fputc('{', tb->out);
+		out_putc(tb, '{');
 		tb->indent_last_sep = 0;
 	}
 	tb->indent++;
@@ -640,10 +850,10 @@ static void fput_line_close(struct libscols_table *tb, int last)
 	if (scols_table_is_json(tb)) {
 		if (tb->indent_last_sep)
 			fput_indent(tb);
-		fputs(last ? "}" : "},", tb->out);
+		out_puts(tb, last ? "}" : "},");
 	}
 	if (!tb->no_linesep)
-		fputs(linesep(tb), tb->out);
+		out_puts(tb, linesep(tb));
 	tb->indent_last_sep = 1;
 }
 
@@ -680,7 +890,7 @@ static int print_line(struct libscols_table *tb,
 	/* extra lines of the multi-line cells */
 	while (rc == 0 && pending) {
 		pending = 0;
-		fputs(linesep(tb), tb->out);
+		out_puts(tb, linesep(tb));
 		scols_reset_iter(&itr, SCOLS_ITER_FORWARD);
 		while (rc == 0 && scols_table_next_column(tb, &itr, &cl) == 0) {
 			if (scols_column_is_hidden(cl))
@@ -755,13 +965,13 @@ static int print_title(struct libscols_table *tb)
 	}
 
 	if (tb->title.color)
-		fputs(tb->title.color, tb->out);
+		out_puts(tb, tb->title.color);
 
-	fputs(title, tb->out);
+	out_puts(tb, title);
 
 	if (tb->title.color)
-		fputs(UL_COLOR_RESET, tb->out);
-	fputc('\n', tb->out);
+		out_puts(tb, UL_COLOR_RESET);
+	out_putc(tb, '\n');
 	rc = 0;
 done:
 	free(buf);
@@ -797,7 +1007,7 @@ static int print_header(struct libscols_table *tb, struct libscols_buffer *buf)
 	}
 
 	if (rc == 0)
-		fputs(linesep(tb), tb->out);
+		out_puts(tb, linesep(tb));
 
 	tb->header_printed = 1;
 	return rc;
@@ -959,7 +1169,7 @@ static int count_column_width(struct libscols_table *tb,
 		if (cl->width_hint < 1 && scols_table_is_maxout(tb))
 			cl->width_min = (size_t) (cl->width_hint * tb->termwidth) - (is_last_column(cl) ? 0 : 1);
 		if (scols_cell_get_data(&cl->header)) {
-			size_t len = mbs_safe_width(scols_cell_get_data(&cl->header));
+			size_t len = cell_get_width(tb, &cl->header);
 			cl->width_min = max(cl->width_min, len);
 		}
 	}
@@ -967,17 +1177,21 @@ static int count_column_width(struct libscols_table *tb,
 	scols_reset_iter(&itr, SCOLS_ITER_FORWARD);
 	while (scols_table_next_line(tb, &itr, &ln) == 0) {
 		size_t len;
-		char *data;
 
-		rc = cell_to_buffer(tb, ln, cl, buf);
-		if (rc)
-			goto done;
+		if (scols_column_is_tree(cl)) {
+			char *data;
 
-		data = buffer_get_data(buf);
-		len = data ? mbs_safe_width(data) : 0;
+			rc = cell_to_buffer(tb, ln, cl, buf);
+			if (rc)
+				goto done;
+
+			data = buffer_get_data(buf);
+			len = data ? mbs_safe_width(data) : 0;
 
-		if (len == (size_t) -1)		/* ignore broken multibyte strings */
-			len = 0;
+			if (len == (size_t) -1)		/* ignore broken multibyte strings */
+				len = 0;
+		} else
+			len = cell_get_width(tb, scols_line_get_cell(ln, cl->seqnum));
 		cl->width_max = max(len, cl->width_max);
 
 		if (cl->is_extreme && len > cl->width_avg * 2)
@@ -1009,6 +1223,17 @@ static int count_column_width(struct libscols_table *tb,
 
 		cl->width = (size_t) cl->width_hint;
 
+	/* the streaming output does not see all data, the hint is minimum */
+	if (tb->streaming) {
+		size_t hint = 0;
+
+		if (cl->width_hint >= 1)
+			hint = (size_t) cl->width_hint;
+		else if (tb->is_term)
+			hint = (size_t) (cl->width_hint * tb->termwidth);
+		if (cl->width < hint)
+			cl->width = hint;
+	}
 done:
 	ON_DBG(COL, dbg_column(tb, cl));
 	return rc;
@@ -1236,33 +1461,15 @@ static size_t strlen_line(struct libscols_line *ln)
 	return sz;
 }
 
-static int initialize_printing(struct libscols_table *tb, struct libscols_buffer **buf)
+/*
+ * Estimate extra space necessary for tree, JSON or another output
+ * decoration.
+ */
+static size_t count_extra_bufsz(struct libscols_table *tb)
 {
-	size_t bufsz, extra_bufsz = 0;
-	struct libscols_line *ln;
+	size_t extra_bufsz = 0;
 	struct libscols_iter itr;
-	int rc;
 
-	DBG(TAB, ul_debugobj(tb, "initialize printing"));
-
-	if (!tb->symbols)
-		scols_table_set_symbols(tb, NULL);	/* use default */
-
-	if (tb->format == SCOLS_FMT_HUMAN)
-		tb->is_term = isatty(STDOUT_FILENO) ? 1 : 0;
-
-	if (tb->is_term) {
-		tb->termwidth = get_terminal_width(80);
-		if (tb->termreduce > 0 && tb->termreduce < tb->termwidth)
-			tb->termwidth -= tb->termreduce;
-		bufsz = tb->termwidth;
-	} else
-		bufsz = BUFSIZ;
-
-	/*
-	 * Estimate extra space necessary for tree, JSON or another output
-	 * decoration.
-	 */
 	if (scols_table_is_tree(tb))
 		extra_bufsz += tb->nlines * strlen(tb->symbols->vert);
 
@@ -1292,6 +1499,38 @@ static int initialize_printing(struct libscols_table *tb, struct libscols_buffer
 		break;
 	}
 
+	return extra_bufsz;
+}
+
+static int initialize_printing(struct libscols_table *tb, struct libscols_buffer **buf)
+{
+	size_t bufsz, extra_bufsz;
+	struct libscols_line *ln;
+	struct libscols_iter itr;
+	int rc;
+
+	DBG(TAB, ul_debugobj(tb, "initialize printing"));
+
+	if (!tb->symbols)
+		scols_table_set_symbols(tb, NULL);	/* use default */
+
+	/* invalidate cached cell widths, zero is never valid generation */
+	if (++tb->print_gen == 0)
+		tb->print_gen = 1;
+
+	if (tb->format == SCOLS_FMT_HUMAN)
+		tb->is_term = isatty(STDOUT_FILENO) ? 1 : 0;
+
+	if (tb->is_term) {
+		tb->termwidth = get_terminal_width(80);
+		if (tb->termreduce > 0 && tb->termreduce < tb->termwidth)
+			tb->termwidth -= tb->termreduce;
+		bufsz = tb->termwidth;
+	} else
+		bufsz = BUFSIZ;
+
+	extra_bufsz = count_extra_bufsz(tb);
+
 	/*
 	 * Enlarge buffer if necessary, the buffer should be large enough to
 	 * store line data and tree ascii art (or another decoration).
@@ -1319,6 +1558,94 @@ err:
 	return rc;
 }
 
+/*
+ * Streaming output, see scols_table_enable_streaming().
+ *
+ * The widths are counted by initialize_printing() from the lines in the table
+ * when the streaming starts (stream_sample lines and the new empty line) and
+ * they are never updated later. The buffer is enlarged for longer lines.
+ */
+static int stream_start(struct libscols_table *tb)
+{
+	int rc;
+
+	DBG(TAB, ul_debugobj(tb, "start streaming"));
+
+	tb->header_printed = 0;
+	rc = initialize_printing(tb, &tb->stream_buf);
+	if (rc) {
+		tb->stream_buf = NULL;
+		return rc;
+	}
+	tb->stream_started = 1;
+
+	fput_table_open(tb);
+
+	if (tb->format == SCOLS_FMT_HUMAN)
+		print_title(tb);
+
+	return print_header(tb, tb->stream_buf);
+}
+
+/* prints and removes lines, the last line is kept if @all is zero */
+static int stream_lines(struct libscols_table *tb, int all)
+{
+	int rc = 0;
+
+	while (rc == 0 && !list_empty(&tb->tb_lines)) {
+		struct libscols_line *ln = list_entry(tb->tb_lines.next,
+					struct libscols_line, ln_lines);
+		int last = ln->ln_lines.next == &tb->tb_lines;
+		size_t sz;
+
+		if (last && !all)
+			break;
+
+		sz = strlen_line(ln) + count_extra_bufsz(tb);
+		if (sz >= tb->stream_buf->bufsz) {
+			free_buffer(tb->stream_buf);
+			tb->stream_buf = new_buffer(sz + 1);
+			if (!tb->stream_buf)
+				return -ENOMEM;
+		}
+
+		fput_line_open(tb);
+		rc = print_line(tb, ln, tb->stream_buf);
+		fput_line_close(tb, last);
+
+		scols_table_remove_line(tb, ln);
+	}
+
+	return rc;
+}
+
+/* called by scols_table_add_line() */
+int scols_table_print_stream(struct libscols_table *tb)
+{
+	int rc = 0;
+
+	assert(tb);
+	assert(tb->streaming);
+
+	if (!tb->stream_started) {
+		if (scols_table_is_tree(tb))
+			return 0;	/* unsupported, printed by scols_print_table() */
+		if (tb->format == SCOLS_FMT_HUMAN && tb->nlines <= tb->stream_sample)
+			return 0;	/* wait for complete sample */
+		rc = stream_start(tb);
+	}
+	if (!rc)
+		rc = stream_lines(tb, 0);
+	return rc;
+}
+
+void scols_table_free_stream(struct libscols_table *tb)
+{
+	free_buffer(tb->stream_buf);
+	tb->stream_buf = NULL;
+	tb->stream_started = 0;
+}
+
 /**
  * scola_table_print_range:
  * @tb: table
@@ -1338,7 +1665,7 @@ int scols_table_print_range(	struct libscols_table *tb,
 	struct libscols_iter itr;
 	int rc;
 
-	if (scols_table_is_tree(tb))
+	if (scols_table_is_tree(tb) || (tb && tb->stream_started))
 		return -EINVAL;
 
 	DBG(TAB, ul_debugobj(tb, "printing range"));
@@ -1354,6 +1681,8 @@ int scols_table_print_range(	struct libscols_table *tb,
 	} else
 		scols_reset_iter(&itr, SCOLS_ITER_FORWARD);
 
+	out_begin(tb);
+
 	if (!start || itr.p == tb->tb_lines.next) {
 		rc = print_header(tb, buf);
 		if (rc)
@@ -1362,6 +1691,7 @@ int scols_table_print_range(	struct libscols_table *tb,
 
 	rc = print_range(tb, buf, &itr, end);
 done:
+	out_end(tb);
 	free_buffer(buf);
 	return rc;
 }
@@ -1428,6 +1758,16 @@ int scols_print_table(struct libscols_table *tb)
 
 	DBG(TAB, ul_debugobj(tb, "printing"));
 
+	if (tb->stream_started) {
+		/* print the rest of the streaming output */
+		out_begin(tb);
+		rc = stream_lines(tb, 1);
+		fput_table_close(tb);
+		out_end(tb);
+		scols_table_free_stream(tb);
+		return rc;
+	}
+
 	if (list_empty(&tb->tb_lines)) {
 		DBG(TAB, ul_debugobj(tb, "ignore -- empty table"));
 		return 0;
@@ -1438,6 +1778,7 @@ int scols_print_table(struct libscols_table *tb)
 	if (rc)
 		return rc;
 
+	out_begin(tb);
 	fput_table_open(tb);
 
 	if (tb->format == SCOLS_FMT_HUMAN)
@@ -1454,6 +1795,7 @@ int scols_print_table(struct libscols_table *tb)
 
 	fput_table_close(tb);
 done:
+	out_end(tb);
 	free_buffer(buf);
 	return rc;
 }
@@ -27,6 +27,7 @@
 
 #define LOWPROBE_TOPOLOGY	(1 << 1)
 #define LOWPROBE_SUPERBLOCKS	(1 << 2)
+#define LOWPROBE_STATS		(1 << 3)
 
 #define BLKID_EXIT_NOTFOUND	2	/* token or device not found */
 #define BLKID_EXIT_OTHER	4	/* bad usage or other error */
@@ -90,6 +91,10 @@ static void usage(int error)
 		" -O <offset> probe at the given offset\n"
 		" -u <list>   filter by \"usage\" (e.g. -u filesystem,raid)\n"
 		" -n <list>   filter by filesystem type (e.g. -n vfat,ext3)\n"
+		" --stats     print I/O and time statistic for every device\n"
+		"\nCache options:\n"
+		" --cache-format <text|binary>\n"
+		"             convert the cache file to the given format\n"
 		"\n", program_invocation_short_name);
 
 	exit(error);
@@ -472,6 +477,45 @@ static int lowprobe_topology(blkid_probe pr)
 	return blkid_do_fullprobe(pr);
 }
 
+static void print_stats(blkid_probe pr, const char *devname)
+{
+	static const char *chains[] = { "topology", "superblocks", "partitions" };
+	uint64_t hits = 0, misses = 0, bytes = 0;
+	size_t i;
+
+	if (blkid_probe_get_buffers_stat(pr, &hits, &misses, &bytes))
+		return;
+
+	fprintf(stderr, "%s: buffers: %ju hits, %ju misses, %ju bytes read\n",
+			devname, (uintmax_t) hits, (uintmax_t) misses,
+			(uintmax_t) bytes);
+
+	for (i = 0; i < ARRAY_SIZE(chains); i++) {
+		const char *name;
+		uint64_t usec, reads;
+		size_t idx;
+
+		if (blkid_probe_get_chain_stats(pr, chains[i], &usec, &reads,
+						&bytes, &hits) != 0)
+			continue;
+		if (!usec && !reads && !hits)
+			continue;	/* chain not used */
+
+		fprintf(stderr, "%s: %s: %ju usec, %ju reads, %ju bytes, %ju hits\n",
+			devname, chains[i], (uintmax_t) usec, (uintmax_t) reads,
+			(uintmax_t) bytes, (uintmax_t) hits);
+
+		for (idx = 0; blkid_probe_get_prober_stats(pr, chains[i], idx,
+				&name, &usec, &reads, &bytes, &hits) == 0; idx++) {
+			if (!usec && !reads && !hits)
+				continue;
+			fprintf(stderr, "%s:   %s: %ju usec, %ju reads, %ju bytes, %ju hits\n",
+				devname, name, (uintmax_t) usec, (uintmax_t) reads,
+				(uintmax_t) bytes, (uintmax_t) hits);
+		}
+	}
+}
+
 static int lowprobe_device(blkid_probe pr, const char *devname,
 			int chain, char *show[], int output,
 			uint64_t offset, uint64_t size)
@@ -496,6 +540,8 @@ static int lowprobe_device(blkid_probe pr, const char *devname,
 		rc = lowprobe_topology(pr);
 	if (rc >= 0 && (chain & LOWPROBE_SUPERBLOCKS))
 		rc = lowprobe_superblocks(pr);
+	if (chain & LOWPROBE_STATS)
+		print_stats(pr, devname);
 	if (rc < 0)
 		goto done;
 
@@ -648,6 +694,20 @@ int main(int argc, char **argv)
 	int c;
 	uintmax_t offset = 0, size = 0;
 
+	int cache_format = -1;
+
+	enum {
+		OPT_STATS = CHAR_MAX + 1,
+		OPT_CACHE_FORMAT
+	};
+	static const struct option longopts[] = {
+		{ "stats",   no_argument, NULL, OPT_STATS },
+		{ "cache-format", required_argument, NULL, OPT_CACHE_FORMAT },
+		{ "help",    no_argument, NULL, 'h' },
+		{ "version", no_argument, NULL, 'V' },
+		{ NULL, 0, NULL, 0 }
+	};
+
 	static const ul_excl_t excl[] = {       /* rows and cols in in ASCII order */
 		{ 'n','u' },
 		{ 0 }
@@ -657,8 +717,8 @@ int main(int argc, char **argv)
 	show[0] = NULL;
 	atexit(close_stdout);
 
-	while ((c = getopt (argc, argv,
-			    "c:df:ghilL:n:ko:O:ps:S:t:u:U:w:Vv")) != EOF) {
+	while ((c = getopt_long (argc, argv,
+			    "c:df:ghilL:n:ko:O:ps:S:t:u:U:w:Vv", longopts, NULL)) != EOF) {
 
 		err_exclusive_options(c, NULL, excl, excl_st);
 
@@ -740,6 +800,20 @@ int main(int argc, char **argv)
 			show[numtag++] = optarg;
 			show[numtag] = NULL;
 			break;
+		case OPT_STATS:
+			lowprobe |= LOWPROBE_STATS;
+			break;
+		case OPT_CACHE_FORMAT:
+			if (!strcmp(optarg, "text"))
+				cache_format = BLKID_CACHE_TEXT;
+			else if (!strcmp(optarg, "binary"))
+				cache_format = BLKID_CACHE_BINARY;
+			else {
+				fprintf(stderr, "Invalid cache format %s. "
+					"Choose from text or binary\n", optarg);
+				exit(BLKID_EXIT_OTHER);
+			}
+			break;
 		case 'S':
 			size = strtosize_or_err(optarg, "invalid size argument");
 			break;
@@ -794,6 +868,18 @@ int main(int argc, char **argv)
 	if (!lowprobe && !eval && blkid_get_cache(&cache, read) < 0)
 		goto exit;
 
+	if (cache_format >= 0) {
+		if (lowprobe || eval) {
+			fprintf(stderr, "The --cache-format option is "
+					"incompatible with -p, -i, -L and -U\n");
+			goto exit;
+		}
+		/* the cache is written in the new format by blkid_put_cache() */
+		if (blkid_cache_set_format(cache, cache_format) == 0)
+			err = 0;
+		goto exit;
+	}
+
 	if (gc) {
 		blkid_gc_cache(cache);
 		err = 0;
@@ -810,6 +896,11 @@ int main(int argc, char **argv)
 		pretty_print_dev(NULL);
 	}
 
+	if (lowprobe == LOWPROBE_STATS) {
+		fprintf(stderr, "The --stats option requires -p or -i\n");
+		exit(BLKID_EXIT_OTHER);
+	}
+
 	if (lowprobe) {
 		/*
 		 * Low-level API
@@ -829,6 +920,8 @@ int main(int argc, char **argv)
 		pr = blkid_new_probe();
 		if (!pr)
 			goto exit;
+		if (lowprobe & LOWPROBE_STATS)
+			blkid_probe_enable_stats(pr, 1);
 
 		if (lowprobe & LOWPROBE_SUPERBLOCKS) {
 			blkid_probe_set_superblocks_flags(pr,
@@ -823,6 +823,28 @@ static char **append_pid_tabfile(char **files, int *nfiles, pid_t pid)
 	return append_tabfile(files, nfiles, path);
 }
 
+/*
+ * For --target <path> read only possible mountpoints of the path, other lines
+ * are ignored by libmount parser.
+ */
+static void set_target_prefilter(struct libmnt_table *tb, int tabtype)
+{
+	const char *tgt = get_match(COL_TARGET);
+	char *cn = NULL;
+
+	if (!tgt || tabtype == TABTYPE_FSTAB
+	    || !(flags & FL_NOSWAPMATCH)
+	    || (flags & (FL_SUBMOUNTS | FL_POLL | FL_TREE)))
+		return;
+
+	if (!(flags & FL_NOCACHE))
+		tgt = cn = mnt_resolve_path(tgt, NULL);
+	if (tgt && *tgt == '/')
+		mnt_table_set_parser_prefilter(tb, MNT_PREFILTER_MOUNTPOINT,
+					       tgt, NULL, 0);
+	free(cn);
+}
+
 /* calls libmount fstab/mtab/mountinfo parser */
 static struct libmnt_table *parse_tabfiles(char **files,
 					   int nfiles,
@@ -837,6 +859,7 @@ static struct libmnt_table *parse_tabfiles(char **files,
 		return NULL;
 	}
 	mnt_table_set_parser_errcb(tb, parser_errcb);
+	set_target_prefilter(tb, tabtype);
 
 	do {
 		/* NULL means that libmount will use default paths */
@@ -1090,16 +1113,9 @@ static int poll_table(struct libmnt_table *tb, const char *tabfile,
 	FILE *f = NULL;
 	int rc = -1;
 	struct libmnt_iter *itr = NULL;
-	struct libmnt_table *tb_new = NULL;
 	struct libmnt_tabdiff *diff = NULL;
 	struct pollfd fds[1];
 
-	tb_new = mnt_new_table();
-	if (!tb_new) {
-		warn(_("failed to initialize libmount table"));
-		goto done;
-	}
-
 	itr = mnt_new_iter(direction);
 	if (!itr) {
 		warn(_("failed to initialize libmount iterator"));
@@ -1114,7 +1130,6 @@ static int poll_table(struct libmnt_table *tb, const char *tabfile,
 
 	/* cache is unnecessary to detect changes */
 	mnt_table_set_cache(tb, NULL);
-	mnt_table_set_cache(tb_new, NULL);
 
 	f = fopen(tabfile, "r");
 	if (!f) {
@@ -1122,13 +1137,10 @@ static int poll_table(struct libmnt_table *tb, const char *tabfile,
 		goto done;
 	}
 
-	mnt_table_set_parser_errcb(tb_new, parser_errcb);
-
 	fds[0].fd = fileno(f);
 	fds[0].events = POLLPRI;
 
 	while (1) {
-		struct libmnt_table *tmp;
 		struct libmnt_fs *old, *new;
 		int change, count;
 
@@ -1140,10 +1152,8 @@ static int poll_table(struct libmnt_table *tb, const char *tabfile,
 			goto done;
 		}
 
-		rewind(f);
-		rc = mnt_table_parse_stream(tb_new, f, tabfile);
-		if (!rc)
-			rc = mnt_diff_tables(diff, tb, tb_new);
+		/* update @tb, only the changed lines are parsed */
+		rc = mnt_table_refresh(tb, tabfile, diff);
 		if (rc < 0)
 			goto done;
 
@@ -1170,14 +1180,8 @@ static int poll_table(struct libmnt_table *tb, const char *tabfile,
 				goto done;
 		}
 
-		/* swap tables */
-		tmp = tb;
-		tb = tb_new;
-		tb_new = tmp;
-
 		/* remove already printed lines to reduce memory usage */
 		scols_table_remove_lines(table);
-		mnt_reset_table(tb_new);
 
 		if (count && (flags & FL_FIRSTONLY))
 			break;
@@ -1185,7 +1189,6 @@ static int poll_table(struct libmnt_table *tb, const char *tabfile,
 
 	rc = 0;
 done:
-	mnt_unref_table(tb_new);
 	mnt_free_tabdiff(diff);
 	mnt_free_iter(itr);
 	if (f)
@@ -1592,22 +1592,6 @@ static void parse_includes(const char *str0)
 /*
  * see set_sortdata_u64() and columns initialization in main()
  */
-static int cmp_u64_cells(struct libscols_cell *a,
-			 struct libscols_cell *b,
-			 __attribute__((__unused__)) void *data)
-{
-	uint64_t *adata = (uint64_t *) scols_cell_get_userdata(a),
-		 *bdata = (uint64_t *) scols_cell_get_userdata(b);
-
-	if (adata == NULL && bdata == NULL)
-		return 0;
-	if (adata == NULL)
-		return -1;
-	if (bdata == NULL)
-		return 1;
-	return *adata == *bdata ? 0 : *adata >= *bdata ? 1 : -1;
-}
-
 static void __attribute__((__noreturn__)) help(FILE *out)
 {
 	size_t i;
@@ -1872,6 +1856,8 @@ int main(int argc, char *argv[])
 	scols_table_enable_ascii(lsblk->table, !!(scols_flags & LSBLK_ASCII));
 	scols_table_enable_json(lsblk->table, !!(scols_flags & LSBLK_JSON));
 	scols_table_enable_noheadings(lsblk->table, !!(scols_flags & LSBLK_NOHEADINGS));
+	/* all lines live until scols_unref_table(), allocate them at once */
+	scols_table_enable_arena(lsblk->table, 1);
 
 	if (scols_flags & LSBLK_JSON)
 		scols_table_set_name(lsblk->table, "blockdevices");
@@ -1895,7 +1881,7 @@ int main(int argc, char *argv[])
 			lsblk->sort_col = cl;
 			scols_column_set_cmpfunc(cl,
 				ci->sort_type == SORT_STRING ?
-				scols_cmpstr_cells : cmp_u64_cells, NULL);
+				scols_cmpstr_cells : scols_cmpu64_cells, NULL);
 		}
 	}
 
@@ -751,6 +751,8 @@ static void __attribute__((__noreturn__)) usage(FILE *out)
 	" -F, --fork              fork off for each device (use with -a)\n"
 	" -T, --fstab <path>      alternative file to /etc/fstab\n"));
 	fprintf(out, _(
+	"     --parallel <num>    mount up to <num> filesystems at once (use with -a)\n"));
+	fprintf(out, _(
 	" -i, --internal-only     don't call the mount.<type> helpers\n"));
 	fprintf(out, _(
 	" -l, --show-labels       show also filesystem labels\n"));
@@ -828,7 +830,8 @@ int main(int argc, char **argv)
 		MOUNT_OPT_RPRIVATE,
 		MOUNT_OPT_RUNBINDABLE,
 		MOUNT_OPT_TARGET,
-		MOUNT_OPT_SOURCE
+		MOUNT_OPT_SOURCE,
+		MOUNT_OPT_PARALLEL
 	};
 
 	static const struct option longopts[] = {
@@ -865,11 +868,13 @@ int main(int argc, char **argv)
 		{ "show-labels", 0, 0, 'l' },
 		{ "target", 1, 0, MOUNT_OPT_TARGET },
 		{ "source", 1, 0, MOUNT_OPT_SOURCE },
+		{ "parallel", 1, 0, MOUNT_OPT_PARALLEL },
 		{ NULL, 0, 0, 0 }
 	};
 
 	static const ul_excl_t excl[] = {       /* rows and cols in in ASCII order */
 		{ 'B','M','R' },			/* bind,move,rbind */
+		{ 'F', MOUNT_OPT_PARALLEL },		/* fork,parallel */
 		{ 'L','U', MOUNT_OPT_SOURCE },	/* label,uuid,source */
 		{ 0 }
 	};
@@ -1016,6 +1021,15 @@ int main(int argc, char **argv)
 			mnt_context_disable_swapmatch(cxt, 1);
 			mnt_context_set_source(cxt, optarg);
 			break;
+		case MOUNT_OPT_PARALLEL:
+		{
+			int32_t n = strtos32_or_err(optarg,
+					_("invalid number of parallel mounts"));
+			if (n < 0 || mnt_context_set_parallel(cxt, n) != 0)
+				errx(MOUNT_EX_USAGE, _("invalid number of parallel mounts: '%s'"),
+						optarg);
+			break;
+		}
 		default:
 			usage(stderr);
 			break;
@@ -50,54 +50,61 @@ struct mountpoint_control {
 		quiet:1;
 };
 
-static int dir_to_device(struct mountpoint_control *ctl)
+/* called by mountinfo parser for the entries with the same target */
+static int mountinfo_entry_cb(struct libmnt_table *tb __attribute__((__unused__)),
+			      struct libmnt_fs *fs, void *data)
 {
-	struct libmnt_table *tb = mnt_new_table_from_file(_PATH_PROC_MOUNTINFO);
-	struct libmnt_fs *fs;
-	struct libmnt_cache *cache;
-	int rc = -1;
-
-	if (!tb) {
-		/*
-		 * Fallback. Traditional way to detect mountpoints. This way
-		 * is independent on /proc, but not able to detect bind mounts.
-		 */
-		struct stat pst;
-		char buf[PATH_MAX], *cn;
-		int len;
-
-		cn = mnt_resolve_path(ctl->path, NULL);	/* canonicalize */
-
-		len = snprintf(buf, sizeof(buf), "%s/..", cn ? cn : ctl->path);
-		free(cn);
+	struct mountpoint_control *ctl = (struct mountpoint_control *) data;
 
-		if (len < 0 || (size_t) len >= sizeof(buf))
-			return -1;
-		if (stat(buf, &pst) !=0)
-			return -1;
+	/* the last entry (the top-level mount) wins */
+	ctl->dev = mnt_fs_get_devno(fs);
+	return 0;
+}
 
-		if ((ctl->st.st_dev != pst.st_dev) ||
-		    (ctl->st.st_dev == pst.st_dev && ctl->st.st_ino == pst.st_ino)) {
-			ctl->dev = ctl->st.st_dev;
-			return 0;
-		}
+static int dir_to_device(struct mountpoint_control *ctl)
+{
+	struct libmnt_table *tb = mnt_new_table();
+	struct stat pst;
+	char buf[PATH_MAX], *cn = NULL;
+	int rc = -1, len;
+
+	/*
+	 * Don't parse all mountinfo, the parser ignores unrelated lines and
+	 * entries are not stored in the table.
+	 */
+	cn = mnt_resolve_path(ctl->path, NULL);	/* canonicalize */
+	if (tb && cn) {
+		ctl->dev = (dev_t) -1;
+		mnt_table_set_parser_prefilter(tb, MNT_PREFILTER_TARGET, cn, NULL, 0);
+		mnt_table_set_parser_streamcb(tb, mountinfo_entry_cb, ctl);
+		rc = mnt_table_parse_file(tb, _PATH_PROC_MOUNTINFO);
+	}
+	mnt_unref_table(tb);
 
-		return -1;
+	if (rc == 0) {
+		free(cn);
+		return ctl->dev == (dev_t) -1 ? -1 : 0;
 	}
 
-	/* to canonicalize all necessary paths */
-	cache = mnt_new_cache();
-	mnt_table_set_cache(tb, cache);
-	mnt_unref_cache(cache);
+	/*
+	 * Fallback. Traditional way to detect mountpoints. This way
+	 * is independent on /proc, but not able to detect bind mounts.
+	 */
+	len = snprintf(buf, sizeof(buf), "%s/..", cn ? cn : ctl->path);
+	free(cn);
 
-	fs = mnt_table_find_target(tb, ctl->path, MNT_ITER_BACKWARD);
-	if (fs && mnt_fs_get_target(fs)) {
-		ctl->dev = mnt_fs_get_devno(fs);
-		rc = 0;
+	if (len < 0 || (size_t) len >= sizeof(buf))
+		return -1;
+	if (stat(buf, &pst) !=0)
+		return -1;
+
+	if ((ctl->st.st_dev != pst.st_dev) ||
+	    (ctl->st.st_dev == pst.st_dev && ctl->st.st_ino == pst.st_ino)) {
+		ctl->dev = ctl->st.st_dev;
+		return 0;
 	}
 
-	mnt_unref_table(tb);
-	return rc;
+	return -1;
 }
 
 static int print_devno(const struct mountpoint_control *ctl)
@@ -38,6 +38,7 @@
 #include "pathnames.h"
 #include "canonicalize.h"
 #include "xalloc.h"
+#include "strutils.h"
 
 static int table_parser_errcb(struct libmnt_table *tb __attribute__((__unused__)),
 			const char *filename, int line)
@@ -92,6 +93,8 @@ static void __attribute__((__noreturn__)) usage(FILE *out)
 	fputs(_(" -n, --no-mtab           don't write to /etc/mtab\n"), out);
 	fputs(_(" -l, --lazy              detach the filesystem now, clean up things later\n"), out);
 	fputs(_(" -O, --test-opts <list>  limit the set of filesystems (use with -a)\n"), out);
+	fputs(_("     --parallel <num>    unmount up to <num> filesystems at once\n"
+	        "                           (use with -a or -R)\n"), out);
 	fputs(_(" -R, --recursive         recursively unmount a target with all its children\n"), out);
 	fputs(_(" -r, --read-only         in case unmounting fails, try to remount read-only\n"), out);
 	fputs(_(" -t, --types <list>      limit the set of filesystem types\n"), out);
@@ -387,6 +390,86 @@ done:
 	return rc;
 }
 
+/*
+ * Adds a copy of @fs and all its submounts from @tb to @sub.
+ */
+static int add_subtree(struct libmnt_table *tb, struct libmnt_fs *fs,
+		       struct libmnt_table *sub)
+{
+	struct libmnt_fs *child, *x;
+	struct libmnt_iter *itr;
+	int rc = 0;
+
+	if (mnt_table_find_id(sub, mnt_fs_get_id(fs)))
+		return 0;		/* already added */
+
+	x = mnt_copy_fs(NULL, fs);
+	if (!x || mnt_table_add_fs(sub, x) != 0)
+		err(MOUNT_EX_SYSERR, _("failed to allocate filesystem"));
+	mnt_unref_fs(x);
+
+	itr = mnt_new_iter(MNT_ITER_BACKWARD);
+	if (!itr)
+		err(MOUNT_EX_SYSERR, _("libmount iterator allocation failed"));
+
+	while (rc == 0) {
+		rc = mnt_table_next_child_fs(tb, itr, fs, &child);
+		if (rc < 0) {
+			warnx(_("failed to get child fs of %s"),
+					mnt_fs_get_target(fs));
+			break;
+		} else if (rc == 1) {
+			rc = 0;
+			break;		/* no more children */
+		}
+		rc = add_subtree(tb, child, sub);
+	}
+
+	mnt_free_iter(itr);
+	return rc;
+}
+
+/*
+ * Unmounts all filesystems from @sub in parallel, children always before
+ * the parent. Unlike umount_do_recurse() an error does not stop umount of the
+ * other branches of the tree.
+ */
+static int umount_subtrees(struct libmnt_context *cxt, struct libmnt_table *sub)
+{
+	struct libmnt_iter *itr;
+	struct libmnt_fs *fs;
+	int mntrc, rc = MOUNT_EX_SUCCESS;
+
+	itr = mnt_new_iter(MNT_ITER_BACKWARD);
+	if (!itr)
+		err(MOUNT_EX_SYSERR, _("libmount iterator allocation failed"));
+
+	mnt_context_set_mtab(cxt, sub);
+
+	while (mnt_context_next_umount(cxt, itr, &fs, &mntrc, NULL) == 0) {
+		int xrc = mk_exit_code(cxt, mntrc);
+
+		if (xrc == MOUNT_EX_SUCCESS && mnt_context_is_verbose(cxt))
+			success_message(cxt);
+		rc |= xrc;
+	}
+
+	mnt_context_set_mtab(cxt, NULL);
+	mnt_reset_context(cxt);
+	mnt_free_iter(itr);
+	return rc;
+}
+
+static struct libmnt_table *new_subtrees_table(void)
+{
+	struct libmnt_table *sub = mnt_new_table();
+
+	if (!sub)
+		err(MOUNT_EX_SYSERR, _("libmount table allocation failed"));
+	mnt_table_enable_index(sub, 1);
+	return sub;
+}
+
 static int umount_recursive(struct libmnt_context *cxt, const char *spec)
 {
 	struct libmnt_table *tb;
@@ -401,7 +484,13 @@ static int umount_recursive(struct libmnt_context *cxt, const char *spec)
 	mnt_context_disable_swapmatch(cxt, 1);
 
 	fs = mnt_table_find_target(tb, spec, MNT_ITER_BACKWARD);
-	if (fs)
+	if (fs && mnt_context_get_parallel(cxt)) {
+		struct libmnt_table *sub = new_subtrees_table();
+
+		rc = add_subtree(tb, fs, sub);
+		rc = rc ? MOUNT_EX_SOFTWARE : umount_subtrees(cxt, sub);
+		mnt_unref_table(sub);
+	} else if (fs)
 		rc = umount_do_recurse(cxt, tb, fs);
 	else {
 		rc = MOUNT_EX_USAGE;
@@ -417,7 +506,7 @@ static int umount_recursive(struct libmnt_context *cxt, const char *spec)
 static int umount_alltargets(struct libmnt_context *cxt, const char *spec, int rec)
 {
 	struct libmnt_fs *fs;
-	struct libmnt_table *tb;
+	struct libmnt_table *tb, *sub = NULL;
 	struct libmnt_iter *itr = NULL;
 	dev_t devno = 0;
 	int rc;
@@ -459,11 +548,17 @@ static int umount_alltargets(struct libmnt_context *cxt, const char *spec, int r
 
 	mnt_reset_context(cxt);
 
+	/* umount all the trees at once */
+	if (rec && mnt_context_get_parallel(cxt))
+		sub = new_subtrees_table();
+
 	while (mnt_table_next_fs(tb, itr, &fs) == 0) {
 		if (mnt_fs_get_devno(fs) != devno)
 			continue;
 		mnt_context_disable_swapmatch(cxt, 1);
-		if (rec)
+		if (sub)
+			rc = add_subtree(tb, fs, sub) ? MOUNT_EX_SOFTWARE : 0;
+		else if (rec)
 			rc = umount_do_recurse(cxt, tb, fs);
 		else
 			rc = umount_one_if_mounted(cxt, mnt_fs_get_target(fs));
@@ -472,8 +567,11 @@ static int umount_alltargets(struct libmnt_context *cxt, const char *spec, int r
 			break;
 	}
 
+	if (sub && rc == MOUNT_EX_SUCCESS)
+		rc = umount_subtrees(cxt, sub);
 done:
 	mnt_free_iter(itr);
+	mnt_unref_table(sub);
 	mnt_unref_table(tb);
 
 	return rc;
@@ -505,6 +603,7 @@ int main(int argc, char **argv)
 
 	enum {
 		UMOUNT_OPT_FAKE = CHAR_MAX + 1,
+		UMOUNT_OPT_PARALLEL
 	};
 
 	static const struct option longopts[] = {
@@ -518,6 +617,7 @@ int main(int argc, char **argv)
 		{ "lazy", 0, 0, 'l' },
 		{ "no-canonicalize", 0, 0, 'c' },
 		{ "no-mtab", 0, 0, 'n' },
+		{ "parallel", 1, 0, UMOUNT_OPT_PARALLEL },
 		{ "read-only", 0, 0, 'r' },
 		{ "recursive", 0, 0, 'R' },
 		{ "test-opts", 1, 0, 'O' },
@@ -609,6 +709,15 @@ int main(int argc, char **argv)
 		case 'V':
 			print_version();
 			break;
+		case UMOUNT_OPT_PARALLEL:
+		{
+			int32_t n = strtos32_or_err(optarg,
+					_("invalid number of parallel unmounts"));
+			if (n < 0 || mnt_context_set_parallel(cxt, n) != 0)
+				errx(MOUNT_EX_USAGE, _("invalid number of parallel unmounts: '%s'"),
+						optarg);
+			break;
+		}
 		default:
 			usage(stderr);
 			break;
@@ -7,7 +7,10 @@ TS_HELPER_CPUSET="$top_builddir/test_cpuset"
 TS_HELPER_DMESG="$top_builddir/test_dmesg"
 TS_HELPER_ISLOCAL="$top_builddir/test_islocal"
 TS_HELPER_ISMOUNTED="$top_builddir/test_ismounted"
+TS_HELPER_LIBBLKID_BATCH="$top_builddir/sample-batch"
+TS_HELPER_LIBBLKID_UEVENT="$top_builddir/test_blkid_uevent"
 TS_HELPER_LIBFDISK_GPT="$top_builddir/test_fdisk_gpt"
+TS_HELPER_LIBMOUNT_CACHE="$top_builddir/test_mount_cache"
 TS_HELPER_LIBMOUNT_CONTEXT="$top_builddir/test_mount_context"
 TS_HELPER_LIBMOUNT_LOCK="$top_builddir/test_mount_lock"
 TS_HELPER_LIBMOUNT_OPTSTR="$top_builddir/test_mount_optstr"